@@ -0,0 +1,343 @@
+/* benchmark the xdp or tc bpf programs in the bpf elf files specified in the
+ * command line arguments: load the first program of each file and run it
+ * with BPF_PROG_TEST_RUN on a set of synthetic frames without any network
+ * interface, e.g.:
+ *
+ *   bpf-bench -r 1000000 xdp-count.o xdp-udp4count.o
+ *
+ * each output line contains the program, the frame, the average run time per
+ * packet in ns and the return value of the program as key=value pairs
+ *
+ * options:
+ *   -r  number of runs per program and frame (default 1000000)
+ *   -l  live mode: instead of running programs, enable run time statistics
+ *       in the kernel and print run count and run time of all active xdp and
+ *       tc programs every interval until interrupted
+ *   -i  interval in ms in live mode (default 1000)
+ */
+
+/* bpf */
+#include <bpf/bpf.h>
+#include <bpf/libbpf.h>
+
+/* ethernet */
+#include <linux/if_ether.h>
+
+/* ipv4 */
+#include <linux/ip.h>
+
+/* ipv6 */
+#include <linux/ipv6.h>
+
+/* tcp */
+#include <linux/tcp.h>
+
+/* udp */
+#include <linux/udp.h>
+
+/* htons() */
+#include <arpa/inet.h>
+
+/* getopt(), usleep() */
+#include <unistd.h>
+
+/* atoi() */
+#include <stdlib.h>
+
+/* memset(), memcpy() */
+#include <string.h>
+
+/* printf() */
+#include <stdio.h>
+
+/* maximum size of a synthetic frame */
+#define FRAME_SIZE 128
+
+/* size of udp/tcp payload in synthetic frames */
+#define PAYLOAD_SIZE 32
+
+/* maximum number of programs tracked in live mode */
+#define MAX_PROGS 1024
+
+/* vlan header following the ethernet header */
+struct vlan_hdr {
+	__be16 tci;
+	__be16 proto;
+};
+
+/* synthetic frame */
+struct frame {
+	const char *name;
+	int vlan;		/* add vlan header */
+	int family;		/* AF_INET or AF_INET6 */
+	int proto;		/* IPPROTO_UDP or IPPROTO_TCP */
+	int truncate;		/* cut frame to this length if not 0 */
+	__u8 data[FRAME_SIZE];
+	__u32 len;
+};
+
+/* synthetic frames the programs are run on */
+struct frame frames[] = {
+	{ .name = "ipv4-udp", .family = AF_INET, .proto = IPPROTO_UDP },
+	{ .name = "ipv4-tcp", .family = AF_INET, .proto = IPPROTO_TCP },
+	{ .name = "ipv6-udp", .family = AF_INET6, .proto = IPPROTO_UDP },
+	{ .name = "ipv6-tcp", .family = AF_INET6, .proto = IPPROTO_TCP },
+	{ .name = "vlan-ipv4-udp", .vlan = 1, .family = AF_INET,
+	  .proto = IPPROTO_UDP },
+	{ .name = "vlan-ipv6-tcp", .vlan = 1, .family = AF_INET6,
+	  .proto = IPPROTO_TCP },
+	{ .name = "short", .family = AF_INET, .proto = IPPROTO_UDP,
+	  .truncate = ETH_HLEN },
+	{ .name = "truncated-ipv4", .family = AF_INET, .proto = IPPROTO_UDP,
+	  .truncate = ETH_HLEN + 10 },
+	{ .name = "truncated-ipv6-tcp", .family = AF_INET6,
+	  .proto = IPPROTO_TCP,
+	  .truncate = ETH_HLEN + sizeof(struct ipv6hdr) + 8 },
+};
+
+/* run counters of a program in live mode */
+struct prog_stats {
+	__u32 id;
+	__u64 run_cnt;
+	__u64 run_time_ns;
+};
+
+/* build headers and payload of frame */
+void build_frame(struct frame *frame) {
+	__u8 *pos = frame->data;
+	__u16 l4_len = PAYLOAD_SIZE;
+	__be16 l3_proto;
+
+	/* ethernet header */
+	struct ethhdr *eth = (struct ethhdr *) pos;
+	memcpy(eth->h_dest, "\x02\x00\x00\x00\x00\x02", ETH_ALEN);
+	memcpy(eth->h_source, "\x02\x00\x00\x00\x00\x01", ETH_ALEN);
+	l3_proto = htons(frame->family == AF_INET ? ETH_P_IP : ETH_P_IPV6);
+	eth->h_proto = frame->vlan ? htons(ETH_P_8021Q) : l3_proto;
+	pos += sizeof(*eth);
+
+	/* vlan header */
+	if (frame->vlan) {
+		struct vlan_hdr *vlan = (struct vlan_hdr *) pos;
+		vlan->tci = htons(100);
+		vlan->proto = l3_proto;
+		pos += sizeof(*vlan);
+	}
+
+	/* ip header */
+	l4_len += frame->proto == IPPROTO_TCP ? sizeof(struct tcphdr) :
+		sizeof(struct udphdr);
+	if (frame->family == AF_INET) {
+		struct iphdr *ipv4 = (struct iphdr *) pos;
+		ipv4->version = 4;
+		ipv4->ihl = 5;
+		ipv4->tot_len = htons(sizeof(*ipv4) + l4_len);
+		ipv4->ttl = 64;
+		ipv4->protocol = frame->proto;
+		ipv4->saddr = htonl(0x0a000001);
+		ipv4->daddr = htonl(0x0a000002);
+		pos += sizeof(*ipv4);
+	} else {
+		struct ipv6hdr *ipv6 = (struct ipv6hdr *) pos;
+		ipv6->version = 6;
+		ipv6->payload_len = htons(l4_len);
+		ipv6->nexthdr = frame->proto;
+		ipv6->hop_limit = 64;
+		inet_pton(AF_INET6, "fd00::1", &ipv6->saddr);
+		inet_pton(AF_INET6, "fd00::2", &ipv6->daddr);
+		pos += sizeof(*ipv6);
+	}
+
+	/* udp/tcp header */
+	if (frame->proto == IPPROTO_TCP) {
+		struct tcphdr *tcp = (struct tcphdr *) pos;
+		tcp->source = htons(12345);
+		tcp->dest = htons(80);
+		tcp->doff = sizeof(*tcp) / 4;
+		tcp->ack = 1;
+		pos += sizeof(*tcp);
+	} else {
+		struct udphdr *udp = (struct udphdr *) pos;
+		udp->source = htons(12345);
+		udp->dest = htons(53);
+		udp->len = htons(l4_len);
+		pos += sizeof(*udp);
+	}
+
+	/* payload is left zero */
+	frame->len = pos - frame->data + PAYLOAD_SIZE;
+	if (frame->truncate) {
+		frame->len = frame->truncate;
+	}
+}
+
+/* load first program in file and return program fd */
+int load_bpf(const char *file) {
+	struct bpf_program *prog;
+	struct bpf_object *obj;
+
+	/* open bpf file, the program type is derived from its section */
+	obj = bpf_object__open_file(file, NULL);
+	if (libbpf_get_error(obj)) {
+		return -1;
+	}
+	prog = bpf_object__next_program(obj, NULL);
+	if (!prog) {
+		return -1;
+	}
+
+	/* load bpf program and its maps into the kernel */
+	if (bpf_object__load(obj)) {
+		return -1;
+	}
+
+	return bpf_program__fd(prog);
+}
+
+/* run program in prog_fd repeat times on all frames and print results */
+int run_bench(const char *file, int prog_fd, int repeat) {
+	int num_frames = sizeof(frames) / sizeof(frames[0]);
+	__u8 data_out[FRAME_SIZE];
+	int errors = 0;
+
+	for (int i = 0; i < num_frames; i++) {
+		LIBBPF_OPTS(bpf_test_run_opts, opts,
+			    .data_in = frames[i].data,
+			    .data_size_in = frames[i].len,
+			    .data_out = data_out,
+			    .data_size_out = sizeof(data_out),
+			    .repeat = repeat);
+
+		if (bpf_prog_test_run_opts(prog_fd, &opts)) {
+			printf("file=%s frame=%s error\n", file,
+			       frames[i].name);
+			errors++;
+			continue;
+		}
+		printf("file=%s frame=%s len=%u ns_per_pkt=%u retval=%u\n",
+		       file, frames[i].name, frames[i].len, opts.duration,
+		       opts.retval);
+	}
+
+	return errors;
+}
+
+/* get stats slot of program id in stats, add it if new; NULL if full */
+struct prog_stats *get_stats(struct prog_stats *stats, int *num, __u32 id) {
+	for (int i = 0; i < *num; i++) {
+		if (stats[i].id == id) {
+			return &stats[i];
+		}
+	}
+	if (*num == MAX_PROGS) {
+		return NULL;
+	}
+	memset(&stats[*num], 0, sizeof(stats[*num]));
+	stats[*num].id = id;
+	return &stats[(*num)++];
+}
+
+/* print run count and run time of active xdp and tc programs every interval
+ * ms; run time statistics stay enabled while the stats fd is open
+ */
+int run_live(int interval) {
+	static struct prog_stats stats[MAX_PROGS];
+	int num = 0;
+
+	/* enable run time statistics, like sysctl kernel.bpf_stats_enabled=1 */
+	int stats_fd = bpf_enable_stats(BPF_STATS_RUN_TIME);
+	if (stats_fd < 0) {
+		printf("Error enabling bpf run time statistics\n");
+		return -1;
+	}
+
+	while (1) {
+		usleep(interval * 1000);
+
+		/* iterate all loaded programs */
+		__u32 id = 0;
+		while (!bpf_prog_get_next_id(id, &id)) {
+			struct bpf_prog_info info;
+			__u32 info_len = sizeof(info);
+			int fd = bpf_prog_get_fd_by_id(id);
+			if (fd < 0) {
+				continue;
+			}
+			memset(&info, 0, sizeof(info));
+			int rc = bpf_obj_get_info_by_fd(fd, &info, &info_len);
+			close(fd);
+			if (rc || (info.type != BPF_PROG_TYPE_XDP &&
+				   info.type != BPF_PROG_TYPE_SCHED_CLS &&
+				   info.type != BPF_PROG_TYPE_SCHED_ACT)) {
+				continue;
+			}
+
+			/* print counters of programs that ran in interval */
+			struct prog_stats *prev = get_stats(stats, &num, id);
+			if (!prev || info.run_cnt == prev->run_cnt) {
+				continue;
+			}
+			__u64 run_cnt = info.run_cnt - prev->run_cnt;
+			__u64 run_time_ns = info.run_time_ns -
+				prev->run_time_ns;
+			printf("id=%u prog=%s run_cnt=%llu run_time_ns=%llu "
+			       "ns_per_run=%llu\n", id, info.name,
+			       (unsigned long long) run_cnt,
+			       (unsigned long long) run_time_ns,
+			       (unsigned long long) (run_time_ns / run_cnt));
+			prev->run_cnt = info.run_cnt;
+			prev->run_time_ns = info.run_time_ns;
+		}
+		fflush(stdout);
+	}
+
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	/* handle command line arguments */
+	int repeat = 1000000;
+	int interval = 1000;
+	int live = 0;
+	int opt;
+	while ((opt = getopt(argc, argv, "r:li:")) != -1) {
+		switch (opt) {
+		case 'r':
+			repeat = atoi(optarg);
+			break;
+		case 'l':
+			live = 1;
+			break;
+		case 'i':
+			interval = atoi(optarg);
+			break;
+		default:
+			return -1;
+		}
+	}
+	if (live) {
+		return run_live(interval);
+	}
+	if (argc - optind < 1) {
+		return -1;
+	}
+
+	/* build synthetic frames */
+	for (int i = 0; i < sizeof(frames) / sizeof(frames[0]); i++) {
+		build_frame(&frames[i]);
+	}
+
+	/* load and run all programs */
+	int errors = 0;
+	for (int i = optind; i < argc; i++) {
+		int prog_fd = load_bpf(argv[i]);
+		if (prog_fd < 0) {
+			printf("Error loading bpf program in %s\n", argv[i]);
+			errors++;
+			continue;
+		}
+		errors += run_bench(argv[i], prog_fd, repeat);
+	}
+
+	return errors ? -1 : 0;
+}
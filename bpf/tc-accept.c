@@ -9,7 +9,7 @@
 char _license[] SEC("license") = "GPL";
 
 /* accept all packets */
-SEC("accept_all")
+SEC("tc")
 int _accept_all(struct __sk_buff *skb)
 {
 	return TC_ACT_OK;
@@ -0,0 +1,137 @@
+/* bpf */
+#include <linux/bpf.h>
+#include <bpf/bpf_helpers.h>
+
+/* tc */
+#include <linux/pkt_cls.h>
+
+/* ethernet */
+#include <linux/if_ether.h>
+
+/* ipv4 */
+#include <linux/ip.h>
+
+/* ipv6 */
+#include <linux/ipv6.h>
+
+/* htons */
+#include <arpa/inet.h>
+
+/* set license to gpl */
+char _license[] SEC("license") = "GPL";
+
+/* packet and byte count */
+struct traffic {
+	__u64 packets;
+	__u64 bytes;
+};
+
+/* destination prefix, ipv4 addresses are mapped into ipv6 addresses, i.e.,
+ * ::ffff:<ipv4 address> with prefix length 96 + <ipv4 prefix length>
+ */
+struct prefix {
+	__u32 prefixlen;
+	__u8 addr[16];
+};
+
+/* map for traffic per cgroup id */
+struct {
+	__uint(type, BPF_MAP_TYPE_PERCPU_HASH);
+	__type(key, __u64);
+	__type(value, struct traffic);
+	__uint(max_entries, 16384);
+} cgroup_traffic SEC(".maps");
+
+/* map of accounted destination prefixes to prefix ids, configured from
+ * userspace
+ */
+struct {
+	__uint(type, BPF_MAP_TYPE_LPM_TRIE);
+	__uint(map_flags, BPF_F_NO_PREALLOC);
+	__type(key, struct prefix);
+	__type(value, __u32);
+	__uint(max_entries, 16384);
+} dst_prefixes SEC(".maps");
+
+/* map for traffic per destination prefix id */
+struct {
+	__uint(type, BPF_MAP_TYPE_PERCPU_HASH);
+	__type(key, __u32);
+	__type(value, struct traffic);
+	__uint(max_entries, 16384);
+} prefix_traffic SEC(".maps");
+
+/* add packet of len bytes to traffic for key in map */
+static __always_inline void account(void *map, void *key, __u32 len)
+{
+	struct traffic *traffic;
+
+	traffic = bpf_map_lookup_elem(map, key);
+	if (!traffic) {
+		struct traffic new = {
+			.packets = 1,
+			.bytes = len,
+		};
+		bpf_map_update_elem(map, key, &new, BPF_NOEXIST);
+		return;
+	}
+
+	/* per-cpu values, no atomics needed */
+	traffic->packets += 1;
+	traffic->bytes += len;
+}
+
+/* get destination prefix of packet, return 0 if it is not ipv4/ipv6 */
+static __always_inline int get_dst(struct __sk_buff *skb, struct prefix *dst)
+{
+	void *data_end = (void *)(long)skb->data_end;
+	void *data = (void *)(long)skb->data;
+	struct ipv6hdr *ipv6;
+	struct iphdr *ipv4;
+
+	if (skb->protocol == htons(ETH_P_IP)) {
+		ipv4 = data + sizeof(struct ethhdr);
+		if ((void *) (ipv4 + 1) > data_end) {
+			return 0;
+		}
+		dst->prefixlen = 128;
+		dst->addr[10] = 0xff;
+		dst->addr[11] = 0xff;
+		__builtin_memcpy(&dst->addr[12], &ipv4->daddr, 4);
+		return 1;
+	}
+	if (skb->protocol == htons(ETH_P_IPV6)) {
+		ipv6 = data + sizeof(struct ethhdr);
+		if ((void *) (ipv6 + 1) > data_end) {
+			return 0;
+		}
+		dst->prefixlen = 128;
+		__builtin_memcpy(dst->addr, &ipv6->daddr, 16);
+		return 1;
+	}
+
+	return 0;
+}
+
+/* account egress traffic per cgroup and per destination prefix */
+SEC("tc")
+int _account(struct __sk_buff *skb)
+{
+	struct prefix dst = {};
+	__u64 cgroup_id;
+	__u32 *prefix_id;
+
+	/* account traffic of cgroup of the sending socket */
+	cgroup_id = bpf_skb_cgroup_id(skb);
+	account(&cgroup_traffic, &cgroup_id, skb->len);
+
+	/* account traffic of longest matching destination prefix */
+	if (get_dst(skb, &dst)) {
+		prefix_id = bpf_map_lookup_elem(&dst_prefixes, &dst);
+		if (prefix_id) {
+			account(&prefix_traffic, prefix_id, skb->len);
+		}
+	}
+
+	return TC_ACT_OK;
+}
@@ -1,16 +1,24 @@
 /* load bpf program in bpf elf file specified in first command line argument
  * and attach it to interface specified in second command line argument by
- * creating a clsact qdisc and adding a tc bpf filter to it
+ * creating a clsact qdisc and adding a tc bpf filter to it; both netlink
+ * requests are sent in one batch and their acks are checked
+ *
+ * options:
+ *   -e  attach to the egress hook instead of the ingress hook
+ *   -v  set verifier log level (1: basic, 2: verbose, 4: statistics) and
+ *       print the verifier log to stderr; on errors, it is always printed
+ *   -s  print load statistics of the program as key=value pairs: load time
+ *       in ns, number of verified instructions, translated and jited size
+ *   -p  pin program and maps in /sys/fs/bpf/<ifname>/ and reuse maps that
+ *       are already pinned there, e.g., to keep counters across reloads
  */
 
 /* bpf */
+#include <bpf/bpf.h>
 #include <bpf/libbpf.h>
 
-/* netlink imports */
-#include <asm/types.h>
-#include <sys/socket.h>
-#include <linux/netlink.h>
-#include <linux/rtnetlink.h>
+/* rtnetlink library */
+#include "../netlink/rtnl.h"
 
 /* if_nametoindex() */
 #include <net/if.h>
@@ -27,188 +35,296 @@
 /* htons() */
 #include <arpa/inet.h>
 
-/* load bpf program from file and return program fd */
-int load_bpf(const char* file) {
-	struct bpf_prog_load_attr prog_load_attr = {
-		.prog_type      = BPF_PROG_TYPE_SCHED_CLS,
-		.file		= file,
-	};
-	struct bpf_object *obj;
-	int prog_fd;
+/* atoi() */
+#include <stdlib.h>
+
+/* strerror() */
+#include <string.h>
+
+/* clock_gettime() */
+#include <time.h>
+
+/* getopt(), unlink() */
+#include <unistd.h>
+
+/* mkdir() */
+#include <sys/stat.h>
+
+/* errno */
+#include <errno.h>
+
+/* PATH_MAX */
+#include <limits.h>
+
+/* directory in bpf file system for pinned objects of an interface */
+#define PIN_DIR "/sys/fs/bpf/%s"
+
+/* size of the verifier log buffer */
+#define LOG_BUF_SIZE (16 * 1024 * 1024)
+
+/* verifier log level, see -v; on failure, the log is always printed */
+__u32 log_level = 0;
+
+/* print load statistics, see -s */
+int print_stats = 0;
+
+/* verifier log of the loaded program */
+char log_buf[LOG_BUF_SIZE];
+
+/* set pin paths of all maps in obj to pin_dir, so that loading obj reuses
+ * maps already pinned there and pins all new maps
+ */
+int set_pin_paths(struct bpf_object *obj, const char *pin_dir) {
+	char path[PATH_MAX];
+	struct bpf_map *map;
+
+	bpf_object__for_each_map(map, obj) {
+		snprintf(path, sizeof(path), "%s/%s", pin_dir,
+			 bpf_map__name(map));
+		if (bpf_map__set_pin_path(map, path)) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
 
-	if (bpf_prog_load_xattr(&prog_load_attr, &obj, &prog_fd)) {
+/* pin program prog in pin_dir and replace previously pinned program */
+int pin_prog(struct bpf_program *prog, const char *pin_dir) {
+	char path[PATH_MAX];
+
+	snprintf(path, sizeof(path), "%s/tc", pin_dir);
+	if (unlink(path) && errno != ENOENT) {
 		return -1;
 	}
+	return bpf_program__pin(prog, path);
+}
+
+/* get current time of monotonic clock in nanoseconds */
+__u64 get_time_ns() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* print load statistics of loaded program prog as key=value pairs in a
+ * single line
+ */
+void print_load_stats(struct bpf_program *prog, __u64 load_ns) {
+	struct bpf_prog_info info;
+	__u32 info_len = sizeof(info);
 
-	return prog_fd;
+	memset(&info, 0, sizeof(info));
+	if (bpf_obj_get_info_by_fd(bpf_program__fd(prog), &info, &info_len)) {
+		return;
+	}
+	printf("prog=%s load_ns=%llu verified_insns=%u xlated_prog_len=%u "
+	       "jited_prog_len=%u log_len=%zu\n", bpf_program__name(prog),
+	       (unsigned long long) load_ns, info.verified_insns,
+	       info.xlated_prog_len, info.jited_prog_len, strlen(log_buf));
 }
 
-/* create netlink socket and return socket fd */
-int create_socket() {
-	/* create socket address */
-	struct sockaddr_nl sa;
-	memset(&sa, 0, sizeof(sa));
-	sa.nl_family = AF_NETLINK;
+/* load bpf program from file and return program fd; if pin_dir is set, pin
+ * program and maps in pin_dir
+ */
+int load_bpf(const char* file, const char *pin_dir) {
+	struct bpf_program *prog;
+	struct bpf_object *obj;
 
-	/* create and bind socket */
-	int fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
-	if (fd < 0) {
-		return fd;
+	/* open bpf file */
+	obj = bpf_object__open_file(file, NULL);
+	if (libbpf_get_error(obj)) {
+		return -1;
 	}
-	if (bind(fd, (struct sockaddr *) &sa, sizeof(sa))) {
+
+	/* use first program in file as tc program */
+	prog = bpf_object__next_program(obj, NULL);
+	if (!prog) {
 		return -1;
 	}
-	return fd;
+	bpf_program__set_type(prog, BPF_PROG_TYPE_SCHED_CLS);
+
+	/* capture verifier log */
+	bpf_program__set_log_level(prog, log_level);
+	bpf_program__set_log_buf(prog, log_buf, sizeof(log_buf));
+
+	/* reuse or pin maps in pin dir */
+	if (pin_dir) {
+		if (mkdir(pin_dir, 0700) && errno != EEXIST) {
+			return -1;
+		}
+		if (set_pin_paths(obj, pin_dir)) {
+			return -1;
+		}
+	}
+
+	/* load bpf program and its maps into the kernel */
+	__u64 start_ns = get_time_ns();
+	int err = bpf_object__load(obj);
+	__u64 load_ns = get_time_ns() - start_ns;
+	if (err || log_level) {
+		fprintf(stderr, "%s", log_buf);
+	}
+	if (err) {
+		return -1;
+	}
+	if (print_stats) {
+		print_load_stats(prog, load_ns);
+	}
+
+	/* pin program in pin dir */
+	if (pin_dir && pin_prog(prog, pin_dir)) {
+		return -1;
+	}
+
+	return bpf_program__fd(prog);
 }
 
-/* add qdisc with netlink request */
-int send_request_qdisc(int fd, const char *if_name) {
-	/* create socket address */
-	struct sockaddr_nl sa;
-	memset(&sa, 0, sizeof(sa));
-	sa.nl_family = AF_NETLINK;
-
-	/* create request message */
-	char msg_buf[512] = { 0 };
-	struct nlmsghdr *hdr = (struct nlmsghdr *) msg_buf;
-	struct tcmsg *tcm = NLMSG_DATA(hdr);
-	char *attr_buf = msg_buf + NLMSG_SPACE(sizeof(struct tcmsg));
-	struct rtattr *kind_rta = (struct rtattr *) attr_buf;
-	const char *kind = "clsact";
-
-	/* fill header */
-	hdr->nlmsg_len = NLMSG_SPACE(sizeof(struct tcmsg)) +
-		RTA_LENGTH(strlen(kind) + 1);
-	hdr->nlmsg_pid = 0;
-	hdr->nlmsg_seq = 1;
-	hdr->nlmsg_type = RTM_NEWQDISC;
-	hdr->nlmsg_flags = NLM_F_REQUEST | NLM_F_CREATE;
+/* indexes of the requests in the batch */
+#define REQ_QDISC 0
+#define REQ_FILTER 1
+
+/* add request that adds clsact qdisc to msg; with NLM_F_EXCL, an existing
+ * qdisc is reported with EEXIST
+ */
+void add_request_qdisc(struct rtnl_msg *msg, int ifindex) {
+	struct tcmsg *tcm = rtnl_msg_add(msg, RTM_NEWQDISC,
+					 NLM_F_CREATE | NLM_F_EXCL,
+					 sizeof(*tcm));
+	if (!tcm) {
+		return;
+	}
 
 	/* fill tc message */
 	tcm->tcm_family = AF_UNSPEC;
-	tcm->tcm_ifindex = if_nametoindex(if_name);
+	tcm->tcm_ifindex = ifindex;
 	tcm->tcm_handle = TC_H_MAKE(TC_H_CLSACT, 0);
 	tcm->tcm_parent = TC_H_CLSACT;
 
-	/* fill kind attribute */
-	kind_rta->rta_type = TCA_KIND;
-	kind_rta->rta_len = RTA_LENGTH(strlen(kind) + 1);
-	memcpy(RTA_DATA(kind_rta), kind, strlen(kind) + 1);
-
-	/* send request */
-	struct iovec iov = { msg_buf, hdr->nlmsg_len };
-	struct msghdr msg = { &sa, sizeof(sa), &iov, 1, NULL, 0, 0 };
-	sendmsg(fd, &msg, 0);
-
-	return 0;
+	/* add kind attribute */
+	rtnl_attr_add_str(msg, TCA_KIND, "clsact");
 }
 
-/* add tc filter with netlink request */
-int send_request_filter(int fd, const char *if_name, int bpf_fd) {
-	/* create socket address */
-	struct sockaddr_nl sa;
-	memset(&sa, 0, sizeof(sa));
-	sa.nl_family = AF_NETLINK;
-
-	/* create request message */
-	char msg_buf[512] = { 0 };
-	struct nlmsghdr *hdr = (struct nlmsghdr *) msg_buf;
-	struct tcmsg *tcm = NLMSG_DATA(hdr);
-	char *attr_buf = msg_buf + NLMSG_SPACE(sizeof(struct tcmsg));
-	struct rtattr *kind_rta = (struct rtattr *) attr_buf;
-	const char *kind = "bpf";
-	struct rtattr *options_rta =
-		(struct rtattr *) (attr_buf +
-				   RTA_SPACE(strlen(kind) + 1));
-	struct rtattr *fd_rta = RTA_DATA(options_rta);
-	struct rtattr *name_rta =
-		(struct rtattr *) (((char *) fd_rta) +
-				   RTA_SPACE(sizeof(bpf_fd)));
-	const char *name = "accept-all";
-	struct rtattr *flags_rta =
-		(struct rtattr *) (((char *) name_rta) +
-				   RTA_SPACE(strlen(name) + 1));
-	__u32 flags = TCA_BPF_FLAG_ACT_DIRECT;
-
-	/* fill header */
-	hdr->nlmsg_len = NLMSG_SPACE(sizeof(struct tcmsg)) +
-		RTA_SPACE(strlen(kind) + 1) +
-		RTA_SPACE(0) +
-		RTA_SPACE(sizeof(bpf_fd)) +
-		RTA_SPACE(strlen(name) + 1) +
-		RTA_LENGTH(sizeof(flags));
-	hdr->nlmsg_pid = 0;
-	hdr->nlmsg_seq = 1;
-	hdr->nlmsg_type = RTM_NEWTFILTER;
-	hdr->nlmsg_flags = NLM_F_REQUEST | NLM_F_CREATE;
+/* add request that adds tc filter to ingress or egress hook to msg */
+void add_request_filter(struct rtnl_msg *msg, int ifindex, int bpf_fd,
+			int egress) {
+	struct tcmsg *tcm = rtnl_msg_add(msg, RTM_NEWTFILTER, NLM_F_CREATE,
+					 sizeof(*tcm));
+	if (!tcm) {
+		return;
+	}
 
 	/* fill tc message */
 	tcm->tcm_family = AF_UNSPEC;
-	tcm->tcm_ifindex = if_nametoindex(if_name);
+	tcm->tcm_ifindex = ifindex;
 	tcm->tcm_handle = 0;
-	tcm->tcm_parent = TC_H_MAKE(TC_H_CLSACT, TC_H_MIN_INGRESS);
+	tcm->tcm_parent = TC_H_MAKE(TC_H_CLSACT, egress ? TC_H_MIN_EGRESS :
+				    TC_H_MIN_INGRESS);
 	tcm->tcm_info = TC_H_MAKE(0, htons(ETH_P_ALL));
 
-	/* fill kind attribute */
-	kind_rta->rta_type = TCA_KIND;
-	kind_rta->rta_len = RTA_LENGTH(strlen(kind) + 1);
-	memcpy(RTA_DATA(kind_rta), kind, strlen(kind) + 1);
-
-	/* fill options attribute */
-	options_rta->rta_type = TCA_OPTIONS;
-	options_rta->rta_len = RTA_SPACE(0) + RTA_SPACE(sizeof(bpf_fd)) +
-		RTA_SPACE(strlen(name) + 1) + RTA_LENGTH(sizeof(flags));
+	/* add kind attribute */
+	rtnl_attr_add_str(msg, TCA_KIND, "bpf");
 
-	/* fill bpf fd attribute */
-	fd_rta->rta_type = TCA_BPF_FD;
-	fd_rta->rta_len = RTA_LENGTH(sizeof(bpf_fd));
-	memcpy(RTA_DATA(fd_rta), &bpf_fd, sizeof(bpf_fd));
-
-	/* fill bpf name attribute */
-	name_rta->rta_type = TCA_BPF_NAME;
-	name_rta->rta_len = RTA_LENGTH(strlen(name) + 1);
-	memcpy(RTA_DATA(name_rta), name, strlen(name) + 1);
+	/* add options attribute with nested bpf fd, name and flags */
+	struct rtattr *options = rtnl_attr_nest(msg, TCA_OPTIONS);
+	rtnl_attr_add_u32(msg, TCA_BPF_FD, bpf_fd);
+	rtnl_attr_add_str(msg, TCA_BPF_NAME, "accept-all");
+	rtnl_attr_add_u32(msg, TCA_BPF_FLAGS, TCA_BPF_FLAG_ACT_DIRECT);
+	rtnl_attr_nest_end(msg, options);
+}
 
-	/* fill bpf flags */
-	flags_rta->rta_type = TCA_BPF_FLAGS;
-	flags_rta->rta_len = RTA_LENGTH(sizeof(flags));
-	memcpy(RTA_DATA(flags_rta), &flags, sizeof(flags));
+/* send qdisc and tc filter requests in one batch and wait for their acks;
+ * an already existing qdisc is not an error
+ */
+int send_requests(struct rtnl *rtnl, const char *if_name, int bpf_fd,
+		  int egress) {
+	/* create request messages */
+	char buf[1024];
+	struct rtnl_msg msg;
+	int errors[2];
+	int ifindex = if_nametoindex(if_name);
+	rtnl_msg_init(&msg, buf, sizeof(buf));
+	add_request_qdisc(&msg, ifindex);
+	add_request_filter(&msg, ifindex, bpf_fd, egress);
+
+	/* send requests and wait for acks */
+	int rc = rtnl_send(rtnl, &msg);
+	if (rc == 0) {
+		rc = rtnl_wait_acks(rtnl, &msg, errors);
+	}
+	if (rc < 0) {
+		printf("Error sending netlink requests: %s\n", strerror(-rc));
+		return -1;
+	}
 
-	/* send request */
-	struct iovec iov = { msg_buf, hdr->nlmsg_len };
-	struct msghdr msg = { &sa, sizeof(sa), &iov, 1, NULL, 0, 0 };
-	sendmsg(fd, &msg, 0);
+	/* report errors */
+	int qdisc_err = errors[REQ_QDISC];
+	int filter_err = errors[REQ_FILTER];
+	if (qdisc_err && qdisc_err != -EEXIST) {
+		printf("Error adding qdisc: %s\n", strerror(-qdisc_err));
+	}
+	if (filter_err) {
+		rtnl_perror(rtnl, "Error adding tc filter", filter_err);
+	}
+	if ((qdisc_err && qdisc_err != -EEXIST) || filter_err) {
+		return -1;
+	}
 
 	return 0;
 }
 
 int main(int argc, char **argv) {
 	/* handle command line arguments */
-	if (argc < 3) {
+	int egress = 0;
+	int pin = 0;
+	int opt;
+	while ((opt = getopt(argc, argv, "epv:s")) != -1) {
+		switch (opt) {
+		case 'e':
+			egress = 1;
+			break;
+		case 'p':
+			pin = 1;
+			break;
+		case 'v':
+			log_level = atoi(optarg);
+			break;
+		case 's':
+			print_stats = 1;
+			break;
+		default:
+			return -1;
+		}
+	}
+	if (argc - optind < 2) {
 		return -1;
 	}
-	const char *bpf_file = argv[1];
-	const char *if_name = argv[2];
+	const char *bpf_file = argv[optind];
+	const char *if_name = argv[optind + 1];
+
+	/* get pin directory of interface */
+	char pin_dir[PATH_MAX];
+	snprintf(pin_dir, sizeof(pin_dir), PIN_DIR, if_name);
 
 	/* load bpf program */
-	int prog_fd = load_bpf(bpf_file);
+	int prog_fd = load_bpf(bpf_file, pin ? pin_dir : NULL);
 	if (prog_fd < 0) {
 		printf("Error loading bpf program\n");
 		return -1;
 	}
 
 	/* create netlink socket */
-	int nl_fd = create_socket();
-	if (nl_fd < 0) {
+	struct rtnl rtnl;
+	if (rtnl_open(&rtnl, 0, 0, 0)) {
 		printf("Error creating netlink socket\n");
 		return -1;
 	}
 
-	/* add qdisc */
-	send_request_qdisc(nl_fd, if_name);
-
-	/* add tc filter */
-	send_request_filter(nl_fd, if_name, prog_fd);
+	/* add qdisc and tc filter */
+	if (send_requests(&rtnl, if_name, prog_fd, egress)) {
+		return -1;
+	}
 
 	return 0;
 }
@@ -1,32 +1,143 @@
 /* load bpf program in bpf elf file specified in first command line argument
- * and attach it to interface specified in second command line argument using
- * tc and libbpf
+ * and attach it to the interfaces specified in the remaining command line
+ * arguments using tc and libbpf; interfaces can be given as names or as glob
+ * patterns, e.g., "veth*", and all of them share the same loaded program
+ *
+ * multiple programs can be attached to the same hook with different
+ * priorities; they run in the order of their priorities, lowest first
+ *
+ * options:
+ *   -e  attach to the egress hook instead of the ingress hook
+ *   -H  handle of the tc filter (default: chosen by the kernel, usually 1)
+ *   -P  priority of the tc filter (default: chosen by the kernel)
+ *   -r  replace the program of the existing tc filter identified by -H and
+ *       -P instead of failing
+ *   -l  list programs attached to the hook of the interfaces instead of
+ *       attaching a program, no bpf elf file is given; the filters are
+ *       dumped with rtnetlink, with -H only the filters with this handle
+ *   -v  set verifier log level (1: basic, 2: verbose, 4: statistics) and
+ *       print the verifier log to stderr; on errors, it is always printed
+ *   -s  print load statistics of the program as key=value pairs: load time
+ *       in ns, number of verified instructions, translated and jited size
  */
 
 /* bpf */
+#include <bpf/bpf.h>
 #include <bpf/libbpf.h>
 
-/* if_nametoindex() */
+/* rtnetlink library */
+#include "../netlink/rtnl.h"
+
+/* TC_H_* */
+#include <linux/pkt_sched.h>
+
+/* TCA_BPF_* */
+#include <linux/pkt_cls.h>
+
+/* if_nametoindex(), if_nameindex() */
 #include <net/if.h>
 
+/* close(), getopt() */
+#include <unistd.h>
+
+/* fnmatch() */
+#include <fnmatch.h>
+
+/* clock_gettime() */
+#include <time.h>
+
+/* atoi(), calloc(), strtoul() */
+#include <stdlib.h>
+
+/* strcpy(), strpbrk() */
+#include <string.h>
+
+/* errno */
+#include <errno.h>
+
+/* size of the verifier log buffer */
+#define LOG_BUF_SIZE (16 * 1024 * 1024)
+
+/* verifier log level, see -v; on failure, the log is always printed */
+__u32 log_level = 0;
+
+/* print load statistics, see -s */
+int print_stats = 0;
+
+/* verifier log of the loaded program */
+char log_buf[LOG_BUF_SIZE];
+
+/* get current time of monotonic clock in nanoseconds */
+__u64 get_time_ns() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* print load statistics of loaded program prog as key=value pairs in a
+ * single line
+ */
+void print_load_stats(struct bpf_program *prog, __u64 load_ns) {
+	struct bpf_prog_info info;
+	__u32 info_len = sizeof(info);
+
+	memset(&info, 0, sizeof(info));
+	if (bpf_obj_get_info_by_fd(bpf_program__fd(prog), &info, &info_len)) {
+		return;
+	}
+	printf("prog=%s load_ns=%llu verified_insns=%u xlated_prog_len=%u "
+	       "jited_prog_len=%u log_len=%zu\n", bpf_program__name(prog),
+	       (unsigned long long) load_ns, info.verified_insns,
+	       info.xlated_prog_len, info.jited_prog_len, strlen(log_buf));
+}
+
 /* load bpf program from file and return program fd */
 int load_bpf(const char* file) {
-	struct bpf_prog_load_attr prog_load_attr = {
-		.prog_type      = BPF_PROG_TYPE_SCHED_CLS,
-		.file		= file,
-	};
+	struct bpf_program *prog;
 	struct bpf_object *obj;
-	int prog_fd;
 
-	if (bpf_prog_load_xattr(&prog_load_attr, &obj, &prog_fd)) {
+	/* open bpf file */
+	obj = bpf_object__open_file(file, NULL);
+	if (libbpf_get_error(obj)) {
 		return -1;
 	}
 
-	return prog_fd;
+	/* use first program in file as tc program */
+	prog = bpf_object__next_program(obj, NULL);
+	if (!prog) {
+		return -1;
+	}
+	bpf_program__set_type(prog, BPF_PROG_TYPE_SCHED_CLS);
+
+	/* capture verifier log */
+	bpf_program__set_log_level(prog, log_level);
+	bpf_program__set_log_buf(prog, log_buf, sizeof(log_buf));
+
+	/* load bpf program and its maps into the kernel */
+	__u64 start_ns = get_time_ns();
+	int err = bpf_object__load(obj);
+	__u64 load_ns = get_time_ns() - start_ns;
+	if (err || log_level) {
+		fprintf(stderr, "%s", log_buf);
+	}
+	if (err) {
+		return -1;
+	}
+	if (print_stats) {
+		print_load_stats(prog, load_ns);
+	}
+
+	return bpf_program__fd(prog);
 }
 
-/* attach bpf program in prog_fd to network interface identified by if_name */
-int attach_bpf(const char *if_name, int prog_fd) {
+/* attach bpf program to network interface identified by if_name at
+ * attach_point, i.e., BPF_TC_INGRESS or BPF_TC_EGRESS, with program fd,
+ * handle, priority and flags in opts; opts is updated with the handle and
+ * priority of the filter
+ */
+int attach_bpf(const char *if_name, enum bpf_tc_attach_point attach_point,
+	       struct bpf_tc_opts *opts) {
 	int rc;
 
 	// create bpf hook
@@ -34,19 +145,15 @@ int attach_bpf(const char *if_name, int prog_fd) {
 	memset(&hook, 0, sizeof(hook));
 	hook.sz			= sizeof(struct bpf_tc_hook);
 	hook.ifindex		= if_nametoindex(if_name);
-	hook.attach_point	= BPF_TC_INGRESS; // BPF_TC_EGRESS, BPF_TC_CUSTOM
+	hook.attach_point	= attach_point;
 	rc = bpf_tc_hook_create(&hook);
-	if (rc) {
+	if (rc && rc != -EEXIST) {
 		printf("Error creating tc hook\n");
 		return rc;
 	}
 
 	// attach bpf program
-	struct bpf_tc_opts opts;
-	memset(&opts, 0, sizeof(opts));
-	opts.sz		= sizeof(struct bpf_tc_opts);
-	opts.prog_fd	= prog_fd;
-	rc = bpf_tc_attach(&hook, &opts);
+	rc = bpf_tc_attach(&hook, opts);
 	if (rc) {
 		printf("Error during tc attach\n");
 		return rc;
@@ -55,26 +162,224 @@ int attach_bpf(const char *if_name, int prog_fd) {
 	return 0;
 }
 
+/* hook and handle of listed filters */
+struct list_filter {
+	const char *if_name;
+	enum bpf_tc_attach_point attach_point;
+	__u32 handle;			/* handle or 0 for all */
+};
+
+/* print bpf filter in RTM_NEWTFILTER message nh of filter dump */
+int print_filter(struct nlmsghdr *nh, void *arg) {
+	struct list_filter *filter = arg;
+	struct tcmsg *tcm = NLMSG_DATA(nh);
+
+	if (nh->nlmsg_type != RTM_NEWTFILTER) {
+		return 0;
+	}
+
+	/* the dump also contains the filter chains of the priorities, they
+	 * have no handle
+	 */
+	if (!tcm->tcm_handle ||
+	    (filter->handle && tcm->tcm_handle != filter->handle)) {
+		return 0;
+	}
+	struct rtattr *tb[TCA_MAX + 1];
+	rtnl_parse_attrs(tb, TCA_MAX, TCA_RTA(tcm), TCA_PAYLOAD(nh));
+	if (!tb[TCA_KIND] || strcmp(RTA_DATA(tb[TCA_KIND]), "bpf") ||
+	    !tb[TCA_OPTIONS]) {
+		return 0;
+	}
+	struct rtattr *options[TCA_BPF_MAX + 1];
+	rtnl_parse_attrs(options, TCA_BPF_MAX, RTA_DATA(tb[TCA_OPTIONS]),
+			 RTA_PAYLOAD(tb[TCA_OPTIONS]));
+	__u32 prog_id = 0;
+	if (options[TCA_BPF_ID]) {
+		prog_id = *(__u32 *) RTA_DATA(options[TCA_BPF_ID]);
+	}
+
+	/* get program name */
+	struct bpf_prog_info info;
+	__u32 info_len = sizeof(info);
+	memset(&info, 0, sizeof(info));
+	int fd = bpf_prog_get_fd_by_id(prog_id);
+	if (fd < 0 || bpf_obj_get_info_by_fd(fd, &info, &info_len)) {
+		strcpy(info.name, "?");
+	}
+	if (fd >= 0) {
+		close(fd);
+	}
+
+	printf("%s: %s handle %u priority %u prog_id %u prog %s\n",
+	       filter->if_name,
+	       filter->attach_point == BPF_TC_EGRESS ? "egress" : "ingress",
+	       tcm->tcm_handle, TC_H_MAJ(tcm->tcm_info) >> 16, prog_id,
+	       info.name);
+
+	return 0;
+}
+
+/* print programs attached to network interface identified by if_name at
+ * attach_point, only with handle if not 0; dump all filters of the hook,
+ * since bpf_tc_query only finds a filter by its handle and priority
+ */
+int list_bpf(struct rtnl *rtnl, const char *if_name,
+	     enum bpf_tc_attach_point attach_point, __u32 handle) {
+	struct list_filter filter = { if_name, attach_point, handle };
+	int ifindex = if_nametoindex(if_name);
+	if (!ifindex) {
+		return -1;
+	}
+
+	/* create dump request of the filters of the clsact hook */
+	char buf[256];
+	struct rtnl_msg msg;
+	rtnl_msg_init(&msg, buf, sizeof(buf));
+	struct tcmsg *tcm = rtnl_msg_add(&msg, RTM_GETTFILTER, NLM_F_DUMP,
+					 sizeof(*tcm));
+	if (!tcm) {
+		return -1;
+	}
+	tcm->tcm_family = AF_UNSPEC;
+	tcm->tcm_ifindex = ifindex;
+	tcm->tcm_parent = TC_H_MAKE(TC_H_CLSACT,
+				    attach_point == BPF_TC_EGRESS ?
+				    TC_H_MIN_EGRESS : TC_H_MIN_INGRESS);
+
+	/* send request and print filters until dump is done */
+	return rtnl_dump(rtnl, &msg, print_filter, &filter);
+}
+
+/* get names of interfaces matching the names or glob patterns in args;
+ * returns number of interfaces or -1 on error
+ */
+int get_interfaces(char **args, int num_args, const char ***if_names) {
+	struct if_nameindex *ifs = if_nameindex();
+	int num_ifs = 0;
+	int num = 0;
+
+	if (!ifs) {
+		return -1;
+	}
+	while (ifs[num_ifs].if_index) {
+		num_ifs++;
+	}
+	*if_names = calloc(num_args * (num_ifs + 1), sizeof(char *));
+	if (!*if_names) {
+		return -1;
+	}
+
+	for (int i = 0; i < num_args; i++) {
+		/* plain interface name */
+		if (!strpbrk(args[i], "*?[")) {
+			(*if_names)[num++] = args[i];
+			continue;
+		}
+
+		/* glob pattern */
+		for (int j = 0; j < num_ifs; j++) {
+			if (!fnmatch(args[i], ifs[j].if_name, 0)) {
+				(*if_names)[num++] = ifs[j].if_name;
+			}
+		}
+	}
+
+	return num;
+}
+
 int main(int argc, char **argv) {
 	/* handle command line arguments */
-	if (argc < 3) {
+	enum bpf_tc_attach_point attach_point = BPF_TC_INGRESS;
+	struct bpf_tc_opts opts;
+	memset(&opts, 0, sizeof(opts));
+	opts.sz = sizeof(struct bpf_tc_opts);
+	int list = 0;
+	int opt;
+	while ((opt = getopt(argc, argv, "eH:P:rlv:s")) != -1) {
+		switch (opt) {
+		case 'e':
+			attach_point = BPF_TC_EGRESS;
+			break;
+		case 'H':
+			opts.handle = strtoul(optarg, NULL, 0);
+			break;
+		case 'P':
+			opts.priority = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			opts.flags = BPF_TC_F_REPLACE;
+			break;
+		case 'l':
+			list = 1;
+			break;
+		case 'v':
+			log_level = atoi(optarg);
+			break;
+		case 's':
+			print_stats = 1;
+			break;
+		default:
+			return -1;
+		}
+	}
+	if (argc - optind < (list ? 1 : 2)) {
+		return -1;
+	}
+	if (opts.flags && (!opts.handle || !opts.priority)) {
+		printf("Error: replacing needs handle and priority\n");
 		return -1;
 	}
-	const char *bpf_file = argv[1];
-	const char *if_name = argv[2];
 
-	/* load bpf program */
-	int prog_fd = load_bpf(bpf_file);
-	if (prog_fd < 0) {
-		printf("Error loading bpf program\n");
+	/* get interfaces */
+	const char **if_names;
+	int first_if = optind + (list ? 0 : 1);
+	int num_ifs = get_interfaces(argv + first_if, argc - first_if,
+				     &if_names);
+	if (num_ifs <= 0) {
+		printf("Error finding interfaces\n");
 		return -1;
 	}
 
-	/* attach bpf program */
-	if (attach_bpf(if_name, prog_fd)) {
-		printf("Error attaching bpf program\n");
+	/* list attached programs */
+	int errors = 0;
+	if (list) {
+		struct rtnl rtnl;
+		if (rtnl_open(&rtnl, 0, 0, 0)) {
+			printf("Error creating netlink socket\n");
+			return -1;
+		}
+		for (int i = 0; i < num_ifs; i++) {
+			if (list_bpf(&rtnl, if_names[i], attach_point,
+				     opts.handle)) {
+				printf("%s: Error listing bpf programs\n",
+				       if_names[i]);
+				errors++;
+			}
+		}
+		return errors ? -1 : 0;
+	}
+
+	/* load bpf program once for all interfaces */
+	const char *bpf_file = argv[optind];
+	opts.prog_fd = load_bpf(bpf_file);
+	if (opts.prog_fd < 0) {
+		printf("Error loading bpf program\n");
 		return -1;
 	}
 
-	return 0;
+	/* attach bpf program to all interfaces */
+	for (int i = 0; i < num_ifs; i++) {
+		struct bpf_tc_opts if_opts = opts;
+		if (attach_bpf(if_names[i], attach_point, &if_opts)) {
+			printf("%s: Error attaching bpf program\n",
+			       if_names[i]);
+			errors++;
+			continue;
+		}
+		printf("%s: Attached bpf program with handle %u and priority "
+		       "%u\n", if_names[i], if_opts.handle, if_opts.priority);
+	}
+
+	return errors ? -1 : 0;
 }
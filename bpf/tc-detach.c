@@ -1,15 +1,16 @@
 /* unload current bpf program on interface specified in first command line
  * argument by removing the clsact qdisc
+ *
+ * options:
+ *   -i  only remove the tc filters on the ingress hook and keep the qdisc
+ *   -e  only remove the tc filters on the egress hook and keep the qdisc
  */
 
-/* netlink imports */
-#include <asm/types.h>
-#include <sys/socket.h>
-#include <linux/netlink.h>
-#include <linux/rtnetlink.h>
+/* rtnetlink library */
+#include "../netlink/rtnl.h"
 
-/* memset */
-#include <string.h>
+/* EMSGSIZE */
+#include <errno.h>
 
 /* printf */
 #include <stdio.h>
@@ -20,46 +21,19 @@
 /* TC_H_* */
 #include <linux/pkt_sched.h>
 
-/* create netlink socket and return socket fd */
-int create_socket() {
-	/* create socket address */
-	struct sockaddr_nl sa;
-	memset(&sa, 0, sizeof(sa));
-	sa.nl_family = AF_NETLINK;
-
-	/* create and bind socket */
-	int fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
-	if (fd < 0) {
-		return fd;
-	}
-	if (bind(fd, (struct sockaddr *) &sa, sizeof(sa))) {
-		return -1;
-	}
-	return fd;
-}
-
-/* send netlink request */
-int send_request(int fd, const char *if_name) {
-	/* create socket address */
-	struct sockaddr_nl sa;
-	memset(&sa, 0, sizeof(sa));
-	sa.nl_family = AF_NETLINK;
+/* getopt() */
+#include <unistd.h>
 
+/* remove qdisc with netlink request */
+int send_request(struct rtnl *rtnl, const char *if_name) {
 	/* create request message */
-	char msg_buf[512] = { 0 };
-	struct nlmsghdr *hdr = (struct nlmsghdr *) msg_buf;
-	struct tcmsg *tcm = NLMSG_DATA(hdr);
-	char *attr_buf = msg_buf + NLMSG_SPACE(sizeof(struct tcmsg));
-	struct rtattr *kind_rta = (struct rtattr *) attr_buf;
-	const char *kind = "clsact";
-
-	/* fill header */
-	hdr->nlmsg_len = NLMSG_SPACE(sizeof(struct tcmsg)) +
-		RTA_LENGTH(strlen(kind) + 1);
-	hdr->nlmsg_pid = 0;
-	hdr->nlmsg_seq = 1;
-	hdr->nlmsg_type = RTM_DELQDISC;
-	hdr->nlmsg_flags = NLM_F_REQUEST;
+	char buf[512];
+	struct rtnl_msg msg;
+	rtnl_msg_init(&msg, buf, sizeof(buf));
+	struct tcmsg *tcm = rtnl_msg_add(&msg, RTM_DELQDISC, 0, sizeof(*tcm));
+	if (!tcm) {
+		return -EMSGSIZE;
+	}
 
 	/* fill tc message */
 	tcm->tcm_family = AF_UNSPEC;
@@ -67,23 +41,75 @@ int send_request(int fd, const char *if_name) {
 	tcm->tcm_handle = TC_H_MAKE(TC_H_CLSACT, 0);
 	tcm->tcm_parent = TC_H_CLSACT;
 
-	/* fill kind attribute */
-	kind_rta->rta_type = TCA_KIND;
-	kind_rta->rta_len = RTA_LENGTH(strlen(kind) + 1);
-	memcpy(RTA_DATA(kind_rta), kind, strlen(kind) + 1);
+	/* add kind attribute */
+	rtnl_attr_add_str(&msg, TCA_KIND, "clsact");
 
-	/* send request */
-	struct iovec iov = { msg_buf, hdr->nlmsg_len };
-	struct msghdr msg = { &sa, sizeof(sa), &iov, 1, NULL, 0, 0 };
-	sendmsg(fd, &msg, 0);
+	/* send request and wait for ack */
+	return rtnl_request(rtnl, &msg);
+}
 
-	return 0;
+/* remove all tc filters on ingress or egress hook with netlink request */
+int send_request_filter(struct rtnl *rtnl, const char *if_name, int egress) {
+	/* create request message */
+	char buf[512];
+	struct rtnl_msg msg;
+	rtnl_msg_init(&msg, buf, sizeof(buf));
+	struct tcmsg *tcm = rtnl_msg_add(&msg, RTM_DELTFILTER, 0,
+					 sizeof(*tcm));
+	if (!tcm) {
+		return -EMSGSIZE;
+	}
+
+	/* fill tc message; without handle and priority, all filters of the
+	 * parent are removed
+	 */
+	tcm->tcm_family = AF_UNSPEC;
+	tcm->tcm_ifindex = if_nametoindex(if_name);
+	tcm->tcm_handle = 0;
+	tcm->tcm_parent = TC_H_MAKE(TC_H_CLSACT, egress ? TC_H_MIN_EGRESS :
+				    TC_H_MIN_INGRESS);
+	tcm->tcm_info = 0;
+
+	/* send request and wait for ack */
+	return rtnl_request(rtnl, &msg);
 }
 
 int main(int argc, char **argv) {
-	if (argc < 2) {
+	int ingress = 0;
+	int egress = 0;
+	int opt;
+	while ((opt = getopt(argc, argv, "ie")) != -1) {
+		switch (opt) {
+		case 'i':
+			ingress = 1;
+			break;
+		case 'e':
+			egress = 1;
+			break;
+		default:
+			return -1;
+		}
+	}
+	if (argc - optind < 1) {
+		return -1;
+	}
+	const char *if_name = argv[optind];
+	struct rtnl rtnl;
+	if (rtnl_open(&rtnl, 0, 0, 0)) {
+		printf("Error creating netlink socket\n");
+		return -1;
+	}
+
+	/* remove whole qdisc unless only one hook is selected */
+	int rc;
+	if (ingress == egress) {
+		rc = send_request(&rtnl, if_name);
+	} else {
+		rc = send_request_filter(&rtnl, if_name, egress);
+	}
+	if (rc) {
+		rtnl_perror(&rtnl, "Error", rc);
 		return -1;
 	}
-	int fd = create_socket();
-	send_request(fd, argv[1]);
+	return 0;
 }
@@ -1,5 +1,12 @@
 /* unload current bpf program on interface specified in first command line
  * argument using tc and libbpf
+ *
+ * options:
+ *   -i  only remove the tc filters on the ingress hook and keep the qdisc
+ *   -e  only remove the tc filters on the egress hook and keep the qdisc
+ *   -H  handle of a single tc filter to remove, requires -P
+ *   -P  priority of a single tc filter to remove, requires -H; the filter is
+ *       removed from the ingress hook or, with -e, from the egress hook
  */
 
 /* bpf */
@@ -8,8 +15,16 @@
 /* if_nametoindex() */
 #include <net/if.h>
 
-/* detach bpf program from network interface identified by if_name */
-int detach_bpf(const char *if_name) {
+/* getopt() */
+#include <unistd.h>
+
+/* strtoul() */
+#include <stdlib.h>
+
+/* detach bpf program from network interface identified by if_name at
+ * attach_point
+ */
+int detach_bpf(const char *if_name, enum bpf_tc_attach_point attach_point) {
 	int rc;
 
 	// destroy bpf hook
@@ -20,7 +35,7 @@ int detach_bpf(const char *if_name) {
 	// specify BPF_TC_INGRESS | BPF_TC_EGRESS to delete the qdisc;
 	// specifying only BPF_TC_INGRESS or only BPF_TC_EGRESS
 	// deletes the respective filter only
-	hook.attach_point	= BPF_TC_INGRESS | BPF_TC_EGRESS;
+	hook.attach_point	= attach_point;
 	rc = bpf_tc_hook_destroy(&hook);
 	if (rc) {
 		printf("Error destroying tc hook\n");
@@ -30,15 +45,87 @@ int detach_bpf(const char *if_name) {
 	return 0;
 }
 
+/* detach single tc filter with handle and priority from network interface
+ * identified by if_name at attach_point
+ */
+int detach_filter(const char *if_name, enum bpf_tc_attach_point attach_point,
+		  __u32 handle, __u32 priority) {
+	int rc;
+
+	// get bpf hook
+	struct bpf_tc_hook hook;
+	memset(&hook, 0, sizeof(hook));
+	hook.sz			= sizeof(struct bpf_tc_hook);
+	hook.ifindex		= if_nametoindex(if_name);
+	hook.attach_point	= attach_point;
+
+	// detach bpf program
+	struct bpf_tc_opts opts;
+	memset(&opts, 0, sizeof(opts));
+	opts.sz		= sizeof(struct bpf_tc_opts);
+	opts.handle	= handle;
+	opts.priority	= priority;
+	rc = bpf_tc_detach(&hook, &opts);
+	if (rc) {
+		printf("Error during tc detach\n");
+		return rc;
+	}
+
+	return 0;
+}
+
 int main(int argc, char **argv) {
 	/* handle command line arguments */
-	if (argc < 2) {
+	int attach_point = 0;
+	__u32 handle = 0;
+	__u32 priority = 0;
+	int opt;
+	while ((opt = getopt(argc, argv, "ieH:P:")) != -1) {
+		switch (opt) {
+		case 'i':
+			attach_point |= BPF_TC_INGRESS;
+			break;
+		case 'e':
+			attach_point |= BPF_TC_EGRESS;
+			break;
+		case 'H':
+			handle = strtoul(optarg, NULL, 0);
+			break;
+		case 'P':
+			priority = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			return -1;
+		}
+	}
+	if (argc - optind < 1) {
 		return -1;
 	}
-	const char *if_name = argv[1];
+	const char *if_name = argv[optind];
+
+	/* detach single tc filter */
+	if (handle || priority) {
+		if (!handle || !priority) {
+			printf("Error: detaching a filter needs handle and "
+			       "priority\n");
+			return -1;
+		}
+		if (attach_point != BPF_TC_EGRESS) {
+			attach_point = BPF_TC_INGRESS;
+		}
+		if (detach_filter(if_name, attach_point, handle, priority)) {
+			printf("Error detaching bpf program\n");
+			return -1;
+		}
+		return 0;
+	}
+
+	if (!attach_point) {
+		attach_point = BPF_TC_INGRESS | BPF_TC_EGRESS;
+	}
 
 	/* detach bpf program */
-	if (detach_bpf(if_name)) {
+	if (detach_bpf(if_name, attach_point)) {
 		printf("Error detaching bpf program\n");
 		return -1;
 	}
@@ -0,0 +1,214 @@
+/* bpf */
+#include <linux/bpf.h>
+#include <bpf/bpf_helpers.h>
+
+/* tc */
+#include <linux/pkt_cls.h>
+
+/* ethernet */
+#include <linux/if_ether.h>
+
+/* ipv4 */
+#include <linux/ip.h>
+
+/* ipv6 */
+#include <linux/ipv6.h>
+
+/* tcp */
+#include <linux/tcp.h>
+
+/* udp */
+#include <linux/udp.h>
+
+/* htons */
+#include <arpa/inet.h>
+
+/* set license to gpl */
+char _license[] SEC("license") = "GPL";
+
+/* nanoseconds per second */
+#define NSEC_PER_SEC 1000000000ULL
+
+/* default rate in bytes per second and horizon per flow */
+#define DEFAULT_RATE (1000000000ULL / 8)
+#define DEFAULT_HORIZON_NS (2 * NSEC_PER_SEC)
+
+/* indexes in edt_stats */
+enum {
+	STATS_PASSED,
+	STATS_DELAYED,
+	STATS_DROPPED,
+	NUM_STATS,
+};
+
+/* rate limit configuration; zero values select the defaults */
+struct config {
+	__u64 rate;		/* bytes per second per flow */
+	__u64 horizon_ns;	/* maximum departure delay before dropping */
+};
+
+/* flow key, ipv4 addresses only use the first word */
+struct flow {
+	__u32 saddr[4];
+	__u32 daddr[4];
+	__be16 sport;
+	__be16 dport;
+	__u8 proto;
+	__u8 pad[3];
+};
+
+/* map for rate limit configuration */
+struct {
+	__uint(type, BPF_MAP_TYPE_ARRAY);
+	__type(key, __u32);
+	__type(value, struct config);
+	__uint(max_entries, 1);
+} edt_config SEC(".maps");
+
+/* map of earliest departure time of the next packet per flow in ns; lru, so
+ * idle flows are evicted
+ */
+struct {
+	__uint(type, BPF_MAP_TYPE_LRU_HASH);
+	__type(key, struct flow);
+	__type(value, __u64);
+	__uint(max_entries, 65536);
+} edt_flows SEC(".maps");
+
+/* map for number of passed, delayed and dropped packets */
+struct {
+	__uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+	__type(key, __u32);
+	__type(value, long);
+	__uint(max_entries, NUM_STATS);
+} edt_stats SEC(".maps");
+
+/* count packet in stats */
+static __always_inline int count(__u32 key, int action)
+{
+	long *value;
+
+	value = bpf_map_lookup_elem(&edt_stats, &key);
+	if (value) {
+		*value += 1;
+	}
+
+	return action;
+}
+
+/* get flow of packet, return 0 if it is not ipv4/ipv6 */
+static __always_inline int get_flow(struct __sk_buff *skb, struct flow *flow)
+{
+	void *data_end = (void *)(long)skb->data_end;
+	void *data = (void *)(long)skb->data;
+	struct ipv6hdr *ipv6;
+	struct iphdr *ipv4;
+	struct tcphdr *tcp;
+	struct udphdr *udp;
+	void *l4;
+
+	/* get addresses and protocol */
+	if (skb->protocol == htons(ETH_P_IP)) {
+		ipv4 = data + sizeof(struct ethhdr);
+		if ((void *) (ipv4 + 1) > data_end || ipv4->ihl < 5) {
+			return 0;
+		}
+		flow->saddr[0] = ipv4->saddr;
+		flow->daddr[0] = ipv4->daddr;
+		flow->proto = ipv4->protocol;
+		l4 = (void *) ipv4 + ipv4->ihl * 4;
+	} else if (skb->protocol == htons(ETH_P_IPV6)) {
+		ipv6 = data + sizeof(struct ethhdr);
+		if ((void *) (ipv6 + 1) > data_end) {
+			return 0;
+		}
+		__builtin_memcpy(flow->saddr, &ipv6->saddr,
+				 sizeof(flow->saddr));
+		__builtin_memcpy(flow->daddr, &ipv6->daddr,
+				 sizeof(flow->daddr));
+		flow->proto = ipv6->nexthdr;
+		l4 = (void *) (ipv6 + 1);
+	} else {
+		return 0;
+	}
+
+	/* get tcp/udp ports, other protocols share a flow per address pair */
+	if (flow->proto == IPPROTO_TCP) {
+		tcp = l4;
+		if ((void *) (tcp + 1) <= data_end) {
+			flow->sport = tcp->source;
+			flow->dport = tcp->dest;
+		}
+	} else if (flow->proto == IPPROTO_UDP) {
+		udp = l4;
+		if ((void *) (udp + 1) <= data_end) {
+			flow->sport = udp->source;
+			flow->dport = udp->dest;
+		}
+	}
+
+	return 1;
+}
+
+/* rate limit egress flows by setting the earliest departure time of their
+ * packets, which the fq qdisc enforces; updates of a flow from multiple cpus
+ * may race, which only makes the limit approximate
+ */
+SEC("tc")
+int _edt(struct __sk_buff *skb)
+{
+	__u64 horizon_ns = DEFAULT_HORIZON_NS;
+	__u64 now = bpf_ktime_get_ns();
+	__u64 rate = DEFAULT_RATE;
+	struct config *config;
+	struct flow flow = {};
+	__u64 delay_ns;
+	__u64 tstamp;
+	__u64 *next;
+	__u32 key = 0;
+
+	/* get configuration */
+	config = bpf_map_lookup_elem(&edt_config, &key);
+	if (config && config->rate) {
+		rate = config->rate;
+	}
+	if (config && config->horizon_ns) {
+		horizon_ns = config->horizon_ns;
+	}
+
+	/* get flow of packet */
+	if (!get_flow(skb, &flow)) {
+		return count(STATS_PASSED, TC_ACT_OK);
+	}
+
+	/* transmission time of packet at rate */
+	delay_ns = (__u64) skb->len * NSEC_PER_SEC / rate;
+
+	/* packet may already have a departure time, e.g., set by tcp pacing */
+	tstamp = skb->tstamp;
+	if (tstamp < now) {
+		tstamp = now;
+	}
+
+	/* first packet of flow or flow below rate departs immediately */
+	next = bpf_map_lookup_elem(&edt_flows, &flow);
+	if (!next) {
+		__u64 new = tstamp + delay_ns;
+		bpf_map_update_elem(&edt_flows, &flow, &new, BPF_ANY);
+		return count(STATS_PASSED, TC_ACT_OK);
+	}
+	if (*next <= tstamp) {
+		*next = tstamp + delay_ns;
+		return count(STATS_PASSED, TC_ACT_OK);
+	}
+
+	/* drop packets too far in the future instead of queuing them */
+	if (*next - now > horizon_ns) {
+		return count(STATS_DROPPED, TC_ACT_SHOT);
+	}
+
+	/* delay packet until departure time of flow */
+	skb->tstamp = *next;
+	*next += delay_ns;
+	return count(STATS_DELAYED, TC_ACT_OK);
+}
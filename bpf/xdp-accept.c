@@ -6,7 +6,7 @@
 char _license[] SEC("license") = "GPL";
 
 /* accept all packets */
-SEC("accept_all")
+SEC("xdp")
 int _accept_all(struct xdp_md *ctx)
 {
 	return XDP_PASS;
@@ -1,8 +1,28 @@
 /* load xdp program in bpf elf file specified in first command line argument
- * and attach it to interface specified in second command line argument
+ * and attach it to the interfaces specified in the remaining command line
+ * arguments; interfaces can be given as names or as glob patterns, e.g.,
+ * "veth*", and all of them share the same loaded program and maps
+ *
+ * options:
+ *   -p  pin program and maps in /sys/fs/bpf/<ifname>/ and reuse maps that
+ *       are already pinned there, e.g., to keep counters across reloads;
+ *       maps are reused from the directory of the first interface
+ *   -l  attach program with a bpf link pinned as /sys/fs/bpf/<ifname>/xdp_link
+ *       instead of netlink; if the link already exists, atomically update it
+ *       to the new program
+ *   -v  set verifier log level (1: basic, 2: verbose, 4: statistics) and
+ *       print the verifier log to stderr; on errors, it is always printed
+ *   -s  print load statistics of the program as key=value pairs: load time
+ *       in ns, number of verified instructions, translated and jited size
+ *
+ * without -l, a program already attached to the interface is atomically
+ * replaced with XDP_FLAGS_REPLACE in the mode it is attached in. Otherwise,
+ * the program is attached in driver mode if supported by the interface and
+ * in generic mode otherwise; other errors do not fall back to generic mode.
  */
 
 /* bpf */
+#include <bpf/bpf.h>
 #include <bpf/libbpf.h>
 
 /* XDP_FLAGS_* */
@@ -11,32 +31,430 @@
 /* if_nametoindex() */
 #include <net/if.h>
 
-int main(int argc, char **argv) {
-	if (argc < 3) {
+/* getopt(), unlink(), close() */
+#include <unistd.h>
+
+/* mkdir() */
+#include <sys/stat.h>
+
+/* errno */
+#include <errno.h>
+
+/* PATH_MAX */
+#include <limits.h>
+
+/* fnmatch() */
+#include <fnmatch.h>
+
+/* clock_gettime() */
+#include <time.h>
+
+/* atoi(), calloc() */
+#include <stdlib.h>
+
+/* strpbrk() */
+#include <string.h>
+
+/* directory in bpf file system for pinned objects of an interface */
+#define PIN_DIR "/sys/fs/bpf/%s"
+
+/* xdp attach modes in the order they are tried */
+__u32 xdp_modes[] = { XDP_FLAGS_DRV_MODE, XDP_FLAGS_SKB_MODE };
+const char *xdp_mode_names[] = { "driver", "generic" };
+
+/* size of the verifier log buffer */
+#define LOG_BUF_SIZE (16 * 1024 * 1024)
+
+/* verifier log level, see -v; on failure, the log is always printed */
+__u32 log_level = 0;
+
+/* print load statistics, see -s */
+int print_stats = 0;
+
+/* verifier log of the loaded program */
+char log_buf[LOG_BUF_SIZE];
+
+/* set pin paths of all maps in obj to pin_dir, so that loading obj reuses
+ * maps already pinned there and pins all new maps
+ */
+int set_pin_paths(struct bpf_object *obj, const char *pin_dir) {
+	char path[PATH_MAX];
+	struct bpf_map *map;
+
+	bpf_object__for_each_map(map, obj) {
+		snprintf(path, sizeof(path), "%s/%s", pin_dir,
+			 bpf_map__name(map));
+		if (bpf_map__set_pin_path(map, path)) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* pin program prog in pin_dir and replace previously pinned program */
+int pin_prog(struct bpf_program *prog, const char *pin_dir) {
+	char path[PATH_MAX];
+
+	snprintf(path, sizeof(path), "%s/xdp", pin_dir);
+	if (unlink(path) && errno != ENOENT) {
 		return -1;
 	}
+	return bpf_program__pin(prog, path);
+}
 
-	/* load bpf file */
-	struct bpf_prog_load_attr prog_load_attr = {
-		.prog_type      = BPF_PROG_TYPE_XDP,
-		.file		= argv[1],
-	};
-	struct bpf_object *obj;
-	int prog_fd;
+/* pin program and maps of the already loaded obj in pin_dir and replace
+ * objects previously pinned there, e.g., for additional interfaces
+ */
+int pin_bpf(struct bpf_object *obj, const char *pin_dir) {
+	char path[PATH_MAX];
+	struct bpf_map *map;
 
-	if (bpf_prog_load_xattr(&prog_load_attr, &obj, &prog_fd)) {
+	if (mkdir(pin_dir, 0700) && errno != EEXIST) {
+		return -1;
+	}
+	bpf_object__for_each_map(map, obj) {
+		snprintf(path, sizeof(path), "%s/%s", pin_dir,
+			 bpf_map__name(map));
+		if (unlink(path) && errno != ENOENT) {
+			return -1;
+		}
+		if (bpf_obj_pin(bpf_map__fd(map), path)) {
+			return -1;
+		}
+	}
+	return pin_prog(bpf_object__next_program(obj, NULL), pin_dir);
+}
+
+/* get current time of monotonic clock in nanoseconds */
+__u64 get_time_ns() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* print load statistics of loaded program prog as key=value pairs in a
+ * single line
+ */
+void print_load_stats(struct bpf_program *prog, __u64 load_ns) {
+	struct bpf_prog_info info;
+	__u32 info_len = sizeof(info);
+
+	memset(&info, 0, sizeof(info));
+	if (bpf_obj_get_info_by_fd(bpf_program__fd(prog), &info, &info_len)) {
+		return;
+	}
+	printf("prog=%s load_ns=%llu verified_insns=%u xlated_prog_len=%u "
+	       "jited_prog_len=%u log_len=%zu\n", bpf_program__name(prog),
+	       (unsigned long long) load_ns, info.verified_insns,
+	       info.xlated_prog_len, info.jited_prog_len, strlen(log_buf));
+}
+
+/* load xdp program from file and return bpf object; if pin_dir is set, pin
+ * program and maps in pin_dir
+ */
+struct bpf_object *load_bpf(const char *file, const char *pin_dir) {
+	/* open bpf file */
+	struct bpf_object *obj = bpf_object__open_file(file, NULL);
+	if (libbpf_get_error(obj)) {
+		printf("Error opening bpf file\n");
+		return NULL;
+	}
+
+	/* use first program in file as xdp program */
+	struct bpf_program *prog = bpf_object__next_program(obj, NULL);
+	if (!prog) {
+		printf("Error finding xdp program\n");
+		return NULL;
+	}
+	bpf_program__set_type(prog, BPF_PROG_TYPE_XDP);
+
+	/* capture verifier log */
+	bpf_program__set_log_level(prog, log_level);
+	bpf_program__set_log_buf(prog, log_buf, sizeof(log_buf));
+
+	/* reuse or pin maps in pin dir */
+	if (pin_dir) {
+		if (mkdir(pin_dir, 0700) && errno != EEXIST) {
+			printf("Error creating pin directory\n");
+			return NULL;
+		}
+		if (set_pin_paths(obj, pin_dir)) {
+			printf("Error setting map pin paths\n");
+			return NULL;
+		}
+	}
+
+	/* load xdp program and its maps into the kernel */
+	__u64 start_ns = get_time_ns();
+	int err = bpf_object__load(obj);
+	__u64 load_ns = get_time_ns() - start_ns;
+	if (err || log_level) {
+		fprintf(stderr, "%s", log_buf);
+	}
+	if (err) {
 		printf("Error loading xdp program\n");
+		return NULL;
+	}
+	if (print_stats) {
+		print_load_stats(prog, load_ns);
+	}
+
+	/* pin program in pin dir */
+	if (pin_dir && pin_prog(prog, pin_dir)) {
+		printf("Error pinning xdp program\n");
+		return NULL;
+	}
+
+	return obj;
+}
+
+/* get id of program attached to interface in xdp mode, 0 if none */
+__u32 get_attached_prog(int ifindex, __u32 mode) {
+	LIBBPF_OPTS(bpf_xdp_query_opts, opts);
+
+	if (bpf_xdp_query(ifindex, 0, &opts)) {
+		return 0;
+	}
+	if (mode == XDP_FLAGS_DRV_MODE) {
+		return opts.drv_prog_id;
+	}
+	return opts.skb_prog_id;
+}
+
+/* get name of mode the xdp program on interface is attached in */
+const char *get_attach_mode(int ifindex) {
+	LIBBPF_OPTS(bpf_xdp_query_opts, opts);
+
+	if (bpf_xdp_query(ifindex, 0, &opts)) {
+		return "unknown";
+	}
+	switch (opts.attach_mode) {
+	case XDP_ATTACHED_DRV:
+		return "driver";
+	case XDP_ATTACHED_SKB:
+		return "generic";
+	case XDP_ATTACHED_HW:
+		return "offload";
+	case XDP_ATTACHED_MULTI:
+		return "multi";
+	default:
+		return "none";
+	}
+}
+
+/* get index of the xdp mode a program is attached in, 0 if none */
+int get_attached_mode(int ifindex) {
+	for (int i = 0; i < sizeof(xdp_modes) / sizeof(xdp_modes[0]); i++) {
+		if (get_attached_prog(ifindex, xdp_modes[i])) {
+			return i;
+		}
+	}
+
+	return 0;
+}
+
+/* attach program to interface with netlink in the first supported xdp mode
+ * and atomically replace the program already attached in this mode
+ */
+int attach_xdp(int ifindex, int prog_fd) {
+	int num_modes = sizeof(xdp_modes) / sizeof(xdp_modes[0]);
+	int rc = -1;
+
+	/* an attached program can only be replaced in its own mode */
+	for (int i = get_attached_mode(ifindex); i < num_modes; i++) {
+		LIBBPF_OPTS(bpf_xdp_attach_opts, opts);
+		__u32 xdp_flags = xdp_modes[i];
+
+		/* replace only the program we expect to be attached */
+		__u32 old_prog_id = get_attached_prog(ifindex, xdp_modes[i]);
+		if (old_prog_id) {
+			opts.old_prog_fd = bpf_prog_get_fd_by_id(old_prog_id);
+			if (opts.old_prog_fd < 0) {
+				return -1;
+			}
+			xdp_flags |= XDP_FLAGS_REPLACE;
+		}
+
+		rc = bpf_xdp_attach(ifindex, prog_fd, xdp_flags, &opts);
+		if (old_prog_id) {
+			close(opts.old_prog_fd);
+		}
+		if (!rc) {
+			if (old_prog_id) {
+				printf("Replaced xdp program %u on "
+				       "ifindex %d\n", old_prog_id, ifindex);
+			}
+			return 0;
+		}
+
+		/* fall back to the next mode only if the interface does not
+		 * support this one; other errors, e.g., EEXIST or EBUSY if
+		 * the attached program changed, are reported
+		 */
+		if (rc != -EOPNOTSUPP && rc != -EINVAL) {
+			return rc;
+		}
+		if (i + 1 < num_modes) {
+			printf("ifindex %d: %s mode not supported, trying %s "
+			       "mode\n", ifindex, xdp_mode_names[i],
+			       xdp_mode_names[i + 1]);
+		}
+	}
+
+	return rc;
+}
+
+/* attach program to interface with a bpf link pinned in pin_dir; if the
+ * link already exists, atomically update it to the program
+ */
+int attach_xdp_link(int ifindex, int prog_fd, const char *pin_dir) {
+	char path[PATH_MAX];
+	int link_fd;
+
+	/* update existing link */
+	snprintf(path, sizeof(path), "%s/xdp_link", pin_dir);
+	link_fd = bpf_obj_get(path);
+	if (link_fd >= 0) {
+		if (bpf_link_update(link_fd, prog_fd, NULL)) {
+			return -1;
+		}
+		printf("Updated xdp link on ifindex %d\n", ifindex);
+		return 0;
+	}
+
+	/* create new link in the first supported xdp mode */
+	for (int i = 0; i < sizeof(xdp_modes) / sizeof(xdp_modes[0]); i++) {
+		LIBBPF_OPTS(bpf_link_create_opts, opts,
+			    .flags = xdp_modes[i]);
+
+		link_fd = bpf_link_create(prog_fd, ifindex, BPF_XDP, &opts);
+		if (link_fd >= 0 ||
+		    (link_fd != -EOPNOTSUPP && link_fd != -EINVAL)) {
+			break;
+		}
+	}
+	if (link_fd < 0) {
+		return -1;
+	}
+
+	/* pin link, so it outlives this process */
+	if (mkdir(pin_dir, 0700) && errno != EEXIST) {
 		return -1;
 	}
+	return bpf_obj_pin(link_fd, path);
+}
 
-	/* attach bpf program to interface */
-	int ifindex = if_nametoindex(argv[2]);
-	__u32 xdp_flags = XDP_FLAGS_DRV_MODE;
+/* get names of interfaces matching the names or glob patterns in args;
+ * returns number of interfaces or -1 on error
+ */
+int get_interfaces(char **args, int num_args, const char ***if_names) {
+	struct if_nameindex *ifs = if_nameindex();
+	int num_ifs = 0;
+	int num = 0;
 
-	if (bpf_set_link_xdp_fd(ifindex, prog_fd, xdp_flags) < 0) {
-		printf("Error attaching xdp program\n");
+	if (!ifs) {
+		return -1;
+	}
+	while (ifs[num_ifs].if_index) {
+		num_ifs++;
+	}
+	*if_names = calloc(num_args * (num_ifs + 1), sizeof(char *));
+	if (!*if_names) {
 		return -1;
 	}
 
-	return 0;
+	for (int i = 0; i < num_args; i++) {
+		/* plain interface name */
+		if (!strpbrk(args[i], "*?[")) {
+			(*if_names)[num++] = args[i];
+			continue;
+		}
+
+		/* glob pattern */
+		for (int j = 0; j < num_ifs; j++) {
+			if (!fnmatch(args[i], ifs[j].if_name, 0)) {
+				(*if_names)[num++] = ifs[j].if_name;
+			}
+		}
+	}
+
+	return num;
+}
+
+int main(int argc, char **argv) {
+	/* handle command line arguments */
+	int pin = 0;
+	int link = 0;
+	int opt;
+	while ((opt = getopt(argc, argv, "plv:s")) != -1) {
+		switch (opt) {
+		case 'p':
+			pin = 1;
+			break;
+		case 'l':
+			link = 1;
+			break;
+		case 'v':
+			log_level = atoi(optarg);
+			break;
+		case 's':
+			print_stats = 1;
+			break;
+		default:
+			return -1;
+		}
+	}
+	if (argc - optind < 2) {
+		return -1;
+	}
+	const char *bpf_file = argv[optind];
+
+	/* get interfaces */
+	const char **if_names;
+	int num_ifs = get_interfaces(argv + optind + 1, argc - optind - 1,
+				     &if_names);
+	if (num_ifs <= 0) {
+		printf("Error finding interfaces\n");
+		return -1;
+	}
+
+	/* get pin directory of first interface */
+	char pin_dir[PATH_MAX];
+	snprintf(pin_dir, sizeof(pin_dir), PIN_DIR, if_names[0]);
+
+	/* load bpf program once for all interfaces */
+	struct bpf_object *obj = load_bpf(bpf_file, pin ? pin_dir : NULL);
+	if (!obj) {
+		return -1;
+	}
+	int prog_fd = bpf_program__fd(bpf_object__next_program(obj, NULL));
+
+	/* attach bpf program to all interfaces */
+	int errors = 0;
+	for (int i = 0; i < num_ifs; i++) {
+		int ifindex = if_nametoindex(if_names[i]);
+		int rc;
+
+		/* pin program and maps also in directory of interface */
+		snprintf(pin_dir, sizeof(pin_dir), PIN_DIR, if_names[i]);
+		if (ifindex == 0 || (pin && i > 0 && pin_bpf(obj, pin_dir))) {
+			rc = -1;
+		} else if (link) {
+			rc = attach_xdp_link(ifindex, prog_fd, pin_dir);
+		} else {
+			rc = attach_xdp(ifindex, prog_fd);
+		}
+		if (rc) {
+			printf("%s: Error attaching xdp program\n",
+			       if_names[i]);
+			errors++;
+			continue;
+		}
+		printf("%s: Attached xdp program in %s mode\n", if_names[i],
+		       get_attach_mode(ifindex));
+	}
+
+	return errors ? -1 : 0;
 }
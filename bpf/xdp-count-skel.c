@@ -0,0 +1,77 @@
+/* load xdp program in xdp-count.o with its bpftool-generated skeleton, attach
+ * it to interface specified in first command line argument and print the
+ * packet count read from the memory-mapped rx_count map every second
+ */
+
+/* bpf */
+#include <bpf/libbpf.h>
+
+/* skeleton generated with: bpftool gen skeleton xdp-count.o */
+#include "xdp-count.skel.h"
+
+/* XDP_FLAGS_* */
+#include <linux/if_link.h>
+
+/* if_nametoindex() */
+#include <net/if.h>
+
+/* mmap() */
+#include <sys/mman.h>
+
+/* sleep() */
+#include <unistd.h>
+
+/* per-cpu counter in rx_count, see xdp-count.c */
+struct counter {
+	long value;
+	long pad[7];
+};
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		return -1;
+	}
+
+	/* open and load bpf program and its maps */
+	struct xdp_count *skel = xdp_count__open_and_load();
+	if (!skel) {
+		printf("Error loading xdp program\n");
+		return -1;
+	}
+
+	/* attach bpf program to interface */
+	int ifindex = if_nametoindex(argv[1]);
+	int prog_fd = bpf_program__fd(skel->progs._count_pkts);
+	__u32 xdp_flags = XDP_FLAGS_DRV_MODE;
+
+	if (bpf_xdp_attach(ifindex, prog_fd, xdp_flags, NULL) < 0) {
+		printf("Error attaching xdp program\n");
+		xdp_count__destroy(skel);
+		return -1;
+	}
+
+	/* map counters into our address space, rx_count is BPF_F_MMAPABLE */
+	int map_fd = bpf_map__fd(skel->maps.rx_count);
+	int num_cpus = bpf_map__max_entries(skel->maps.rx_count);
+	volatile struct counter *counters = mmap(NULL, num_cpus *
+						 sizeof(struct counter),
+						 PROT_READ, MAP_SHARED,
+						 map_fd, 0);
+	if (counters == MAP_FAILED) {
+		printf("Error mapping rx_count\n");
+		xdp_count__destroy(skel);
+		return -1;
+	}
+
+	/* print sum of per-cpu counters without a bpf() syscall per read */
+	while (1) {
+		long count = 0;
+		for (int i = 0; i < num_cpus; i++) {
+			count += counters[i].value;
+		}
+		printf("%ld\n", count);
+		sleep(1);
+	}
+
+	return 0;
+}
@@ -11,16 +11,51 @@
 /* if_nametoindex() */
 #include <net/if.h>
 
+/* unlink() */
+#include <unistd.h>
+
+/* PATH_MAX */
+#include <limits.h>
+
+/* bpf link pinned by xdp-attach -l */
+#define LINK_PATH "/sys/fs/bpf/%s/xdp_link"
+
+/* get xdp flags for the mode the xdp program on interface is attached in */
+__u32 get_xdp_flags(int ifindex) {
+	LIBBPF_OPTS(bpf_xdp_query_opts, opts);
+
+	if (bpf_xdp_query(ifindex, 0, &opts)) {
+		return 0;
+	}
+	switch (opts.attach_mode) {
+	case XDP_ATTACHED_SKB:
+		return XDP_FLAGS_SKB_MODE;
+	case XDP_ATTACHED_HW:
+		return XDP_FLAGS_HW_MODE;
+	default:
+		return XDP_FLAGS_DRV_MODE;
+	}
+}
+
 int main(int argc, char **argv) {
 	if (argc < 2) {
 		return -1;
 	}
 
+	/* remove pinned bpf link, which detaches the program with the last
+	 * reference to the link
+	 */
+	char link_path[PATH_MAX];
+	snprintf(link_path, sizeof(link_path), LINK_PATH, argv[1]);
+	if (!unlink(link_path)) {
+		return 0;
+	}
+
 	int ifindex = if_nametoindex(argv[1]);
-	__u32 xdp_flags = XDP_FLAGS_DRV_MODE;
+	__u32 xdp_flags = get_xdp_flags(ifindex);
 
 	/* detach bpf program from interface */
-	if (bpf_set_link_xdp_fd(ifindex, -1, xdp_flags)) {
+	if (bpf_xdp_detach(ifindex, xdp_flags, NULL)) {
 		printf("Error removing xdp program\n");
 		return -1;
 	}
@@ -0,0 +1,366 @@
+/* configure the xdp load balancer xdp-lb attached with "xdp-attach -p" on
+ * interface specified in first command line argument: add the virtual service
+ * with address, port and protocol (tcp or udp) specified in the second, third
+ * and fourth command line arguments and set the backends to the ones in the
+ * remaining command line arguments, each specified as "<ip>,<mac>,<ifname>",
+ * e.g.:
+ *
+ *   xdp-lb-ctl eth0 10.0.0.1 80 tcp 10.0.1.1,02:00:00:00:01:01,eth1 ...
+ *
+ * the lookup table is built with maglev consistent hashing, so changing the
+ * backends only moves flows from removed to remaining backends and from
+ * remaining to added backends; backends keep their index and only changed
+ * table entries are written; backends are sorted by address first, so load
+ * balancers with the same backends in any order build the same table
+ */
+
+/* bpf */
+#include <bpf/bpf.h>
+
+/* mmap() */
+#include <sys/mman.h>
+
+/* inet_pton(), htons(), ntohl() */
+#include <arpa/inet.h>
+
+/* if_nametoindex(), struct ifreq */
+#include <net/if.h>
+
+/* ioctl(), SIOCGIFHWADDR */
+#include <sys/ioctl.h>
+
+/* socket() */
+#include <sys/socket.h>
+
+/* close() */
+#include <unistd.h>
+
+/* IPPROTO_* */
+#include <netinet/in.h>
+
+/* ETH_ALEN */
+#include <linux/if_ether.h>
+
+/* atoi(), malloc(), qsort() */
+#include <stdlib.h>
+
+/* memset(), memcpy(), strcmp(), strtok(), strncpy() */
+#include <string.h>
+
+/* printf(), sscanf() */
+#include <stdio.h>
+
+/* PATH_MAX */
+#include <limits.h>
+
+/* directory in bpf file system for pinned objects of an interface */
+#define PIN_DIR "/sys/fs/bpf/%s"
+
+/* size of the consistent hashing lookup table, must match xdp-lb.c */
+#define LB_TABLE_SIZE 65537
+
+/* maximum number of backends, must match xdp-lb.c */
+#define MAX_BACKENDS 256
+
+/* empty lookup table entry while building the table */
+#define EMPTY 0xffffffff
+
+/* virtual service, see xdp-lb.c */
+struct vip {
+	__be32 addr;
+	__be16 port;
+	__u8 proto;
+	__u8 pad;
+};
+
+/* backend server, see xdp-lb.c */
+struct backend {
+	__be32 addr;
+	__u8 mac[ETH_ALEN];
+	__u8 src_mac[ETH_ALEN];
+	__u32 ifindex;
+};
+
+/* file descriptors of pinned maps */
+int vips_fd;
+int lb_table_fd;
+int backends_fd;
+int tx_ports_fd;
+
+/* open map pinned in pin_dir with name */
+int open_map(const char *pin_dir, const char *name) {
+	char path[PATH_MAX];
+
+	snprintf(path, sizeof(path), "%s/%s", pin_dir, name);
+	return bpf_obj_get(path);
+}
+
+/* get mac address of interface if_name */
+int get_if_mac(const char *if_name, __u8 *mac) {
+	struct ifreq ifr;
+	int rc;
+
+	int fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if (fd < 0) {
+		return -1;
+	}
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, if_name, IF_NAMESIZE - 1);
+	rc = ioctl(fd, SIOCGIFHWADDR, &ifr);
+	close(fd);
+	if (rc) {
+		return -1;
+	}
+	memcpy(mac, ifr.ifr_hwaddr.sa_data, ETH_ALEN);
+
+	return 0;
+}
+
+/* parse backend in format "<ip>,<mac>,<ifname>" */
+int parse_backend(char *arg, struct backend *backend) {
+	char *addr = strtok(arg, ",");
+	char *mac = strtok(NULL, ",");
+	char *if_name = strtok(NULL, ",");
+
+	memset(backend, 0, sizeof(*backend));
+	if (!addr || !mac || !if_name) {
+		return -1;
+	}
+	if (inet_pton(AF_INET, addr, &backend->addr) != 1) {
+		return -1;
+	}
+	if (sscanf(mac, "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx", &backend->mac[0],
+		   &backend->mac[1], &backend->mac[2], &backend->mac[3],
+		   &backend->mac[4], &backend->mac[5]) != ETH_ALEN) {
+		return -1;
+	}
+	backend->ifindex = if_nametoindex(if_name);
+	if (!backend->ifindex) {
+		return -1;
+	}
+	return get_if_mac(if_name, backend->src_mac);
+}
+
+/* compare backends by address for qsort() */
+int compare_backends(const void *a, const void *b) {
+	__u32 addr_a = ntohl(((const struct backend *) a)->addr);
+	__u32 addr_b = ntohl(((const struct backend *) b)->addr);
+
+	return addr_a < addr_b ? -1 : addr_a > addr_b;
+}
+
+/* assign a backend index to each backend, reuse indexes of backends that are
+ * already in the backends map; mark indexes of removed backends in removed
+ */
+int assign_slots(struct backend *backends, int num, __u32 *slots,
+		 int *removed) {
+	struct backend old[MAX_BACKENDS];
+	int used[MAX_BACKENDS] = { 0 };
+
+	/* read current backends */
+	for (__u32 i = 0; i < MAX_BACKENDS; i++) {
+		if (bpf_map_lookup_elem(backends_fd, &i, &old[i])) {
+			return -1;
+		}
+		removed[i] = old[i].addr != 0;
+	}
+
+	/* keep indexes of existing backends */
+	for (int i = 0; i < num; i++) {
+		slots[i] = EMPTY;
+		for (int j = 0; j < MAX_BACKENDS; j++) {
+			if (old[j].addr == backends[i].addr && !used[j]) {
+				slots[i] = j;
+				used[j] = 1;
+				removed[j] = 0;
+				break;
+			}
+		}
+	}
+
+	/* use free indexes for new backends */
+	for (int i = 0; i < num; i++) {
+		for (int j = 0; j < MAX_BACKENDS && slots[i] == EMPTY; j++) {
+			if (!used[j] && !old[j].addr) {
+				slots[i] = j;
+				used[j] = 1;
+			}
+		}
+		if (slots[i] == EMPTY) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* murmur3 fmix32 hash function */
+__u32 hash(__u32 value, __u32 seed) {
+	value ^= seed;
+	value ^= value >> 16;
+	value *= 0x85ebca6b;
+	value ^= value >> 13;
+	value *= 0xc2b2ae35;
+	value ^= value >> 16;
+	return value;
+}
+
+/* build maglev lookup table with backend indexes in slots */
+void build_table(__u32 *table, struct backend *backends, __u32 *slots,
+		 int num) {
+	__u64 offset[MAX_BACKENDS];
+	__u64 skip[MAX_BACKENDS];
+	__u64 next[MAX_BACKENDS];
+	int filled = 0;
+
+	/* each backend's preference list is a permutation of all entries
+	 * derived from its address only, independent of other backends
+	 */
+	for (int i = 0; i < num; i++) {
+		offset[i] = hash(backends[i].addr, 0x5bd1e995) % LB_TABLE_SIZE;
+		skip[i] = hash(backends[i].addr, 0x1b873593) %
+			(LB_TABLE_SIZE - 1) + 1;
+		next[i] = 0;
+	}
+
+	/* backends take turns claiming their next preferred empty entry */
+	memset(table, 0xff, LB_TABLE_SIZE * sizeof(__u32));
+	while (1) {
+		for (int i = 0; i < num; i++) {
+			__u64 c = (offset[i] + next[i] * skip[i]) %
+				LB_TABLE_SIZE;
+			while (table[c] != EMPTY) {
+				next[i]++;
+				c = (offset[i] + next[i] * skip[i]) %
+					LB_TABLE_SIZE;
+			}
+			table[c] = slots[i];
+			next[i]++;
+			if (++filled == LB_TABLE_SIZE) {
+				return;
+			}
+		}
+	}
+}
+
+/* write entries of table that differ from the lookup table map, return
+ * number of changed entries
+ */
+int write_table(__u32 *table) {
+	volatile __u32 *lb_table = mmap(NULL, LB_TABLE_SIZE * sizeof(__u32),
+					PROT_READ | PROT_WRITE, MAP_SHARED,
+					lb_table_fd, 0);
+	int changed = 0;
+
+	if (lb_table == MAP_FAILED) {
+		return -1;
+	}
+	for (int i = 0; i < LB_TABLE_SIZE; i++) {
+		if (lb_table[i] != table[i]) {
+			lb_table[i] = table[i];
+			changed++;
+		}
+	}
+	munmap((void *) lb_table, LB_TABLE_SIZE * sizeof(__u32));
+
+	return changed;
+}
+
+int main(int argc, char **argv) {
+	/* handle command line arguments */
+	if (argc < 6) {
+		return -1;
+	}
+	const char *if_name = argv[1];
+	struct vip vip;
+	memset(&vip, 0, sizeof(vip));
+	if (inet_pton(AF_INET, argv[2], &vip.addr) != 1) {
+		printf("Error parsing virtual service address\n");
+		return -1;
+	}
+	vip.port = htons(atoi(argv[3]));
+	vip.proto = strcmp(argv[4], "udp") ? IPPROTO_TCP : IPPROTO_UDP;
+	int num = argc - 5;
+	if (num > MAX_BACKENDS) {
+		printf("Error: too many backends\n");
+		return -1;
+	}
+	struct backend backends[MAX_BACKENDS];
+	for (int i = 0; i < num; i++) {
+		if (parse_backend(argv[5 + i], &backends[i])) {
+			printf("Error parsing backend %s\n", argv[5 + i]);
+			return -1;
+		}
+	}
+
+	/* the order of the backends determines the lookup table, so use the
+	 * same order on all load balancers
+	 */
+	qsort(backends, num, sizeof(backends[0]), compare_backends);
+
+	/* open pinned maps */
+	char pin_dir[PATH_MAX];
+	snprintf(pin_dir, sizeof(pin_dir), PIN_DIR, if_name);
+	vips_fd = open_map(pin_dir, "vips");
+	lb_table_fd = open_map(pin_dir, "lb_table");
+	backends_fd = open_map(pin_dir, "backends");
+	tx_ports_fd = open_map(pin_dir, "tx_ports");
+	if (vips_fd < 0 || lb_table_fd < 0 || backends_fd < 0 ||
+	    tx_ports_fd < 0) {
+		printf("Error opening pinned maps\n");
+		return -1;
+	}
+
+	/* assign backend indexes */
+	__u32 slots[MAX_BACKENDS];
+	int removed[MAX_BACKENDS];
+	if (assign_slots(backends, num, slots, removed)) {
+		printf("Error assigning backend indexes\n");
+		return -1;
+	}
+
+	/* add backends before they appear in the lookup table */
+	for (int i = 0; i < num; i++) {
+		if (bpf_map_update_elem(backends_fd, &slots[i], &backends[i],
+					BPF_ANY) ||
+		    bpf_map_update_elem(tx_ports_fd, &slots[i],
+					&backends[i].ifindex, BPF_ANY)) {
+			printf("Error adding backend %d\n", i);
+			return -1;
+		}
+	}
+
+	/* rebuild lookup table */
+	__u32 *table = malloc(LB_TABLE_SIZE * sizeof(__u32));
+	if (!table) {
+		return -1;
+	}
+	build_table(table, backends, slots, num);
+	int changed = write_table(table);
+	if (changed < 0) {
+		printf("Error writing lookup table\n");
+		return -1;
+	}
+	printf("Changed %d of %d lookup table entries\n", changed,
+	       LB_TABLE_SIZE);
+
+	/* remove backends after they disappeared from the lookup table */
+	struct backend none;
+	memset(&none, 0, sizeof(none));
+	for (__u32 i = 0; i < MAX_BACKENDS; i++) {
+		if (!removed[i]) {
+			continue;
+		}
+		bpf_map_update_elem(backends_fd, &i, &none, BPF_ANY);
+		bpf_map_delete_elem(tx_ports_fd, &i);
+	}
+
+	/* add virtual service */
+	__u32 value = 0;
+	if (bpf_map_update_elem(vips_fd, &vip, &value, BPF_ANY)) {
+		printf("Error adding virtual service\n");
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,224 @@
+/* bpf */
+#include <linux/bpf.h>
+#include <bpf/bpf_helpers.h>
+
+/* ethernet */
+#include <linux/if_ether.h>
+
+/* ipv4 */
+#include <linux/ip.h>
+
+/* tcp */
+#include <linux/tcp.h>
+
+/* udp */
+#include <linux/udp.h>
+
+/* htons */
+#include <arpa/inet.h>
+
+/* set license to gpl */
+char _license[] SEC("license") = "GPL";
+
+/* size of the consistent hashing lookup table, must be prime and match
+ * xdp-lb-ctl
+ */
+#define LB_TABLE_SIZE 65537
+
+/* maximum number of backends */
+#define MAX_BACKENDS 256
+
+/* ipv4 fragment flags and offset in frag_off */
+#define IP_MF 0x2000
+#define IP_OFFSET 0x1fff
+
+/* virtual service, address and port in network byte order */
+struct vip {
+	__be32 addr;
+	__be16 port;
+	__u8 proto;
+	__u8 pad;
+};
+
+/* backend server, address in network byte order; packets are sent to mac
+ * from src_mac, the mac of egress device ifindex
+ */
+struct backend {
+	__be32 addr;
+	__u8 mac[ETH_ALEN];
+	__u8 src_mac[ETH_ALEN];
+	__u32 ifindex;
+};
+
+/* map of virtual services that are load balanced */
+struct {
+	__uint(type, BPF_MAP_TYPE_HASH);
+	__type(key, struct vip);
+	__type(value, __u32);
+	__uint(max_entries, 1024);
+} vips SEC(".maps");
+
+/* maglev lookup table from flow hash to backend index, written by
+ * xdp-lb-ctl via mmap
+ */
+struct {
+	__uint(type, BPF_MAP_TYPE_ARRAY);
+	__uint(map_flags, BPF_F_MMAPABLE);
+	__type(key, __u32);
+	__type(value, __u32);
+	__uint(max_entries, LB_TABLE_SIZE);
+} lb_table SEC(".maps");
+
+/* map of backends, index is backend index */
+struct {
+	__uint(type, BPF_MAP_TYPE_ARRAY);
+	__type(key, __u32);
+	__type(value, struct backend);
+	__uint(max_entries, MAX_BACKENDS);
+} backends SEC(".maps");
+
+/* map of egress devices of backends, index is backend index */
+struct {
+	__uint(type, BPF_MAP_TYPE_DEVMAP);
+	__type(key, __u32);
+	__type(value, __u32);
+	__uint(max_entries, MAX_BACKENDS);
+} tx_ports SEC(".maps");
+
+/* hash flow 5-tuple */
+static __always_inline __u32 hash_flow(__be32 saddr, __be32 daddr,
+				       __be16 sport, __be16 dport, __u8 proto)
+{
+	__u32 hash = saddr;
+
+	/* mix in all fields, finalize with murmur3 fmix32 */
+	hash = hash * 31 + daddr;
+	hash = hash * 31 + (((__u32) sport << 16) | dport);
+	hash = hash * 31 + proto;
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6b;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35;
+	hash ^= hash >> 16;
+
+	return hash;
+}
+
+/* incrementally update checksum in sum for 32 bit field change, see
+ * RFC 1624
+ */
+static __always_inline void csum_replace4(__u16 *sum, __be32 from, __be32 to)
+{
+	__u32 csum = (__u16) ~*sum;
+
+	csum += (__u16) ~(from >> 16) + (__u16) ~(from & 0xffff);
+	csum += (to >> 16) + (to & 0xffff);
+	csum = (csum & 0xffff) + (csum >> 16);
+	csum = (csum & 0xffff) + (csum >> 16);
+	*sum = ~csum;
+}
+
+/* load balance packets to virtual services over backends */
+SEC("xdp")
+int _load_balance(struct xdp_md *ctx)
+{
+	void *data_end = (void *)(long)ctx->data_end;
+	void *data = (void *)(long)ctx->data;
+	struct ethhdr *eth = data;
+	struct backend *backend;
+	struct iphdr *ipv4;
+	struct tcphdr *tcp;
+	struct udphdr *udp;
+	__u16 *l4_csum;
+	struct vip vip;
+	__u32 *index;
+	__u32 key;
+	void *l4;
+
+	/* check packet length for verifier */
+	if (data + sizeof(struct ethhdr) > data_end) {
+		return XDP_PASS;
+	}
+
+	/* check ipv4 */
+	if (eth->h_proto != htons(ETH_P_IP)) {
+		return XDP_PASS;
+	}
+	ipv4 = data + sizeof(struct ethhdr);
+
+	/* check packet length again for verifier */
+	if ((void *) (ipv4 + 1) > data_end || ipv4->ihl < 5) {
+		return XDP_PASS;
+	}
+
+	/* pass fragments to the stack; only the first fragment has the ports,
+	 * so the fragments of a packet cannot be hashed to the same backend
+	 */
+	if (ipv4->frag_off & htons(IP_MF | IP_OFFSET)) {
+		return XDP_PASS;
+	}
+
+	/* get tcp/udp ports of flow */
+	l4 = (void *) ipv4 + ipv4->ihl * 4;
+	__builtin_memset(&vip, 0, sizeof(vip));
+	vip.addr = ipv4->daddr;
+	vip.proto = ipv4->protocol;
+	switch (ipv4->protocol) {
+	case IPPROTO_TCP:
+		tcp = l4;
+		if ((void *) (tcp + 1) > data_end) {
+			return XDP_PASS;
+		}
+		vip.port = tcp->dest;
+		key = hash_flow(ipv4->saddr, ipv4->daddr, tcp->source,
+				tcp->dest, vip.proto);
+		l4_csum = &tcp->check;
+		break;
+	case IPPROTO_UDP:
+		udp = l4;
+		if ((void *) (udp + 1) > data_end) {
+			return XDP_PASS;
+		}
+		vip.port = udp->dest;
+		key = hash_flow(ipv4->saddr, ipv4->daddr, udp->source,
+				udp->dest, vip.proto);
+		/* udp checksum 0 means no checksum */
+		l4_csum = udp->check ? &udp->check : 0;
+		break;
+	default:
+		return XDP_PASS;
+	}
+
+	/* check virtual service */
+	if (!bpf_map_lookup_elem(&vips, &vip)) {
+		return XDP_PASS;
+	}
+
+	/* get backend of flow from lookup table */
+	key %= LB_TABLE_SIZE;
+	index = bpf_map_lookup_elem(&lb_table, &key);
+	if (!index) {
+		return XDP_PASS;
+	}
+	backend = bpf_map_lookup_elem(&backends, index);
+	if (!backend || !backend->addr) {
+		return XDP_PASS;
+	}
+
+	/* rewrite destination address and update checksums */
+	if (l4_csum) {
+		csum_replace4(l4_csum, ipv4->daddr, backend->addr);
+	}
+	csum_replace4(&ipv4->check, ipv4->daddr, backend->addr);
+	ipv4->daddr = backend->addr;
+
+	/* rewrite ethernet addresses */
+	__builtin_memcpy(eth->h_source, backend->src_mac, ETH_ALEN);
+	__builtin_memcpy(eth->h_dest, backend->mac, ETH_ALEN);
+
+	/* send packet back out on ingress device or redirect it */
+	if (backend->ifindex == ctx->ingress_ifindex) {
+		return XDP_TX;
+	}
+	return bpf_redirect_map(&tx_ports, *index, 0);
+}
@@ -0,0 +1,172 @@
+/* load xdp pipeline in bpf elf file specified in first command line argument
+ * (e.g., xdp-pipeline.o), populate its stages and attach its dispatcher to
+ * interface specified in second command line argument; the maps of the
+ * pipeline are pinned in /sys/fs/bpf/<ifname>/, so single stages can be
+ * replaced later with xdp-pipeline-swap
+ */
+
+/* bpf */
+#include <bpf/bpf.h>
+#include <bpf/libbpf.h>
+
+/* XDP_FLAGS_* */
+#include <linux/if_link.h>
+
+/* if_nametoindex() */
+#include <net/if.h>
+
+/* mkdir() */
+#include <sys/stat.h>
+
+/* errno */
+#include <errno.h>
+
+/* PATH_MAX */
+#include <limits.h>
+
+/* directory in bpf file system for pinned objects of an interface */
+#define PIN_DIR "/sys/fs/bpf/%s"
+
+/* name of dispatcher program */
+#define DISPATCHER "xdp_dispatch"
+
+/* names of stage programs, index is position in the pipeline */
+const char *stage_progs[] = {
+	"stage_parse",
+	"stage_filter",
+	"stage_count",
+	"stage_redirect",
+};
+
+/* xdp attach modes in the order they are tried */
+__u32 xdp_modes[] = { XDP_FLAGS_DRV_MODE, XDP_FLAGS_SKB_MODE };
+
+/* names of xdp attach modes */
+const char *xdp_mode_names[] = { "driver", "generic" };
+
+/* set pin paths of all maps in obj to pin_dir, so that loading obj reuses
+ * maps already pinned there and pins all new maps
+ */
+int set_pin_paths(struct bpf_object *obj, const char *pin_dir) {
+	char path[PATH_MAX];
+	struct bpf_map *map;
+
+	bpf_object__for_each_map(map, obj) {
+		snprintf(path, sizeof(path), "%s/%s", pin_dir,
+			 bpf_map__name(map));
+		if (bpf_map__set_pin_path(map, path)) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* add all stage programs in obj to the stages map */
+int populate_stages(struct bpf_object *obj) {
+	int stages_fd = bpf_object__find_map_fd_by_name(obj, "stages");
+	if (stages_fd < 0) {
+		return -1;
+	}
+
+	for (__u32 i = 0; i < sizeof(stage_progs) / sizeof(stage_progs[0]);
+	     i++) {
+		struct bpf_program *prog;
+		int prog_fd;
+
+		prog = bpf_object__find_program_by_name(obj, stage_progs[i]);
+		if (!prog) {
+			return -1;
+		}
+		prog_fd = bpf_program__fd(prog);
+		if (bpf_map_update_elem(stages_fd, &i, &prog_fd, BPF_ANY)) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* attach program to interface in the first supported xdp mode; return 0
+ * or a negative error
+ */
+int attach_xdp(int ifindex, int prog_fd) {
+	int num_modes = sizeof(xdp_modes) / sizeof(xdp_modes[0]);
+	int rc = -1;
+
+	for (int i = 0; i < num_modes; i++) {
+		rc = bpf_xdp_attach(ifindex, prog_fd, xdp_modes[i], NULL);
+		if (!rc) {
+			return 0;
+		}
+
+		/* fall back to the next mode only if the interface does not
+		 * support this one; other errors, e.g., EBUSY if a program is
+		 * attached in another mode, are reported
+		 */
+		if (rc != -EOPNOTSUPP && rc != -EINVAL) {
+			return rc;
+		}
+		if (i + 1 < num_modes) {
+			printf("ifindex %d: %s mode not supported, trying %s "
+			       "mode\n", ifindex, xdp_mode_names[i],
+			       xdp_mode_names[i + 1]);
+		}
+	}
+
+	return rc;
+}
+
+int main(int argc, char **argv) {
+	/* handle command line arguments */
+	if (argc < 3) {
+		return -1;
+	}
+	const char *bpf_file = argv[1];
+	const char *if_name = argv[2];
+
+	/* open bpf file */
+	struct bpf_object *obj = bpf_object__open_file(bpf_file, NULL);
+	if (libbpf_get_error(obj)) {
+		printf("Error opening bpf file\n");
+		return -1;
+	}
+
+	/* reuse or pin maps in pin dir of interface */
+	char pin_dir[PATH_MAX];
+	snprintf(pin_dir, sizeof(pin_dir), PIN_DIR, if_name);
+	if (mkdir(pin_dir, 0700) && errno != EEXIST) {
+		printf("Error creating pin directory\n");
+		return -1;
+	}
+	if (set_pin_paths(obj, pin_dir)) {
+		printf("Error setting map pin paths\n");
+		return -1;
+	}
+
+	/* load dispatcher, stages and maps into the kernel */
+	if (bpf_object__load(obj)) {
+		printf("Error loading xdp pipeline\n");
+		return -1;
+	}
+
+	/* add stages to pipeline */
+	if (populate_stages(obj)) {
+		printf("Error populating pipeline stages\n");
+		return -1;
+	}
+
+	/* attach dispatcher to interface */
+	struct bpf_program *prog;
+	prog = bpf_object__find_program_by_name(obj, DISPATCHER);
+	if (!prog) {
+		printf("Error finding dispatcher program\n");
+		return -1;
+	}
+	if (attach_xdp(if_nametoindex(if_name), bpf_program__fd(prog))) {
+		printf("Error attaching xdp program\n");
+		return -1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,172 @@
+/* replace a single stage of the xdp pipeline attached with xdp-pipeline-attach
+ * on interface specified in first command line argument; the stage is
+ * specified in the second command line argument (parse, filter, count,
+ * redirect or its index) and replaced with the program named in the fourth
+ * command line argument from the bpf elf file specified in the third command
+ * line argument, e.g.:
+ *
+ *   xdp-pipeline-swap eth0 filter my-filter.o my_filter
+ *
+ * options:
+ *   -d  remove the stage from the pipeline instead, so it is skipped; without
+ *       the parse stage, packets are neither filtered nor counted
+ */
+
+/* bpf */
+#include <bpf/bpf.h>
+#include <bpf/libbpf.h>
+
+/* getopt() */
+#include <unistd.h>
+
+/* atoi() */
+#include <stdlib.h>
+
+/* strcmp() */
+#include <string.h>
+
+/* PATH_MAX */
+#include <limits.h>
+
+/* directory in bpf file system for pinned objects of an interface */
+#define PIN_DIR "/sys/fs/bpf/%s"
+
+/* names of pipeline stages, index is position in the pipeline */
+const char *stage_names[] = {
+	"parse",
+	"filter",
+	"count",
+	"redirect",
+};
+
+/* get index of stage identified by name or index, -1 if invalid */
+int get_stage(const char *stage) {
+	int num_stages = sizeof(stage_names) / sizeof(stage_names[0]);
+
+	for (int i = 0; i < num_stages; i++) {
+		if (!strcmp(stage, stage_names[i])) {
+			return i;
+		}
+	}
+	if (stage[0] < '0' || stage[0] > '9' || atoi(stage) >= num_stages) {
+		return -1;
+	}
+	return atoi(stage);
+}
+
+/* set pin paths of all maps in obj to pin_dir, so that loading obj reuses
+ * maps already pinned there, e.g., the stages map of the pipeline
+ */
+int set_pin_paths(struct bpf_object *obj, const char *pin_dir) {
+	char path[PATH_MAX];
+	struct bpf_map *map;
+
+	bpf_object__for_each_map(map, obj) {
+		snprintf(path, sizeof(path), "%s/%s", pin_dir,
+			 bpf_map__name(map));
+		if (bpf_map__set_pin_path(map, path)) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* load program prog_name from file with the pinned maps in pin_dir and
+ * return program fd
+ */
+int load_stage(const char *file, const char *prog_name,
+	       const char *pin_dir) {
+	/* open bpf file */
+	struct bpf_object *obj = bpf_object__open_file(file, NULL);
+	if (libbpf_get_error(obj)) {
+		return -1;
+	}
+
+	/* only load the requested program */
+	struct bpf_program *prog;
+	struct bpf_program *stage_prog = NULL;
+	bpf_object__for_each_program(prog, obj) {
+		if (strcmp(bpf_program__name(prog), prog_name)) {
+			bpf_program__set_autoload(prog, false);
+			continue;
+		}
+		bpf_program__set_type(prog, BPF_PROG_TYPE_XDP);
+		stage_prog = prog;
+	}
+	if (!stage_prog) {
+		return -1;
+	}
+
+	/* reuse pinned maps of the pipeline */
+	if (set_pin_paths(obj, pin_dir)) {
+		return -1;
+	}
+
+	/* load program into the kernel */
+	if (bpf_object__load(obj)) {
+		return -1;
+	}
+
+	return bpf_program__fd(stage_prog);
+}
+
+int main(int argc, char **argv) {
+	/* handle command line arguments */
+	int delete = 0;
+	int opt;
+	while ((opt = getopt(argc, argv, "d")) != -1) {
+		switch (opt) {
+		case 'd':
+			delete = 1;
+			break;
+		default:
+			return -1;
+		}
+	}
+	if (argc - optind < (delete ? 2 : 4)) {
+		return -1;
+	}
+	const char *if_name = argv[optind];
+	int stage = get_stage(argv[optind + 1]);
+	if (stage < 0) {
+		printf("Error finding stage\n");
+		return -1;
+	}
+
+	/* open pinned stages map of pipeline */
+	char pin_dir[PATH_MAX];
+	char path[PATH_MAX];
+	snprintf(pin_dir, sizeof(pin_dir), PIN_DIR, if_name);
+	snprintf(path, sizeof(path), "%s/stages", pin_dir);
+	int stages_fd = bpf_obj_get(path);
+	if (stages_fd < 0) {
+		printf("Error opening stages map\n");
+		return -1;
+	}
+
+	/* remove stage */
+	__u32 key = stage;
+	if (delete) {
+		if (bpf_map_delete_elem(stages_fd, &key)) {
+			printf("Error removing stage\n");
+			return -1;
+		}
+		return 0;
+	}
+
+	/* load new stage program */
+	int prog_fd = load_stage(argv[optind + 2], argv[optind + 3], pin_dir);
+	if (prog_fd < 0) {
+		printf("Error loading stage program\n");
+		return -1;
+	}
+
+	/* atomically replace stage in pipeline */
+	if (bpf_map_update_elem(stages_fd, &key, &prog_fd, BPF_ANY)) {
+		printf("Error replacing stage\n");
+		return -1;
+	}
+
+	return 0;
+}
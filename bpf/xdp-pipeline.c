@@ -0,0 +1,225 @@
+/* bpf */
+#include <linux/bpf.h>
+#include <bpf/bpf_helpers.h>
+
+/* ethernet */
+#include <linux/if_ether.h>
+
+/* ipv4 */
+#include <linux/ip.h>
+
+/* ipv6 */
+#include <linux/ipv6.h>
+
+/* htons */
+#include <arpa/inet.h>
+
+/* set license to gpl */
+char _license[] SEC("license") = "GPL";
+
+/* pipeline stages in the order they are run; each stage continues with the
+ * next populated stage via tail call, empty stages are skipped
+ */
+enum {
+	STAGE_PARSE,
+	STAGE_FILTER,
+	STAGE_COUNT,
+	STAGE_REDIRECT,
+	NUM_STAGES,
+};
+
+/* packet information passed from the parse stage to later stages; the
+ * dispatcher invalidates it, so stages after a removed parse stage do not
+ * use the information of an earlier packet
+ */
+struct pkt_info {
+	__u16 l3_proto;	/* ethernet protocol, host byte order */
+	__u8 l4_proto;	/* ip protocol, 0 if not ipv4/ipv6 */
+	__u8 valid;	/* set by the parse stage for the current packet */
+};
+
+/* map of stage programs, populated by xdp-pipeline-attach and
+ * xdp-pipeline-swap
+ */
+struct {
+	__uint(type, BPF_MAP_TYPE_PROG_ARRAY);
+	__type(key, __u32);
+	__type(value, __u32);
+	__uint(max_entries, NUM_STAGES);
+} stages SEC(".maps");
+
+/* map for packet information of the current packet; tail calls run on the
+ * same cpu, so a per-cpu array is private to the packet
+ */
+struct {
+	__uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+	__type(key, __u32);
+	__type(value, struct pkt_info);
+	__uint(max_entries, 1);
+} pkt_infos SEC(".maps");
+
+/* map of ip protocols that are dropped by the filter stage */
+struct {
+	__uint(type, BPF_MAP_TYPE_ARRAY);
+	__type(key, __u32);
+	__type(value, __u8);
+	__uint(max_entries, 256);
+} drop_protos SEC(".maps");
+
+/* map for packet count per ip protocol */
+struct {
+	__uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+	__type(key, __u32);
+	__type(value, long);
+	__uint(max_entries, 256);
+} proto_count SEC(".maps");
+
+/* map with device packets are redirected to by the redirect stage */
+struct {
+	__uint(type, BPF_MAP_TYPE_DEVMAP);
+	__type(key, __u32);
+	__type(value, __u32);
+	__uint(max_entries, 1);
+} tx_port SEC(".maps");
+
+/* continue with first populated stage starting at stage; if there is no such
+ * stage, pass the packet
+ */
+static __always_inline int next_stage(struct xdp_md *ctx, __u32 stage)
+{
+#pragma unroll
+	for (__u32 i = stage; i < NUM_STAGES; i++) {
+		/* only returns if stage i is empty */
+		bpf_tail_call(ctx, &stages, i);
+	}
+
+	return XDP_PASS;
+}
+
+/* get packet information of the current packet */
+static __always_inline struct pkt_info *get_pkt_info()
+{
+	__u32 key = 0;
+
+	return bpf_map_lookup_elem(&pkt_infos, &key);
+}
+
+/* dispatcher attached to the interface, starts the pipeline */
+SEC("xdp")
+int xdp_dispatch(struct xdp_md *ctx)
+{
+	struct pkt_info *info;
+
+	info = get_pkt_info();
+	if (!info) {
+		return XDP_PASS;
+	}
+	info->valid = 0;
+
+	return next_stage(ctx, STAGE_PARSE);
+}
+
+/* parse ethernet and ip headers */
+SEC("xdp")
+int stage_parse(struct xdp_md *ctx)
+{
+	void *data_end = (void *)(long)ctx->data_end;
+	void *data = (void *)(long)ctx->data;
+	struct ethhdr *eth = data;
+	struct pkt_info *info;
+	struct ipv6hdr *ipv6;
+	struct iphdr *ipv4;
+
+	info = get_pkt_info();
+	if (!info) {
+		return XDP_PASS;
+	}
+	info->l3_proto = 0;
+	info->l4_proto = 0;
+	info->valid = 1;
+
+	/* check packet length for verifier */
+	if (data + sizeof(struct ethhdr) > data_end) {
+		return next_stage(ctx, STAGE_FILTER);
+	}
+	info->l3_proto = ntohs(eth->h_proto);
+
+	/* get ip protocol */
+	switch (info->l3_proto) {
+	case ETH_P_IP:
+		ipv4 = data + sizeof(struct ethhdr);
+		if ((void *) (ipv4 + 1) <= data_end) {
+			info->l4_proto = ipv4->protocol;
+		}
+		break;
+	case ETH_P_IPV6:
+		ipv6 = data + sizeof(struct ethhdr);
+		if ((void *) (ipv6 + 1) <= data_end) {
+			info->l4_proto = ipv6->nexthdr;
+		}
+		break;
+	}
+
+	return next_stage(ctx, STAGE_FILTER);
+}
+
+/* drop packets with ip protocols in drop_protos; packets without packet
+ * information are not filtered
+ */
+SEC("xdp")
+int stage_filter(struct xdp_md *ctx)
+{
+	struct pkt_info *info;
+	__u8 *drop;
+	__u32 key;
+
+	info = get_pkt_info();
+	if (!info) {
+		return XDP_PASS;
+	}
+	if (!info->valid) {
+		return next_stage(ctx, STAGE_COUNT);
+	}
+
+	key = info->l4_proto;
+	drop = bpf_map_lookup_elem(&drop_protos, &key);
+	if (drop && *drop) {
+		return XDP_DROP;
+	}
+
+	return next_stage(ctx, STAGE_COUNT);
+}
+
+/* count packets per ip protocol; packets without packet information are
+ * not counted
+ */
+SEC("xdp")
+int stage_count(struct xdp_md *ctx)
+{
+	struct pkt_info *info;
+	long *value;
+	__u32 key;
+
+	info = get_pkt_info();
+	if (!info) {
+		return XDP_PASS;
+	}
+	if (!info->valid) {
+		return next_stage(ctx, STAGE_REDIRECT);
+	}
+
+	key = info->l4_proto;
+	value = bpf_map_lookup_elem(&proto_count, &key);
+	if (value) {
+		*value += 1;
+	}
+
+	return next_stage(ctx, STAGE_REDIRECT);
+}
+
+/* redirect packets to the device in tx_port, pass them if it is not set */
+SEC("xdp")
+int stage_redirect(struct xdp_md *ctx)
+{
+	return bpf_redirect_map(&tx_port, 0, XDP_PASS);
+}
@@ -0,0 +1,255 @@
+/* open the pinned counter maps (e.g., /sys/fs/bpf/eth0/rx_count) of the xdp
+ * counting programs specified in the command line arguments, map them into
+ * memory and print packet (pps) or bit rates (bps) of all maps once per
+ * sampling interval; apart from sleeping, the sampling loop runs without any
+ * syscalls because counters are read from the BPF_F_MMAPABLE maps directly
+ *
+ * options:
+ *   -i <ms>  sampling interval in milliseconds (default: 1000)
+ *   -c       also output per-cpu rates
+ *   -b       output binary records instead of lines
+ */
+
+/* bpf */
+#include <bpf/bpf.h>
+#include <bpf/libbpf.h>
+
+/* mmap() */
+#include <sys/mman.h>
+
+/* clock_gettime(), clock_nanosleep() */
+#include <time.h>
+
+/* getopt() */
+#include <unistd.h>
+
+/* atoi(), calloc() */
+#include <stdlib.h>
+
+/* strstr(), strrchr() */
+#include <string.h>
+
+/* printf() */
+#include <stdio.h>
+
+/* binary output record, one per map and sample, followed by cpus per-cpu
+ * rates if -c is set
+ */
+struct record {
+	__u64 time_ns;	/* sample time, CLOCK_MONOTONIC */
+	__u32 map;	/* index of map in command line arguments */
+	__u32 cpus;	/* number of per-cpu rates following this record */
+	__u64 rate;	/* total rate per second */
+};
+
+/* memory-mapped counter map */
+struct counter_map {
+	const char *label;		/* name printed in line output */
+	volatile char *counters;	/* mmap-ed map values */
+	__u32 stride;			/* size of a single map value */
+	__u32 cpus;			/* number of per-cpu counters */
+	int bits;			/* map counts bytes, print bits */
+	__u64 *prev;			/* previous counter values */
+	__u64 *rates;			/* current per-cpu rates */
+};
+
+/* command line options */
+int interval_ms = 1000;
+int per_cpu = 0;
+int binary = 0;
+
+/* get label for map from its pin path, e.g., "eth0/rx_count" */
+const char *get_label(const char *path) {
+	const char *label = strrchr(path, '/');
+	if (!label) {
+		return path;
+	}
+	while (label > path && *(label - 1) != '/') {
+		label--;
+	}
+	return label;
+}
+
+/* open pinned map in path and map its counters into memory */
+int open_map(const char *path, struct counter_map *map) {
+	struct bpf_map_info info;
+	__u32 info_len = sizeof(info);
+	int fd;
+
+	/* open pinned map */
+	fd = bpf_obj_get(path);
+	if (fd < 0) {
+		return -1;
+	}
+
+	/* check map type and flags */
+	memset(&info, 0, sizeof(info));
+	if (bpf_obj_get_info_by_fd(fd, &info, &info_len)) {
+		return -1;
+	}
+	if (info.type != BPF_MAP_TYPE_ARRAY ||
+	    !(info.map_flags & BPF_F_MMAPABLE)) {
+		return -1;
+	}
+
+	/* array values are 8 byte aligned, one counter per cpu */
+	map->label = get_label(path);
+	map->stride = (info.value_size + 7) & ~7;
+	int num_cpus = libbpf_num_possible_cpus();
+	if (num_cpus <= 0) {
+		return -1;
+	}
+	map->cpus = info.max_entries;
+	if (map->cpus > (__u32) num_cpus) {
+		map->cpus = num_cpus;
+	}
+	map->bits = strstr(info.name, "bytes") != NULL;
+	map->prev = calloc(map->cpus, sizeof(__u64));
+	map->rates = calloc(map->cpus, sizeof(__u64));
+	if (!map->prev || !map->rates) {
+		return -1;
+	}
+
+	/* map counters into memory */
+	map->counters = mmap(NULL, (size_t) map->stride * info.max_entries,
+			     PROT_READ, MAP_SHARED, fd, 0);
+	if (map->counters == MAP_FAILED) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/* read counter of cpu from map */
+__u64 read_counter(struct counter_map *map, int cpu) {
+	return *(volatile __u64 *) (map->counters + cpu * map->stride);
+}
+
+/* read counters of map and update its rates, return total rate */
+__u64 read_map(struct counter_map *map, __u64 elapsed_ns) {
+	__u64 total = 0;
+
+	for (int i = 0; i < map->cpus; i++) {
+		__u64 value = read_counter(map, i);
+		__u64 rate = (double) (value - map->prev[i]) * 1e9 /
+			elapsed_ns;
+		if (map->bits) {
+			rate *= 8;
+		}
+		map->prev[i] = value;
+		map->rates[i] = rate;
+		total += rate;
+	}
+
+	return total;
+}
+
+/* output rates of map with index i */
+void output_map(struct counter_map *map, __u32 i, __u64 time_ns,
+		__u64 total) {
+	if (binary) {
+		struct record rec = {
+			.time_ns = time_ns,
+			.map = i,
+			.cpus = per_cpu ? map->cpus : 0,
+			.rate = total,
+		};
+		fwrite(&rec, sizeof(rec), 1, stdout);
+		if (per_cpu) {
+			fwrite(map->rates, sizeof(__u64), map->cpus, stdout);
+		}
+		return;
+	}
+
+	printf("%llu %s %llu", time_ns, map->label, total);
+	if (per_cpu) {
+		for (int cpu = 0; cpu < map->cpus; cpu++) {
+			printf(" %llu", map->rates[cpu]);
+		}
+	}
+	printf("\n");
+}
+
+/* get current time in nanoseconds */
+__u64 get_time_ns() {
+	struct timespec ts;
+
+	/* served by the vdso, no syscall */
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* sample all maps once per interval */
+void sample_maps(struct counter_map *maps, int num_maps) {
+	__u64 interval_ns = interval_ms * 1000000ULL;
+	__u64 last_ns = get_time_ns();
+	__u64 next_ns = last_ns;
+	struct timespec next;
+
+	/* initialize previous counter values */
+	for (int i = 0; i < num_maps; i++) {
+		for (int cpu = 0; cpu < maps[i].cpus; cpu++) {
+			maps[i].prev[cpu] = read_counter(&maps[i], cpu);
+		}
+	}
+
+	while (1) {
+		/* sleep until next sample at a fixed rate */
+		next_ns += interval_ns;
+		next.tv_sec = next_ns / 1000000000ULL;
+		next.tv_nsec = next_ns % 1000000000ULL;
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+		/* read and output all maps */
+		__u64 now_ns = get_time_ns();
+		for (int i = 0; i < num_maps; i++) {
+			__u64 total = read_map(&maps[i], now_ns - last_ns);
+			output_map(&maps[i], i, now_ns, total);
+		}
+		last_ns = now_ns;
+
+		/* write output of this sample at once */
+		fflush(stdout);
+	}
+}
+
+int main(int argc, char **argv) {
+	/* handle command line arguments */
+	int opt;
+	while ((opt = getopt(argc, argv, "i:cb")) != -1) {
+		switch (opt) {
+		case 'i':
+			interval_ms = atoi(optarg);
+			break;
+		case 'c':
+			per_cpu = 1;
+			break;
+		case 'b':
+			binary = 1;
+			break;
+		default:
+			return -1;
+		}
+	}
+	if (optind >= argc || interval_ms <= 0) {
+		return -1;
+	}
+
+	/* open all maps */
+	int num_maps = argc - optind;
+	struct counter_map *maps = calloc(num_maps, sizeof(*maps));
+	if (!maps) {
+		return -1;
+	}
+	for (int i = 0; i < num_maps; i++) {
+		if (open_map(argv[optind + i], &maps[i])) {
+			printf("Error opening map %s\n", argv[optind + i]);
+			return -1;
+		}
+	}
+
+	/* sample maps */
+	sample_maps(maps, num_maps);
+
+	return 0;
+}
@@ -0,0 +1,202 @@
+/* bpf */
+#include <linux/bpf.h>
+#include <bpf/bpf_helpers.h>
+
+/* ethernet */
+#include <linux/if_ether.h>
+
+/* ipv4 */
+#include <linux/ip.h>
+
+/* ipv6 */
+#include <linux/ipv6.h>
+
+/* tcp */
+#include <linux/tcp.h>
+
+/* htons, AF_INET, AF_INET6 */
+#include <arpa/inet.h>
+
+/* set license to gpl */
+char _license[] SEC("license") = "GPL";
+
+/* nanoseconds per second */
+#define NSEC_PER_SEC 1000000000ULL
+
+/* default syn rate per second and burst size per source */
+#define DEFAULT_RATE 100
+#define DEFAULT_BURST 200
+
+/* time after which a bucket is full again regardless of the rate */
+#define MAX_REFILL_NS (60 * NSEC_PER_SEC)
+
+/* indexes in syn_stats */
+enum {
+	STATS_PASSED,
+	STATS_DROPPED,
+	NUM_STATS,
+};
+
+/* syn rate limit configuration; zero values select the defaults */
+struct config {
+	__u64 rate;	/* syn packets per second per source */
+	__u64 burst;	/* maximum burst of syn packets per source */
+};
+
+/* source of syn packets: an ipv4 address or an ipv6 /64 prefix, since a
+ * single ipv6 host usually owns a whole /64; unused words are zero
+ */
+struct source {
+	__u32 family;	/* AF_INET or AF_INET6 */
+	__u32 addr[4];	/* ipv4 address in addr[0], ipv6 prefix in addr[0-1] */
+};
+
+/* token bucket of a source, tokens are scaled by NSEC_PER_SEC */
+struct bucket {
+	__u64 tokens;
+	__u64 last_ns;
+};
+
+/* map for syn rate limit configuration */
+struct {
+	__uint(type, BPF_MAP_TYPE_ARRAY);
+	__type(key, __u32);
+	__type(value, struct config);
+	__uint(max_entries, 1);
+} syn_config SEC(".maps");
+
+/* map of token buckets per source; lru, so a flood from many sources evicts
+ * old buckets instead of failing
+ */
+struct {
+	__uint(type, BPF_MAP_TYPE_LRU_HASH);
+	__type(key, struct source);
+	__type(value, struct bucket);
+	__uint(max_entries, 65536);
+} syn_buckets SEC(".maps");
+
+/* map for number of passed and dropped syn packets */
+struct {
+	__uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+	__type(key, __u32);
+	__type(value, long);
+	__uint(max_entries, NUM_STATS);
+} syn_stats SEC(".maps");
+
+/* count syn packet in stats */
+static __always_inline int count(__u32 key, int action)
+{
+	long *value;
+
+	value = bpf_map_lookup_elem(&syn_stats, &key);
+	if (value) {
+		*value += 1;
+	}
+
+	return action;
+}
+
+/* check if syn packet of source conforms to rate limit; updates of a bucket
+ * from multiple cpus may race, which only makes the limit approximate
+ */
+static __always_inline int check_rate(struct source *src)
+{
+	__u64 now = bpf_ktime_get_ns();
+	__u64 rate = DEFAULT_RATE;
+	__u64 burst = DEFAULT_BURST;
+	struct config *config;
+	struct bucket *bucket;
+	__u32 key = 0;
+	__u64 elapsed;
+
+	/* get configuration */
+	config = bpf_map_lookup_elem(&syn_config, &key);
+	if (config && config->rate) {
+		rate = config->rate;
+	}
+	if (config && config->burst) {
+		burst = config->burst;
+	}
+
+	/* first syn of source starts with a full bucket */
+	bucket = bpf_map_lookup_elem(&syn_buckets, src);
+	if (!bucket) {
+		struct bucket new = {
+			.tokens = (burst - 1) * NSEC_PER_SEC,
+			.last_ns = now,
+		};
+		bpf_map_update_elem(&syn_buckets, src, &new, BPF_ANY);
+		return 1;
+	}
+
+	/* refill bucket */
+	elapsed = now - bucket->last_ns;
+	if (elapsed >= MAX_REFILL_NS) {
+		bucket->tokens = burst * NSEC_PER_SEC;
+	} else {
+		bucket->tokens += elapsed * rate;
+		if (bucket->tokens > burst * NSEC_PER_SEC) {
+			bucket->tokens = burst * NSEC_PER_SEC;
+		}
+	}
+	bucket->last_ns = now;
+
+	/* take a token */
+	if (bucket->tokens < NSEC_PER_SEC) {
+		return 0;
+	}
+	bucket->tokens -= NSEC_PER_SEC;
+	return 1;
+}
+
+/* drop syn packets of sources exceeding the syn rate limit */
+SEC("xdp")
+int _syn_limit(struct xdp_md *ctx)
+{
+	void *data_end = (void *)(long)ctx->data_end;
+	void *data = (void *)(long)ctx->data;
+	struct ethhdr *eth = data;
+	struct source src = {};
+	struct ipv6hdr *ipv6;
+	struct iphdr *ipv4;
+	struct tcphdr *tcp;
+
+	/* check packet length for verifier */
+	if (data + sizeof(struct ethhdr) > data_end) {
+		return XDP_PASS;
+	}
+
+	/* get source address and tcp header */
+	if (eth->h_proto == htons(ETH_P_IP)) {
+		ipv4 = data + sizeof(struct ethhdr);
+		if ((void *) (ipv4 + 1) > data_end || ipv4->ihl < 5 ||
+		    ipv4->protocol != IPPROTO_TCP) {
+			return XDP_PASS;
+		}
+		src.family = AF_INET;
+		src.addr[0] = ipv4->saddr;
+		tcp = (void *) ipv4 + ipv4->ihl * 4;
+	} else if (eth->h_proto == htons(ETH_P_IPV6)) {
+		ipv6 = data + sizeof(struct ethhdr);
+		if ((void *) (ipv6 + 1) > data_end ||
+		    ipv6->nexthdr != IPPROTO_TCP) {
+			return XDP_PASS;
+		}
+		src.family = AF_INET6;
+		__builtin_memcpy(src.addr, &ipv6->saddr, 8);
+		tcp = (void *) (ipv6 + 1);
+	} else {
+		return XDP_PASS;
+	}
+
+	/* check syn without ack */
+	if ((void *) (tcp + 1) > data_end || !tcp->syn || tcp->ack) {
+		return XDP_PASS;
+	}
+
+	/* apply rate limit */
+	if (!check_rate(&src)) {
+		return count(STATS_DROPPED, XDP_DROP);
+	}
+	return count(STATS_PASSED, XDP_PASS);
+}
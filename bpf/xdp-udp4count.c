@@ -14,36 +14,37 @@
 /* set license to gpl */
 char _license[] SEC("license") = "GPL";
 
-/* map definitions */
-struct bpf_elf_map {
-	__u32 type;
-	__u32 size_key;
-	__u32 size_value;
-	__u32 max_elem;
-	__u32 flags;
-	__u32 id;
-	__u32 pinning;
-};
+/* maximum number of cpus with their own counter */
+#define MAX_CPUS 512
 
-/* map for packet count */
-struct bpf_elf_map SEC("maps") rx_count = {
-	.type = BPF_MAP_TYPE_ARRAY,
-	.size_key = sizeof(__u32),
-	.size_value = sizeof(long),
-	.max_elem = 1,
+/* counter of a single cpu, padded to a cache line to avoid false sharing */
+struct counter {
+	long value;
+	long pad[7];
 };
 
+/* map for packet count with one counter per cpu; a BPF_F_MMAPABLE array
+ * instead of a per-cpu array, so userspace can read all counters via mmap
+ */
+struct {
+	__uint(type, BPF_MAP_TYPE_ARRAY);
+	__uint(map_flags, BPF_F_MMAPABLE);
+	__type(key, __u32);
+	__type(value, struct counter);
+	__uint(max_entries, MAX_CPUS);
+} rx_count SEC(".maps");
+
 /* count all packets */
-SEC("count_pkts")
-int _accept_all(struct xdp_md *ctx)
+SEC("xdp")
+int _count_pkts(struct xdp_md *ctx)
 {
 	void *data_end = (void *)(long)ctx->data_end;
 	void *data = (void *)(long)ctx->data;
 	struct ethhdr *eth = data;
 	struct iphdr *ipv4;
-	__u32 key = 0;
+	__u32 key = bpf_get_smp_processor_id();
 	__u64 nh_off;
-	long *value;
+	struct counter *value;
 
 	/* check packet length for verifier */
 	if (data + sizeof(struct ethhdr) > data_end) {
@@ -69,7 +70,7 @@ int _accept_all(struct xdp_md *ctx)
 	/* increase counter */
 	value = bpf_map_lookup_elem(&rx_count, &key);
 	if (value) {
-		*value += 1;
+		value->value += 1;
 	}
 
 	return XDP_PASS;
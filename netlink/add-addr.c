@@ -1,11 +1,8 @@
-/* netlink imports */
-#include <asm/types.h>
-#include <sys/socket.h>
-#include <linux/netlink.h>
-#include <linux/rtnetlink.h>
+/* rtnetlink library */
+#include "rtnl.h"
 
-/* memset */
-#include <string.h>
+/* EMSGSIZE */
+#include <errno.h>
 
 /* printf */
 #include <stdio.h>
@@ -21,73 +18,41 @@
 #define IF_ADDR 0xC0A80117
 #define IF_PREFIXLEN 24
 
-/* create netlink socket and return socket fd */
-int create_socket() {
-	/* create socket address */
-	struct sockaddr_nl sa;
-	memset(&sa, 0, sizeof(sa));
-	sa.nl_family = AF_NETLINK;
-
-	/* create and bind socket */
-	int fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
-	if (fd < 0) {
-		return fd;
-	}
-	if (bind(fd, (struct sockaddr *) &sa, sizeof(sa))) {
-		return -1;
-	}
-	return fd;
-}
-
-/* send request to get all links */
-int send_request(int fd) {
-	/* create socket address */
-	struct sockaddr_nl sa;
-	memset(&sa, 0, sizeof(sa));
-	sa.nl_family = AF_NETLINK;
-
+/* send netlink request */
+int send_request(struct rtnl *rtnl) {
 	/* create request message */
-	struct {
-		struct nlmsghdr hdr;
-		struct ifaddrmsg ifa;
-		char attrbuf[512];
-	} req;
-	memset(&req, 0, sizeof(req));
-
-	/* fill header */
-	req.hdr.nlmsg_len = NLMSG_LENGTH(sizeof(req.ifa));
-	req.hdr.nlmsg_pid = 0;
-	req.hdr.nlmsg_seq = 1;
-	req.hdr.nlmsg_type = RTM_NEWADDR;
-	req.hdr.nlmsg_flags = NLM_F_REQUEST | NLM_F_CREATE;
+	char buf[512];
+	struct rtnl_msg msg;
+	rtnl_msg_init(&msg, buf, sizeof(buf));
+	struct ifaddrmsg *ifa = rtnl_msg_add(&msg, RTM_NEWADDR, NLM_F_CREATE,
+					     sizeof(*ifa));
+	if (!ifa) {
+		return -EMSGSIZE;
+	}
 
 	/* fill interface address message */
-	req.ifa.ifa_family = AF_INET;
-	req.ifa.ifa_prefixlen = IF_PREFIXLEN;
-	req.ifa.ifa_flags = IFA_F_PERMANENT;
-	req.ifa.ifa_index = if_nametoindex(IF_NAME);
+	ifa->ifa_family = AF_INET;
+	ifa->ifa_prefixlen = IF_PREFIXLEN;
+	ifa->ifa_flags = IFA_F_PERMANENT;
+	ifa->ifa_index = if_nametoindex(IF_NAME);
 
 	/* add address attribute */
-	__u32 addr = ntohl(IF_ADDR);
-	struct rtattr *addr_rta;
-	addr_rta = (struct rtattr *)(((char *) &req) +
-				     NLMSG_ALIGN(req.hdr.nlmsg_len));
-	addr_rta->rta_type = IFA_LOCAL;
-	addr_rta->rta_len = RTA_LENGTH(sizeof(addr));
-	memcpy(RTA_DATA(addr_rta), &addr, sizeof(addr));
+	rtnl_attr_add_u32(&msg, IFA_LOCAL, ntohl(IF_ADDR));
 
-	/* update message length */
-	req.hdr.nlmsg_len = NLMSG_ALIGN(req.hdr.nlmsg_len) + addr_rta->rta_len;
-
-	/* send request */
-	struct iovec iov = { &req, req.hdr.nlmsg_len };
-	struct msghdr msg = { &sa, sizeof(sa), &iov, 1, NULL, 0, 0 };
-	sendmsg(fd, &msg, 0);
-
-	return 0;
+	/* send request and wait for ack */
+	return rtnl_request(rtnl, &msg);
 }
 
 int main(int argc, char **argv) {
-	int fd = create_socket();
-	send_request(fd);
+	struct rtnl rtnl;
+	if (rtnl_open(&rtnl, 0, 0, 0)) {
+		printf("Error opening netlink socket\n");
+		return -1;
+	}
+	int rc = send_request(&rtnl);
+	if (rc) {
+		rtnl_perror(&rtnl, "Error", rc);
+		return -1;
+	}
+	return 0;
 }
@@ -0,0 +1,62 @@
+/* create fq qdisc as root qdisc on interface specified in first command line
+ * argument, replacing the current root qdisc; fq enforces the earliest
+ * departure times set by bpf programs like tc-edt
+ */
+
+/* rtnetlink library */
+#include "rtnl.h"
+
+/* EMSGSIZE */
+#include <errno.h>
+
+/* printf */
+#include <stdio.h>
+
+/* if_nametoindex() */
+#include <net/if.h>
+
+/* TC_H_* */
+#include <linux/pkt_sched.h>
+
+/* send netlink request */
+int send_request(struct rtnl *rtnl, const char *if_name) {
+	/* create request message */
+	char buf[512];
+	struct rtnl_msg msg;
+	rtnl_msg_init(&msg, buf, sizeof(buf));
+	struct tcmsg *tcm = rtnl_msg_add(&msg, RTM_NEWQDISC,
+					 NLM_F_CREATE | NLM_F_REPLACE,
+					 sizeof(*tcm));
+	if (!tcm) {
+		return -EMSGSIZE;
+	}
+
+	/* fill tc message */
+	tcm->tcm_family = AF_UNSPEC;
+	tcm->tcm_ifindex = if_nametoindex(if_name);
+	tcm->tcm_handle = TC_H_MAKE(1 << 16, 0);
+	tcm->tcm_parent = TC_H_ROOT;
+
+	/* add kind attribute */
+	rtnl_attr_add_str(&msg, TCA_KIND, "fq");
+
+	/* send request and wait for ack */
+	return rtnl_request(rtnl, &msg);
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		return -1;
+	}
+	struct rtnl rtnl;
+	if (rtnl_open(&rtnl, 0, 0, 0)) {
+		printf("Error opening netlink socket\n");
+		return -1;
+	}
+	int rc = send_request(&rtnl, argv[1]);
+	if (rc) {
+		rtnl_perror(&rtnl, "Error", rc);
+		return -1;
+	}
+	return 0;
+}
@@ -2,14 +2,11 @@
  * the interface specified in first command line argument
  */
 
-/* netlink imports */
-#include <asm/types.h>
-#include <sys/socket.h>
-#include <linux/netlink.h>
-#include <linux/rtnetlink.h>
+/* rtnetlink library */
+#include "rtnl.h"
 
-/* memset */
-#include <string.h>
+/* EMSGSIZE */
+#include <errno.h>
 
 /* printf */
 #include <stdio.h>
@@ -84,125 +81,57 @@ int load_bpf() {
 			      sizeof(prog) / sizeof(prog[0]), "GPL");
 }
 
-/* create netlink socket and return socket fd */
-int create_socket() {
-	/* create socket address */
-	struct sockaddr_nl sa;
-	memset(&sa, 0, sizeof(sa));
-	sa.nl_family = AF_NETLINK;
-
-	/* create and bind socket */
-	int fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
-	if (fd < 0) {
-		return fd;
-	}
-	if (bind(fd, (struct sockaddr *) &sa, sizeof(sa))) {
-		return -1;
-	}
-	return fd;
-}
-
 /* send netlink request */
-int send_request(int fd, const char *if_name, int bpf_fd) {
-	/* create socket address */
-	struct sockaddr_nl sa;
-	memset(&sa, 0, sizeof(sa));
-	sa.nl_family = AF_NETLINK;
-
+int send_request(struct rtnl *rtnl, const char *if_name, int bpf_fd) {
 	/* create request message */
-	struct {
-		struct nlmsghdr hdr;
-		struct tcmsg tcm;
-		char attrbuf[512];
-	} req;
-	memset(&req, 0, sizeof(req));
-
-	/* fill header */
-	req.hdr.nlmsg_len = NLMSG_LENGTH(sizeof(req.tcm));
-	req.hdr.nlmsg_pid = 0;
-	req.hdr.nlmsg_seq = 1;
-	req.hdr.nlmsg_type = RTM_NEWTFILTER;
-	req.hdr.nlmsg_flags = NLM_F_REQUEST | NLM_F_CREATE;
+	char buf[512];
+	struct rtnl_msg msg;
+	rtnl_msg_init(&msg, buf, sizeof(buf));
+	struct tcmsg *tcm = rtnl_msg_add(&msg, RTM_NEWTFILTER, NLM_F_CREATE,
+					 sizeof(*tcm));
+	if (!tcm) {
+		return -EMSGSIZE;
+	}
 
 	/* fill tc message */
-	req.tcm.tcm_family = AF_UNSPEC;
-	req.tcm.tcm_ifindex = if_nametoindex(if_name);
-	req.tcm.tcm_handle = 0;
-	req.tcm.tcm_parent = TC_H_MAKE(TC_H_CLSACT, TC_H_MIN_INGRESS);
-	req.tcm.tcm_info = TC_H_MAKE(0, htons(ETH_P_ALL));
+	tcm->tcm_family = AF_UNSPEC;
+	tcm->tcm_ifindex = if_nametoindex(if_name);
+	tcm->tcm_handle = 0;
+	tcm->tcm_parent = TC_H_MAKE(TC_H_CLSACT, TC_H_MIN_INGRESS);
+	tcm->tcm_info = TC_H_MAKE(0, htons(ETH_P_ALL));
 
 	/* add kind attribute */
-	const char *kind = "bpf";
-	struct rtattr *kind_rta;
-	kind_rta = (struct rtattr *)(((char *) &req) +
-				     NLMSG_ALIGN(req.hdr.nlmsg_len));
-	kind_rta->rta_type = TCA_KIND;
-	kind_rta->rta_len = RTA_LENGTH(strnlen(kind, 3) + 1);
-	memcpy(RTA_DATA(kind_rta), kind, strnlen(kind, 3) + 1);
-
-	/* update message length */
-	req.hdr.nlmsg_len = NLMSG_ALIGN(req.hdr.nlmsg_len) + kind_rta->rta_len;
-
-	/* add options attribute */
-	struct rtattr *options_rta;
-	options_rta = (struct rtattr *)(((char *) &req) +
-					NLMSG_ALIGN(req.hdr.nlmsg_len));
-	options_rta->rta_type = TCA_OPTIONS;
-	options_rta->rta_len = RTA_LENGTH(0);
-
-	/* add bpf fd attribute */
-	struct rtattr *fd_rta = RTA_DATA(options_rta);
-	fd_rta->rta_type = TCA_BPF_FD;
-	fd_rta->rta_len = RTA_LENGTH(sizeof(int));
-	memcpy(RTA_DATA(fd_rta), &bpf_fd, sizeof(int));
-
-	/* update options length */
-	options_rta->rta_len = RTA_ALIGN(options_rta->rta_len) +
-		fd_rta->rta_len;
-
-	/* add bpf name attribute */
-	const char *name = "accept-all";
-	struct rtattr *name_rta;
-	name_rta = (struct rtattr *)(((char *) options_rta) +
-				     RTA_ALIGN(options_rta->rta_len));
-	name_rta->rta_type = TCA_BPF_NAME;
-	name_rta->rta_len = RTA_LENGTH(strnlen(name, 10) + 1);
-	memcpy(RTA_DATA(name_rta), name, strnlen(name, 10 + 1));
-
-	/* update options length */
-	options_rta->rta_len = RTA_ALIGN(options_rta->rta_len) +
-		name_rta->rta_len;
-
-	/* add bpf flags */
-	__u32 flags = TCA_BPF_FLAG_ACT_DIRECT;
-	struct rtattr *flags_rta;
-	flags_rta = (struct rtattr *)(((char *) options_rta) +
-				      RTA_ALIGN(options_rta->rta_len));
-	flags_rta->rta_type = TCA_BPF_FLAGS;
-	flags_rta->rta_len = RTA_LENGTH(sizeof(flags));
-	memcpy(RTA_DATA(flags_rta), &flags, sizeof(flags));
-
-	/* update options length */
-	options_rta->rta_len = RTA_ALIGN(options_rta->rta_len) +
-		flags_rta->rta_len;
-
-	/* update message length */
-	req.hdr.nlmsg_len = NLMSG_ALIGN(req.hdr.nlmsg_len) +
-		options_rta->rta_len;
-
-	/* send request */
-	struct iovec iov = { &req, req.hdr.nlmsg_len };
-	struct msghdr msg = { &sa, sizeof(sa), &iov, 1, NULL, 0, 0 };
-	sendmsg(fd, &msg, 0);
+	rtnl_attr_add_str(&msg, TCA_KIND, "bpf");
 
-	return 0;
+	/* add options attribute with nested bpf fd, name and flags */
+	struct rtattr *options = rtnl_attr_nest(&msg, TCA_OPTIONS);
+	rtnl_attr_add_u32(&msg, TCA_BPF_FD, bpf_fd);
+	rtnl_attr_add_str(&msg, TCA_BPF_NAME, "accept-all");
+	rtnl_attr_add_u32(&msg, TCA_BPF_FLAGS, TCA_BPF_FLAG_ACT_DIRECT);
+	rtnl_attr_nest_end(&msg, options);
+
+	/* send request and wait for ack */
+	return rtnl_request(rtnl, &msg);
 }
 
 int main(int argc, char **argv) {
 	if (argc < 2) {
 		return -1;
 	}
-	int sock_fd = create_socket();
+	struct rtnl rtnl;
+	if (rtnl_open(&rtnl, 0, 0, 0)) {
+		printf("Error opening netlink socket\n");
+		return -1;
+	}
 	int bpf_fd = load_bpf();
-	send_request(sock_fd, argv[1], bpf_fd);
+	if (bpf_fd < 0) {
+		printf("Error loading bpf program\n");
+		return -1;
+	}
+	int rc = send_request(&rtnl, argv[1], bpf_fd);
+	if (rc) {
+		rtnl_perror(&rtnl, "Error", rc);
+		return -1;
+	}
+	return 0;
 }
@@ -0,0 +1,372 @@
+/* add many veth interface pairs with pipelined requests and print the
+ * number of pairs per second; requests are sent in batches of many messages
+ * per sendmsg call and their acks are collected while more batches are sent,
+ * so a pair costs no round trip of its own
+ *
+ * options:
+ *   -n <num>: number of pairs, default 1
+ *   -a <pattern>: name pattern of the interfaces, printf format with one %d
+ *                 for the number of the pair, default "veth%d"
+ *   -b <pattern>: name pattern of the peers, default "veth%dp"
+ *   -s <num>: number of the first pair, default 0
+ *   -m <mtu>: set mtu of interfaces and peers
+ *   -u: set interfaces and peers up; peers moved to another network
+ *       namespace stay down
+ *   -f <file>: move peers to network namespace identified by file, e.g.,
+ *              /var/run/netns/testns
+ *   -p <pid>: move peers to network namespace of process pid
+ *   -d: delete the pairs instead of adding them
+ *   -B <num>: pairs per sendmsg call, default 64
+ *   -w <num>: maximum pairs without acks, default 1024; acks of all of them
+ *             must fit into the receive buffer
+ */
+
+/* rtnetlink library */
+#include "rtnl.h"
+
+/* IF_NAMESIZE, IFF_UP; before the linux headers, which define them too */
+#include <net/if.h>
+
+/* veth */
+#include <linux/veth.h>
+
+/* ARPHRD_* */
+#include <linux/if_arp.h>
+
+/* EMSGSIZE, EINVAL */
+#include <errno.h>
+
+/* printf(), snprintf() */
+#include <stdio.h>
+
+/* strtoul(), malloc() */
+#include <stdlib.h>
+
+/* getopt() */
+#include <unistd.h>
+
+/* open(), O_RDONLY */
+#include <fcntl.h>
+
+/* clock_gettime() */
+#include <time.h>
+
+/* link info kind attribute */
+#define KIND_VETH "veth"
+
+/* maximum size of a request */
+#define REQUEST_SIZE 512
+
+/* receive buffer size for the acks of all requests in flight */
+#define ACK_RCVBUF (4 << 20)
+
+/* configuration of the pairs */
+struct config {
+	int num;		/* number of pairs */
+	const char *name1;	/* name pattern of interfaces */
+	const char *name2;	/* name pattern of peers */
+	int start;		/* number of first pair */
+	__u32 mtu;		/* mtu or 0 */
+	int up;			/* set interfaces up */
+	int netns_fd;		/* network namespace fd of peers or -1 */
+	int netns_pid;		/* network namespace pid of peers or 0 */
+	int delete;		/* delete pairs */
+	int batch;		/* pairs per sendmsg */
+	int window;		/* maximum pairs without acks */
+};
+
+/* state of pipelined requests */
+struct pipeline {
+	struct config *config;
+	__u32 seq;		/* sequence number of first request */
+	int msgs;		/* number of messages per pair */
+	int sent;		/* number of pairs sent */
+	int acked;		/* number of acks received */
+	int failed;		/* number of failed pairs */
+	int last_failed;	/* index of last failed pair or -1 */
+};
+
+/* check that pattern contains exactly one %d and no other conversion */
+int check_pattern(const char *pattern) {
+	int num = 0;
+
+	for (const char *c = pattern; *c; c++) {
+		if (*c != '%') {
+			continue;
+		}
+		if (c[1] != 'd') {
+			return -1;
+		}
+		num++;
+		c++;
+	}
+
+	return num == 1 ? 0 : -1;
+}
+
+/* get name of interface of pair i from pattern in name */
+int get_name(char *name, const char *pattern, int i) {
+	int len = snprintf(name, IF_NAMESIZE, pattern, i);
+
+	return len < 0 || len >= IF_NAMESIZE ? -EINVAL : 0;
+}
+
+/* fill interface info of a new interface; flags not in ifi_change keep
+ * their defaults, e.g., IFF_MULTICAST
+ */
+void fill_ifi(struct ifinfomsg *ifi) {
+	ifi->ifi_type = ARPHRD_ETHER;
+}
+
+/* check if peers are set up with an extra request */
+int set_peer_up(struct config *config) {
+	return config->up && !config->delete && config->netns_fd < 0 &&
+		!config->netns_pid;
+}
+
+/* add requests to add pair i to batch */
+int add_request(struct config *config, struct rtnl_msg *msg, int i) {
+	char name1[IF_NAMESIZE], name2[IF_NAMESIZE];
+	if (get_name(name1, config->name1, i) ||
+	    get_name(name2, config->name2, i)) {
+		return -EINVAL;
+	}
+
+	/* deleting the interface also deletes its peer */
+	if (config->delete) {
+		struct ifinfomsg *ifi = rtnl_msg_add(msg, RTM_DELLINK, 0,
+						     sizeof(*ifi));
+		if (!ifi) {
+			return -EMSGSIZE;
+		}
+		rtnl_attr_add_str(msg, IFLA_IFNAME, name1);
+		return msg->err;
+	}
+
+	struct ifinfomsg *ifi = rtnl_msg_add(msg, RTM_NEWLINK,
+					     NLM_F_CREATE | NLM_F_EXCL,
+					     sizeof(*ifi));
+	if (!ifi) {
+		return -EMSGSIZE;
+	}
+	fill_ifi(ifi);
+	if (config->up) {
+		ifi->ifi_flags = IFF_UP;
+		ifi->ifi_change = IFF_UP;
+	}
+	rtnl_attr_add_str(msg, IFLA_IFNAME, name1);
+	if (config->mtu) {
+		rtnl_attr_add_u32(msg, IFLA_MTU, config->mtu);
+	}
+
+	/* add link info attribute with nested kind attribute and peer info */
+	struct rtattr *info = rtnl_attr_nest(msg, IFLA_LINKINFO | NLA_F_NESTED);
+	rtnl_attr_add_str(msg, IFLA_INFO_KIND, KIND_VETH);
+	struct rtattr *data = rtnl_attr_nest(msg,
+					     IFLA_INFO_DATA | NLA_F_NESTED);
+	struct rtattr *peer = rtnl_attr_nest(msg, VETH_INFO_PEER);
+	struct ifinfomsg *peer_ifi = rtnl_msg_reserve(msg, sizeof(*peer_ifi));
+	if (peer_ifi) {
+		fill_ifi(peer_ifi);
+	}
+	rtnl_attr_add_str(msg, IFLA_IFNAME, name2);
+	if (config->mtu) {
+		rtnl_attr_add_u32(msg, IFLA_MTU, config->mtu);
+	}
+	if (config->netns_fd >= 0) {
+		rtnl_attr_add_u32(msg, IFLA_NET_NS_FD, config->netns_fd);
+	}
+	if (config->netns_pid) {
+		rtnl_attr_add_u32(msg, IFLA_NET_NS_PID, config->netns_pid);
+	}
+	rtnl_attr_nest_end(msg, peer);
+	rtnl_attr_nest_end(msg, data);
+	rtnl_attr_nest_end(msg, info);
+
+	/* the kernel configures the peer before it is connected to the
+	 * interface, so it cannot be set up in the same request
+	 */
+	if (set_peer_up(config)) {
+		ifi = rtnl_msg_add(msg, RTM_SETLINK, 0, sizeof(*ifi));
+		if (!ifi) {
+			return -EMSGSIZE;
+		}
+		ifi->ifi_flags = IFF_UP;
+		ifi->ifi_change = IFF_UP;
+		rtnl_attr_add_str(msg, IFLA_IFNAME, name2);
+	}
+
+	return msg->err;
+}
+
+/* handle ack of request, print error of failed requests */
+int handle_ack(struct rtnl *rtnl, __u32 seq, int err, void *arg) {
+	struct pipeline *p = arg;
+	__u32 index = (seq - p->seq) / p->msgs;
+
+	if (index >= (__u32) p->sent) {
+		return 0;
+	}
+	p->acked++;
+	if (err) {
+		char name[IF_NAMESIZE] = "";
+		char s[64];
+		int i = p->config->start + index;
+		get_name(name, p->config->name1, i);
+		snprintf(s, sizeof(s), "Error pair %d (%s)", i, name);
+		rtnl_perror(rtnl, s, err);
+		if (p->last_failed != (int) index) {
+			p->last_failed = index;
+			p->failed++;
+		}
+	}
+
+	return 0;
+}
+
+/* send all requests and collect their acks */
+int run(struct rtnl *rtnl, struct config *config, struct pipeline *p) {
+	size_t size = (size_t) config->batch * p->msgs * REQUEST_SIZE;
+	char *buf = malloc(size);
+	if (!buf) {
+		return -ENOMEM;
+	}
+
+	while (p->acked < config->num * p->msgs) {
+		/* send next batch if the window allows it */
+		int num = config->num - p->sent;
+		if (num > config->batch) {
+			num = config->batch;
+		}
+		if (num > 0 && (p->sent + num) * p->msgs - p->acked <=
+		    config->window * p->msgs) {
+			struct rtnl_msg msg;
+			rtnl_msg_init(&msg, buf, size);
+			for (int i = 0; i < num; i++) {
+				int rc = add_request(config, &msg, config->start +
+						     p->sent + i);
+				if (rc) {
+					free(buf);
+					return rc;
+				}
+			}
+			int rc = rtnl_send(rtnl, &msg);
+			if (rc) {
+				free(buf);
+				return rc;
+			}
+			if (p->sent == 0) {
+				p->seq = msg.seq;
+			}
+			p->sent += num;
+			continue;
+		}
+
+		/* collect acks */
+		int rc = rtnl_recv_acks(rtnl, handle_ack, p);
+		if (rc < 0) {
+			free(buf);
+			return rc;
+		}
+	}
+
+	free(buf);
+	return 0;
+}
+
+/* get current time in seconds */
+double now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv) {
+	struct config config = {
+		.num = 1,
+		.name1 = "veth%d",
+		.name2 = "veth%dp",
+		.netns_fd = -1,
+		.batch = 64,
+		.window = 1024,
+	};
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:a:b:s:m:uf:p:dB:w:")) != -1) {
+		switch (opt) {
+		case 'n':
+			config.num = strtoul(optarg, NULL, 0);
+			break;
+		case 'a':
+			config.name1 = optarg;
+			break;
+		case 'b':
+			config.name2 = optarg;
+			break;
+		case 's':
+			config.start = strtoul(optarg, NULL, 0);
+			break;
+		case 'm':
+			config.mtu = strtoul(optarg, NULL, 0);
+			break;
+		case 'u':
+			config.up = 1;
+			break;
+		case 'f':
+			config.netns_fd = open(optarg, O_RDONLY);
+			if (config.netns_fd == -1) {
+				printf("error opening %s\n", optarg);
+				return -1;
+			}
+			break;
+		case 'p':
+			config.netns_pid = strtoul(optarg, NULL, 0);
+			break;
+		case 'd':
+			config.delete = 1;
+			break;
+		case 'B':
+			config.batch = strtoul(optarg, NULL, 0);
+			break;
+		case 'w':
+			config.window = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			printf("Usage: %s [-n num] [-a pattern] [-b pattern] "
+			       "[-s num] [-m mtu] [-u] [-f file] [-p pid] [-d] "
+			       "[-B num] [-w num]\n", argv[0]);
+			return -1;
+		}
+	}
+	if (check_pattern(config.name1) || check_pattern(config.name2)) {
+		printf("Invalid name pattern, it needs exactly one %%d\n");
+		return -1;
+	}
+	if (config.num < 1 || config.batch < 1 ||
+	    config.window < config.batch) {
+		printf("Invalid number of pairs, batch or window size\n");
+		return -1;
+	}
+
+	struct rtnl rtnl;
+	if (rtnl_open(&rtnl, 0, ACK_RCVBUF, 0)) {
+		printf("Error opening netlink socket\n");
+		return -1;
+	}
+
+	struct pipeline p = { &config, 0, set_peer_up(&config) ? 2 : 1, 0,
+			      0, 0, -1 };
+	double start = now();
+	int rc = run(&rtnl, &config, &p);
+	double t = now() - start;
+	if (rc) {
+		rtnl_perror(&rtnl, "Error", rc);
+		return -1;
+	}
+	printf("%s %d pairs in %.3f s: %.0f pairs/s, %d failed\n",
+	       config.delete ? "deleted" : "added", config.num - p.failed, t,
+	       (config.num - p.failed) / t, p.failed);
+
+	return p.failed ? -1 : 0;
+}
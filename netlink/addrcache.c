@@ -0,0 +1,249 @@
+/* in-memory address cache, see addrcache.h */
+
+#include "addrcache.h"
+
+/* memset(), memcpy(), memcmp(), strcmp(), strncpy() */
+#include <string.h>
+
+/* EMSGSIZE */
+#include <errno.h>
+
+/* IFA_* */
+#include <linux/if_addr.h>
+
+/* keys of addresses */
+enum {
+	BY_ADDR,
+	BY_LINK,
+};
+
+/* length of addresses of family */
+static int addr_len(int family) {
+	return family == AF_INET ? 4 : 16;
+}
+
+/* hash of interface, family, address and prefix length, fnv-1a */
+static __u32 hash_addr(const void *entry) {
+	const struct addr_info *info = entry;
+	__u32 hash = 2166136261U;
+
+	hash = (hash ^ (__u32) info->ifindex) * 16777619U;
+	hash = (hash ^ (__u32) info->family) * 16777619U;
+	hash = (hash ^ (__u32) info->prefixlen) * 16777619U;
+	for (int i = 0; i < addr_len(info->family); i++) {
+		hash = (hash ^ info->addr[i]) * 16777619U;
+	}
+
+	return hash;
+}
+
+/* check if addresses have the same key */
+static int equal_addr(const void *a, const void *b) {
+	const struct addr_info *x = a, *y = b;
+
+	return x->ifindex == y->ifindex && x->family == y->family &&
+		x->prefixlen == y->prefixlen &&
+		!memcmp(x->addr, y->addr, addr_len(x->family));
+}
+
+/* hash of interface of address */
+static __u32 hash_link(const void *entry) {
+	const struct addr_info *info = entry;
+
+	return (__u32) info->ifindex * 2654435761U;
+}
+
+/* check if addresses are on the same interface */
+static int equal_link(const void *a, const void *b) {
+	return ((const struct addr_info *) a)->ifindex ==
+		((const struct addr_info *) b)->ifindex;
+}
+
+/* addresses are found by key and in groups by interface */
+static const struct cache_key keys[] = {
+	[BY_ADDR] = { hash_addr, equal_addr, 0 },
+	[BY_LINK] = { hash_link, equal_link, 1 },
+};
+
+/* initialize empty address cache */
+int addrcache_init(struct addrcache *cache, addrcache_cb cb, void *arg) {
+	cache->cb = cb;
+	cache->arg = arg;
+
+	return cache_init(&cache->cache, sizeof(struct addr_info), keys,
+			  sizeof(keys) / sizeof(keys[0]));
+}
+
+/* free all memory of address cache */
+void addrcache_free(struct addrcache *cache) {
+	cache_free(&cache->cache);
+}
+
+/* remove address at position i */
+static void remove_addr(struct cache *c, int i, void *arg) {
+	struct addrcache *cache = arg;
+
+	if (cache->cb) {
+		cache->cb(ADDRCACHE_DEL, cache_entry(c, i), NULL, cache->arg);
+	}
+	cache_remove(c, i);
+}
+
+/* check if state of addresses a and b differs, lifetimes are ignored */
+static int state_changed(struct addr_info *a, struct addr_info *b) {
+	return a->scope != b->scope || a->flags != b->flags ||
+		memcmp(a->peer, b->peer, sizeof(a->peer)) ||
+		strcmp(a->label, b->label);
+}
+
+/* add or update address with state info */
+static int update_addr(struct addrcache *cache, struct addr_info *info) {
+	struct cache *c = &cache->cache;
+
+	/* update existing address */
+	int i = cache_find(c, BY_ADDR, info);
+	if (i != CACHE_NONE) {
+		struct addr_info old = *(struct addr_info *) cache_entry(c, i);
+		cache_update(c, i, info);
+		if (cache->cb && state_changed(&old, info)) {
+			cache->cb(ADDRCACHE_CHANGE, &old, info, cache->arg);
+		}
+		return 0;
+	}
+
+	/* add new address */
+	int rc = cache_add(c, info);
+	if (rc < 0) {
+		return rc;
+	}
+	if (cache->cb) {
+		cache->cb(ADDRCACHE_NEW, NULL, info, cache->arg);
+	}
+
+	return 0;
+}
+
+/* parse address message nh into info; return 0 or -1 if it is invalid */
+static int parse_addr(struct nlmsghdr *nh, struct addr_info *info) {
+	struct ifaddrmsg *ifa = NLMSG_DATA(nh);
+
+	if (nh->nlmsg_len < NLMSG_LENGTH(sizeof(*ifa)) ||
+	    (ifa->ifa_family != AF_INET && ifa->ifa_family != AF_INET6)) {
+		return -1;
+	}
+
+	memset(info, 0, sizeof(*info));
+	info->ifindex = ifa->ifa_index;
+	info->family = ifa->ifa_family;
+	info->prefixlen = ifa->ifa_prefixlen;
+	info->scope = ifa->ifa_scope;
+	info->flags = ifa->ifa_flags;
+
+	struct rtattr *tb[IFA_MAX + 1];
+	rtnl_parse_attrs(tb, IFA_MAX, RTNL_ATTRS(nh, sizeof(*ifa)),
+			 RTNL_ATTRS_LEN(nh, sizeof(*ifa)));
+	int len = addr_len(info->family);
+
+	/* the local address is the key, the address is the peer on
+	 * point-to-point links if both are present
+	 */
+	struct rtattr *local = tb[IFA_LOCAL] ? tb[IFA_LOCAL] : tb[IFA_ADDRESS];
+	if (!local || RTA_PAYLOAD(local) < (size_t) len) {
+		return -1;
+	}
+	memcpy(info->addr, RTA_DATA(local), len);
+	if (tb[IFA_LOCAL] && tb[IFA_ADDRESS] &&
+	    RTA_PAYLOAD(tb[IFA_ADDRESS]) >= (size_t) len &&
+	    memcmp(RTA_DATA(tb[IFA_ADDRESS]), info->addr, len)) {
+		memcpy(info->peer, RTA_DATA(tb[IFA_ADDRESS]), len);
+	}
+
+	/* extended flags replace the 8 bit flags of the header */
+	if (tb[IFA_FLAGS]) {
+		info->flags = *(__u32 *) RTA_DATA(tb[IFA_FLAGS]);
+	}
+	if (tb[IFA_LABEL]) {
+		strncpy(info->label, RTA_DATA(tb[IFA_LABEL]),
+			sizeof(info->label) - 1);
+	}
+	if (tb[IFA_CACHEINFO]) {
+		struct ifa_cacheinfo *ci = RTA_DATA(tb[IFA_CACHEINFO]);
+		info->preferred = ci->ifa_prefered;
+		info->valid = ci->ifa_valid;
+	}
+
+	return 0;
+}
+
+/* apply address message to cache */
+int addrcache_handle(struct nlmsghdr *nh, void *arg) {
+	struct addrcache *cache = arg;
+	struct addr_info info;
+
+	if (nh->nlmsg_type != RTM_NEWADDR && nh->nlmsg_type != RTM_DELADDR) {
+		return 0;
+	}
+	if (parse_addr(nh, &info)) {
+		return 0;
+	}
+
+	if (nh->nlmsg_type == RTM_DELADDR) {
+		int i = cache_find(&cache->cache, BY_ADDR, &info);
+		if (i != CACHE_NONE) {
+			remove_addr(&cache->cache, i, cache);
+		}
+		return 0;
+	}
+
+	return update_addr(cache, &info);
+}
+
+/* apply queued events, dump all addresses and synchronize cache with them */
+int addrcache_sync(struct addrcache *cache, struct rtnl *rtnl) {
+	char buf[512];
+	struct rtnl_msg msg;
+	rtnl_msg_init(&msg, buf, sizeof(buf));
+	struct ifaddrmsg *ifa = rtnl_msg_add(&msg, RTM_GETADDR, NLM_F_DUMP,
+					     sizeof(*ifa));
+	if (!ifa) {
+		return -EMSGSIZE;
+	}
+	ifa->ifa_family = AF_UNSPEC;
+
+	return cache_sync(&cache->cache, rtnl, &msg, addrcache_handle, cache,
+			  remove_addr);
+}
+
+/* get address by key */
+const struct addr_info *addrcache_get(struct addrcache *cache, int ifindex,
+				      int family, const void *addr,
+				      int prefixlen) {
+	struct addr_info key = { .ifindex = ifindex, .family = family,
+				 .prefixlen = prefixlen };
+	memcpy(key.addr, addr, addr_len(family));
+	int i = cache_find(&cache->cache, BY_ADDR, &key);
+
+	return i != CACHE_NONE ? cache_entry(&cache->cache, i) : NULL;
+}
+
+/* get addresses of interface from its group */
+int addrcache_get_link(struct addrcache *cache, int ifindex, int family,
+		       const struct addr_info **addrs, int max) {
+	struct addr_info key = { .ifindex = ifindex };
+	struct cache *c = &cache->cache;
+	int num = 0;
+
+	for (int i = cache_find(c, BY_LINK, &key); i != CACHE_NONE;
+	     i = cache_next(c, BY_LINK, i)) {
+		struct addr_info *info = cache_entry(c, i);
+		if (family != AF_UNSPEC && info->family != family) {
+			continue;
+		}
+		if (num < max) {
+			addrs[num] = info;
+		}
+		num++;
+	}
+
+	return num;
+}
@@ -0,0 +1,101 @@
+/* in-memory cache of all ipv4 and ipv6 addresses of a network namespace,
+ * populated by a dump and kept current from RTM_NEWADDR and RTM_DELADDR
+ * events; addresses are stored in a dense array and found by interface,
+ * family, address and prefix length with an open addressing hash table; the
+ * addresses of an interface are found with a second table by ifindex
+ *
+ * build a tool together with the cache, the generic cache and the rtnetlink
+ * library, e.g.:
+ *
+ *   gcc if-addrs.c addrcache.c cache.c rtnl.c -o if-addrs
+ */
+
+#ifndef ADDRCACHE_H
+#define ADDRCACHE_H
+
+/* generic cache and rtnetlink library */
+#include "cache.h"
+
+/* IF_NAMESIZE */
+#include <net/if.h>
+
+/* cached state of an address */
+struct addr_info {
+	/* key */
+	int ifindex;			/* interface index */
+	__u8 family;			/* AF_INET or AF_INET6 */
+	__u8 prefixlen;			/* prefix length */
+	unsigned char addr[16];		/* local address, IFA_LOCAL or
+					 * IFA_ADDRESS if there is no local
+					 */
+
+	/* state */
+	__u8 scope;			/* RT_SCOPE_* scope */
+	__u32 flags;			/* IFA_F_* flags */
+	unsigned char peer[16];		/* peer address of point-to-point
+					 * links, IFA_ADDRESS, else zero
+					 */
+	char label[IF_NAMESIZE];	/* ipv4 label */
+
+	/* lifetimes, not compared for changes */
+	__u32 preferred;		/* preferred lifetime in s at update */
+	__u32 valid;			/* valid lifetime in s at update */
+};
+
+/* change of an address passed to the change callback */
+enum addrcache_change {
+	ADDRCACHE_NEW,		/* address was added */
+	ADDRCACHE_CHANGE,	/* flags, scope, peer or label changed */
+	ADDRCACHE_DEL,		/* address was removed */
+};
+
+/* change callback; old is the previous state (NULL for new addresses), addr
+ * the current state (NULL for removed addresses); both are only valid during
+ * the call
+ */
+typedef void (*addrcache_cb)(enum addrcache_change change,
+			     const struct addr_info *old,
+			     const struct addr_info *addr, void *arg);
+
+/* address cache */
+struct addrcache {
+	struct cache cache;	/* addresses by key and by interface */
+	addrcache_cb cb;	/* change callback or NULL */
+	void *arg;		/* argument of change callback */
+};
+
+/* initialize empty address cache with change callback cb (NULL for none)
+ * and its argument arg; return 0 or a negative error
+ */
+int addrcache_init(struct addrcache *cache, addrcache_cb cb, void *arg);
+
+/* free all memory of address cache */
+void addrcache_free(struct addrcache *cache);
+
+/* apply RTM_NEWADDR or RTM_DELADDR message nh to cache and call the change
+ * callback if the cached state changed; other messages are ignored, so this
+ * can be used as, or called from, an rtnl_cb; return 0 or a negative error
+ */
+int addrcache_handle(struct nlmsghdr *nh, void *cache);
+
+/* apply queued events, dump all addresses and synchronize the cache with
+ * them; addresses missing in the dump are removed, so this also
+ * resynchronizes a cache that missed events; return 0 or a negative error
+ */
+int addrcache_sync(struct addrcache *cache, struct rtnl *rtnl);
+
+/* get address of interface ifindex with family, address addr and prefix
+ * length, NULL if not found
+ */
+const struct addr_info *addrcache_get(struct addrcache *cache, int ifindex,
+				      int family, const void *addr,
+				      int prefixlen);
+
+/* store up to max addresses of interface ifindex with family (AF_UNSPEC for
+ * all) in addrs and return the number of addresses found, which can be more
+ * than max; only the addresses of the interface are visited, newest first
+ */
+int addrcache_get_link(struct addrcache *cache, int ifindex, int family,
+		       const struct addr_info **addrs, int max);
+
+#endif
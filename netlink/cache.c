@@ -0,0 +1,307 @@
+/* generic in-memory cache, see cache.h */
+
+#include "cache.h"
+
+/* memset(), memcpy(), memmove() */
+#include <string.h>
+
+/* malloc(), realloc(), free() */
+#include <stdlib.h>
+
+/* ENOMEM, EINVAL */
+#include <errno.h>
+
+/* initial size of the hash tables; tables are kept at most half full */
+#define INITIAL_TABLE_SIZE 64
+
+/* find slot of the key k of entry in its hash table, or the empty slot it
+ * belongs in
+ */
+static __u32 find_slot(struct cache *cache, int k, const void *entry) {
+	const struct cache_key *key = &cache->keys[k];
+	int *slots = cache->tables[k].slots;
+	__u32 slot = key->hash(entry) & cache->mask;
+
+	while (slots[slot] != CACHE_NONE &&
+	       !key->equal(cache_entry(cache, slots[slot]), entry)) {
+		slot = (slot + 1) & cache->mask;
+	}
+
+	return slot;
+}
+
+/* remove slot from hash table of key k; following entries are shifted back
+ * instead of leaving tombstones, so lookups stay short
+ */
+static void remove_slot(struct cache *cache, int k, __u32 slot) {
+	int *slots = cache->tables[k].slots;
+	__u32 next = slot;
+
+	slots[slot] = CACHE_NONE;
+	while (1) {
+		next = (next + 1) & cache->mask;
+		if (slots[next] == CACHE_NONE) {
+			return;
+		}
+
+		/* move entry back if its home slot is not between the empty
+		 * slot and its current slot
+		 */
+		__u32 home = cache->keys[k].hash(cache_entry(cache,
+							     slots[next])) &
+			cache->mask;
+		if (((next - home) & cache->mask) <
+		    ((next - slot) & cache->mask)) {
+			continue;
+		}
+		slots[slot] = slots[next];
+		slots[next] = CACHE_NONE;
+		slot = next;
+	}
+}
+
+/* insert entry i into hash table of key k; new group entries come first */
+static void table_insert(struct cache *cache, int k, int i) {
+	struct cache_table *t = &cache->tables[k];
+	__u32 slot = find_slot(cache, k, cache_entry(cache, i));
+
+	if (cache->keys[k].group) {
+		int first = t->slots[slot];
+		t->next[i] = first;
+		t->prev[i] = CACHE_NONE;
+		if (first != CACHE_NONE) {
+			t->prev[first] = i;
+		}
+	}
+	t->slots[slot] = i;
+}
+
+/* remove entry i from hash table of key k */
+static void table_remove(struct cache *cache, int k, int i) {
+	struct cache_table *t = &cache->tables[k];
+
+	if (!cache->keys[k].group) {
+		remove_slot(cache, k, find_slot(cache, k,
+						cache_entry(cache, i)));
+		return;
+	}
+
+	/* unlink entry from its group, the next entry becomes the first */
+	int next = t->next[i];
+	int prev = t->prev[i];
+	if (next != CACHE_NONE) {
+		t->prev[next] = prev;
+	}
+	if (prev != CACHE_NONE) {
+		t->next[prev] = next;
+		return;
+	}
+	__u32 slot = find_slot(cache, k, cache_entry(cache, i));
+	if (next != CACHE_NONE) {
+		t->slots[slot] = next;
+	} else {
+		remove_slot(cache, k, slot);
+	}
+}
+
+/* point hash table of key k to position to instead of entry from */
+static void table_move(struct cache *cache, int k, int from, int to) {
+	struct cache_table *t = &cache->tables[k];
+
+	if (!cache->keys[k].group) {
+		t->slots[find_slot(cache, k, cache_entry(cache, from))] = to;
+		return;
+	}
+
+	int next = t->next[from];
+	int prev = t->prev[from];
+	if (next != CACHE_NONE) {
+		t->prev[next] = to;
+	}
+	if (prev != CACHE_NONE) {
+		t->next[prev] = to;
+	} else {
+		t->slots[find_slot(cache, k, cache_entry(cache, from))] = to;
+	}
+	t->next[to] = next;
+	t->prev[to] = prev;
+}
+
+/* reallocate array *p to size bytes */
+static int grow(void *p, size_t size) {
+	void *q = realloc(*(void **) p, size);
+	if (!q) {
+		return -ENOMEM;
+	}
+	*(void **) p = q;
+
+	return 0;
+}
+
+/* resize hash tables and entry array to size slots */
+static int resize(struct cache *cache, __u32 size) {
+	size_t num = size / 2;
+	int *slots[CACHE_MAX_KEYS] = { NULL };
+
+	/* grown arrays are kept on errors, they are only larger */
+	if (grow(&cache->entries, num * cache->entry_size) ||
+	    grow(&cache->gens, num * sizeof(__u32))) {
+		return -ENOMEM;
+	}
+	for (int k = 0; k < cache->num_keys; k++) {
+		struct cache_table *t = &cache->tables[k];
+		slots[k] = malloc(size * sizeof(int));
+		if (!slots[k] || (cache->keys[k].group &&
+				  (grow(&t->next, num * sizeof(int)) ||
+				   grow(&t->prev, num * sizeof(int))))) {
+			for (; k >= 0; k--) {
+				free(slots[k]);
+			}
+			return -ENOMEM;
+		}
+	}
+	for (int k = 0; k < cache->num_keys; k++) {
+		free(cache->tables[k].slots);
+		cache->tables[k].slots = slots[k];
+		memset(slots[k], 0xff, size * sizeof(int));
+	}
+	cache->mask = size - 1;
+
+	/* rehash all entries; groups keep their lists, only their first
+	 * entries are in the tables
+	 */
+	for (int i = 0; i < cache->num; i++) {
+		void *entry = cache_entry(cache, i);
+		for (int k = 0; k < cache->num_keys; k++) {
+			struct cache_table *t = &cache->tables[k];
+			if (!cache->keys[k].group || t->prev[i] == CACHE_NONE) {
+				t->slots[find_slot(cache, k, entry)] = i;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/* initialize empty cache */
+int cache_init(struct cache *cache, size_t entry_size,
+	       const struct cache_key *keys, int num_keys) {
+	memset(cache, 0, sizeof(*cache));
+	if (num_keys > CACHE_MAX_KEYS) {
+		return -EINVAL;
+	}
+	cache->entry_size = entry_size;
+	cache->keys = keys;
+	cache->num_keys = num_keys;
+
+	return resize(cache, INITIAL_TABLE_SIZE);
+}
+
+/* free all memory of cache */
+void cache_free(struct cache *cache) {
+	free(cache->entries);
+	free(cache->gens);
+	for (int k = 0; k < cache->num_keys; k++) {
+		free(cache->tables[k].slots);
+		free(cache->tables[k].next);
+		free(cache->tables[k].prev);
+	}
+	memset(cache, 0, sizeof(*cache));
+}
+
+/* find entry by key */
+int cache_find(struct cache *cache, int k, const void *entry) {
+	return cache->tables[k].slots[find_slot(cache, k, entry)];
+}
+
+/* add entry */
+int cache_add(struct cache *cache, const void *entry) {
+	/* keep hash tables at most half full */
+	if ((__u32) cache->num + 1 > (cache->mask + 1) / 2) {
+		int rc = resize(cache, (cache->mask + 1) * 2);
+		if (rc) {
+			return rc;
+		}
+	}
+
+	int i = cache->num++;
+	memcpy(cache_entry(cache, i), entry, cache->entry_size);
+	cache->gens[i] = cache->gen;
+	for (int k = 0; k < cache->num_keys; k++) {
+		table_insert(cache, k, i);
+	}
+
+	return i;
+}
+
+/* replace entry */
+void cache_update(struct cache *cache, int i, const void *entry) {
+	int changed[CACHE_MAX_KEYS];
+
+	/* remove entry from the tables of changed keys, e.g., of a new name */
+	for (int k = 0; k < cache->num_keys; k++) {
+		changed[k] = !cache->keys[k].equal(cache_entry(cache, i),
+						   entry);
+		if (changed[k]) {
+			table_remove(cache, k, i);
+		}
+	}
+	memmove(cache_entry(cache, i), entry, cache->entry_size);
+	cache->gens[i] = cache->gen;
+	for (int k = 0; k < cache->num_keys; k++) {
+		if (changed[k]) {
+			table_insert(cache, k, i);
+		}
+	}
+}
+
+/* remove entry */
+void cache_remove(struct cache *cache, int i) {
+	for (int k = 0; k < cache->num_keys; k++) {
+		table_remove(cache, k, i);
+	}
+
+	/* move last entry into the hole */
+	int last = --cache->num;
+	if (i == last) {
+		return;
+	}
+	for (int k = 0; k < cache->num_keys; k++) {
+		table_move(cache, k, last, i);
+	}
+	memcpy(cache_entry(cache, i), cache_entry(cache, last),
+	       cache->entry_size);
+	cache->gens[i] = cache->gens[last];
+}
+
+/* apply queued events, dump all objects and synchronize cache with them */
+int cache_sync(struct cache *cache, struct rtnl *rtnl, struct rtnl_msg *msg,
+	       rtnl_cb cb, void *arg, cache_remove_cb remove) {
+	/* apply queued events first; they are older than the dump, so
+	 * entries they add must not count as seen in it
+	 */
+	int rc = rtnl_drain(rtnl, cb, arg);
+	if (rc) {
+		return rc;
+	}
+
+	/* mark all entries seen in the dump, or in events during the dump,
+	 * with a new generation
+	 */
+	cache->gen++;
+	rc = rtnl_dump(rtnl, msg, cb, arg);
+	if (rc) {
+		return rc;
+	}
+
+	/* remove entries that were not seen */
+	for (int i = 0; i < cache->num;) {
+		if (cache->gens[i] == cache->gen) {
+			i++;
+			continue;
+		}
+		remove(cache, i, arg);
+	}
+
+	return 0;
+}
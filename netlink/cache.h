@@ -0,0 +1,115 @@
+/* generic in-memory cache of rtnetlink objects shared by the link, address,
+ * neighbor and route caches: entries are stored in a dense array and found
+ * by their keys with open addressing hash tables; keys can be unique or
+ * shared by a group of entries, e.g., all addresses of an interface, which
+ * are then kept in a list; a sync applies queued events, dumps all objects
+ * and removes the entries not seen in the dump
+ *
+ * build a cache together with it and the rtnetlink library, e.g.:
+ *
+ *   gcc if-links.c linkcache.c cache.c rtnl.c -o if-links
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+/* rtnetlink library */
+#include "rtnl.h"
+
+/* maximum number of keys, i.e., hash tables, of a cache */
+#define CACHE_MAX_KEYS 2
+
+/* no entry */
+#define CACHE_NONE -1
+
+/* key of entries; lookups pass an entry with only the key set */
+struct cache_key {
+	__u32 (*hash)(const void *entry);		/* hash of key */
+	int (*equal)(const void *a, const void *b);	/* a and b have the
+							 * same key
+							 */
+	int group;					/* key is shared by a
+							 * group of entries
+							 */
+};
+
+/* hash table of a key */
+struct cache_table {
+	int *slots;		/* key -> array index, first entry of groups */
+	int *next;		/* next entry in group or CACHE_NONE */
+	int *prev;		/* previous entry in group or CACHE_NONE */
+};
+
+/* cache */
+struct cache {
+	void *entries;				/* dense array of entries */
+	size_t entry_size;			/* size of an entry */
+	int num;				/* number of entries */
+	__u32 *gens;				/* generation of the last sync
+						 * each entry was seen in
+						 */
+	const struct cache_key *keys;		/* keys of the hash tables */
+	int num_keys;				/* number of keys */
+	struct cache_table tables[CACHE_MAX_KEYS];	/* hash tables */
+	__u32 mask;				/* size of hash tables - 1 */
+	__u32 gen;				/* generation of the current
+						 * sync
+						 */
+};
+
+/* callback removing entry i of cache, e.g., after calling a change callback,
+ * with cache_remove()
+ */
+typedef void (*cache_remove_cb)(struct cache *cache, int i, void *arg);
+
+/* initialize empty cache of entries of entry_size bytes with num_keys keys;
+ * return 0 or a negative error
+ */
+int cache_init(struct cache *cache, size_t entry_size,
+	       const struct cache_key *keys, int num_keys);
+
+/* free all memory of cache */
+void cache_free(struct cache *cache);
+
+/* get entry at position i in the array, 0 <= i < num; positions change when
+ * entries are removed
+ */
+static inline void *cache_entry(struct cache *cache, int i) {
+	return (char *) cache->entries + i * cache->entry_size;
+}
+
+/* find index of entry with the key k of entry, the first entry of its group
+ * for group keys; return CACHE_NONE if not found
+ */
+int cache_find(struct cache *cache, int k, const void *entry);
+
+/* get index of the entry after entry i in its group of key k, CACHE_NONE
+ * at the end of the group
+ */
+static inline int cache_next(struct cache *cache, int k, int i) {
+	return cache->tables[k].next[i];
+}
+
+/* add copy of entry, seen in the current generation; its unique keys must
+ * not be in the cache yet; return its index or a negative error
+ */
+int cache_add(struct cache *cache, const void *entry);
+
+/* replace entry i with a copy of entry, seen in the current generation; the
+ * hash tables of changed keys are updated; unique keys must not be used by
+ * other entries
+ */
+void cache_update(struct cache *cache, int i, const void *entry);
+
+/* remove entry i; the last entry is moved to position i */
+void cache_remove(struct cache *cache, int i);
+
+/* apply queued events with cb, send dump request msg, apply the dumped
+ * objects with cb, and call remove for all entries not seen in the dump or
+ * in events during it; cb must add or update entries with cache_add() or
+ * cache_update(); return 0 or a negative error
+ */
+int cache_sync(struct cache *cache, struct rtnl *rtnl, struct rtnl_msg *msg,
+	       rtnl_cb cb, void *arg, cache_remove_cb remove);
+
+#endif
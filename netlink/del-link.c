@@ -1,11 +1,8 @@
-/* netlink imports */
-#include <asm/types.h>
-#include <sys/socket.h>
-#include <linux/netlink.h>
-#include <linux/rtnetlink.h>
+/* rtnetlink library */
+#include "rtnl.h"
 
-/* memset */
-#include <string.h>
+/* EMSGSIZE */
+#include <errno.h>
 
 /* printf */
 #include <stdio.h>
@@ -13,62 +10,40 @@
 /* if_nametoindex */
 #include <net/if.h>
 
-/* create netlink socket and return socket fd */
-int create_socket() {
-	/* create socket address */
-	struct sockaddr_nl sa;
-	memset(&sa, 0, sizeof(sa));
-	sa.nl_family = AF_NETLINK;
-
-	/* create and bind socket */
-	int fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
-	if (fd < 0) {
-		return fd;
-	}
-	if (bind(fd, (struct sockaddr *) &sa, sizeof(sa))) {
-		return -1;
-	}
-	return fd;
-}
-
-/* send request to get all links */
-int send_request(int fd, const char *if_name) {
-	/* create socket address */
-	struct sockaddr_nl sa;
-	memset(&sa, 0, sizeof(sa));
-	sa.nl_family = AF_NETLINK;
-
+/* send request to delete link */
+int send_request(struct rtnl *rtnl, const char *if_name) {
 	/* create request message */
-	struct {
-		struct nlmsghdr hdr;
-		struct ifinfomsg ifi;
-	} req;
-	memset(&req, 0, sizeof(req));
-
-	/* fill request header */
-	req.hdr.nlmsg_len = NLMSG_LENGTH(sizeof(req.ifi));
-	req.hdr.nlmsg_pid = 0;
-	req.hdr.nlmsg_seq = 1;
-	req.hdr.nlmsg_type = RTM_DELLINK;
-	req.hdr.nlmsg_flags = NLM_F_REQUEST;
+	char buf[512];
+	struct rtnl_msg msg;
+	rtnl_msg_init(&msg, buf, sizeof(buf));
+	struct ifinfomsg *ifi = rtnl_msg_add(&msg, RTM_DELLINK, 0,
+					     sizeof(*ifi));
+	if (!ifi) {
+		return -EMSGSIZE;
+	}
 
 	/* fill request interface info */
-	req.ifi.ifi_family = AF_UNSPEC;
-	req.ifi.ifi_index = if_nametoindex(if_name);
-	req.ifi.ifi_change = 0xffffffff;
-
-	/* send request */
-	struct iovec iov = { &req, req.hdr.nlmsg_len };
-	struct msghdr msg = { &sa, sizeof(sa), &iov, 1, NULL, 0, 0 };
-	sendmsg(fd, &msg, 0);
+	ifi->ifi_family = AF_UNSPEC;
+	ifi->ifi_index = if_nametoindex(if_name);
+	ifi->ifi_change = 0xffffffff;
 
-	return 0;
+	/* send request and wait for ack */
+	return rtnl_request(rtnl, &msg);
 }
 
 int main(int argc, char **argv) {
 	if (argc < 2) {
 		return -1;
 	}
-	int fd = create_socket();
-	send_request(fd, argv[1]);
+	struct rtnl rtnl;
+	if (rtnl_open(&rtnl, 0, 0, 0)) {
+		printf("Error opening netlink socket\n");
+		return -1;
+	}
+	int rc = send_request(&rtnl, argv[1]);
+	if (rc) {
+		rtnl_perror(&rtnl, "Error", rc);
+		return -1;
+	}
+	return 0;
 }
@@ -1,13 +1,10 @@
 /* delete clsact qdisc on interface specified in first command line argument */
 
-/* netlink imports */
-#include <asm/types.h>
-#include <sys/socket.h>
-#include <linux/netlink.h>
-#include <linux/rtnetlink.h>
+/* rtnetlink library */
+#include "rtnl.h"
 
-/* memset */
-#include <string.h>
+/* EMSGSIZE */
+#include <errno.h>
 
 /* printf */
 #include <stdio.h>
@@ -18,76 +15,44 @@
 /* TC_H_* */
 #include <linux/pkt_sched.h>
 
-/* create netlink socket and return socket fd */
-int create_socket() {
-	/* create socket address */
-	struct sockaddr_nl sa;
-	memset(&sa, 0, sizeof(sa));
-	sa.nl_family = AF_NETLINK;
-
-	/* create and bind socket */
-	int fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
-	if (fd < 0) {
-		return fd;
-	}
-	if (bind(fd, (struct sockaddr *) &sa, sizeof(sa))) {
-		return -1;
-	}
-	return fd;
-}
-
 /* send netlink request */
-int send_request(int fd, const char *if_name) {
-	/* create socket address */
-	struct sockaddr_nl sa;
-	memset(&sa, 0, sizeof(sa));
-	sa.nl_family = AF_NETLINK;
-
+int send_request(struct rtnl *rtnl, const char *if_name) {
 	/* create request message */
-	struct {
-		struct nlmsghdr hdr;
-		struct tcmsg tcm;
-		char attrbuf[512];
-	} req;
-	memset(&req, 0, sizeof(req));
-
-	/* fill header */
-	req.hdr.nlmsg_len = NLMSG_LENGTH(sizeof(req.tcm));
-	req.hdr.nlmsg_pid = 0;
-	req.hdr.nlmsg_seq = 1;
-	req.hdr.nlmsg_type = RTM_DELQDISC;
-	req.hdr.nlmsg_flags = NLM_F_REQUEST;
+	char buf[512];
+	struct rtnl_msg msg;
+	rtnl_msg_init(&msg, buf, sizeof(buf));
+	struct tcmsg *tcm = rtnl_msg_add(&msg, RTM_DELQDISC, 0,
+					 sizeof(*tcm));
+	if (!tcm) {
+		return -EMSGSIZE;
+	}
 
 	/* fill tc message */
-	req.tcm.tcm_family = AF_UNSPEC;
-	req.tcm.tcm_ifindex = if_nametoindex(if_name);
-	req.tcm.tcm_handle = TC_H_MAKE(TC_H_CLSACT, 0);
-	req.tcm.tcm_parent = TC_H_CLSACT;
+	tcm->tcm_family = AF_UNSPEC;
+	tcm->tcm_ifindex = if_nametoindex(if_name);
+	tcm->tcm_handle = TC_H_MAKE(TC_H_CLSACT, 0);
+	tcm->tcm_parent = TC_H_CLSACT;
 
 	/* add kind attribute */
-	const char *kind = "clsact";
-	struct rtattr *kind_rta;
-	kind_rta = (struct rtattr *)(((char *) &req) +
-				     NLMSG_ALIGN(req.hdr.nlmsg_len));
-	kind_rta->rta_type = TCA_KIND;
-	kind_rta->rta_len = RTA_LENGTH(strnlen(kind, 6));
-	memcpy(RTA_DATA(kind_rta), kind, strnlen(kind, 6));
+	rtnl_attr_add_str(&msg, TCA_KIND, "clsact");
 
-	/* update message length */
-	req.hdr.nlmsg_len = NLMSG_ALIGN(req.hdr.nlmsg_len) + kind_rta->rta_len;
-
-	/* send request */
-	struct iovec iov = { &req, req.hdr.nlmsg_len };
-	struct msghdr msg = { &sa, sizeof(sa), &iov, 1, NULL, 0, 0 };
-	sendmsg(fd, &msg, 0);
-
-	return 0;
+	/* send request and wait for ack */
+	return rtnl_request(rtnl, &msg);
 }
 
 int main(int argc, char **argv) {
 	if (argc < 2) {
 		return -1;
 	}
-	int fd = create_socket();
-	send_request(fd, argv[1]);
+	struct rtnl rtnl;
+	if (rtnl_open(&rtnl, 0, 0, 0)) {
+		printf("Error opening netlink socket\n");
+		return -1;
+	}
+	int rc = send_request(&rtnl, argv[1]);
+	if (rc) {
+		rtnl_perror(&rtnl, "Error", rc);
+		return -1;
+	}
+	return 0;
 }
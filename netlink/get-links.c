@@ -1,142 +1,215 @@
-/* netlink imports */
-#include <asm/types.h>
-#include <sys/socket.h>
-#include <linux/netlink.h>
-#include <linux/rtnetlink.h>
-
-/* memset */
-#include <string.h>
+/* get list of interfaces; filters are applied by the kernel, so only the
+ * requested interfaces are sent to user space; the kernel does not filter by
+ * kinds it does not know, e.g., if the module is not loaded, so master and
+ * kind are checked again in user space
+ *
+ * options:
+ *   -i  only get the interface with this name; -m and -k are ignored
+ *   -m  only get interfaces enslaved to the master interface with this name
+ *   -k  only get interfaces of this kind, e.g., "veth" or "bridge"
+ *   -s  print packet and byte counters of the interfaces; the kernel always
+ *       sends them in IFLA_STATS64, -s only stops it from skipping the
+ *       statistics of each virtual function (RTEXT_FILTER_SKIP_STATS), which
+ *       are only sent with -v
+ *   -v  get and print number of virtual functions of the interfaces
+ */
+
+/* rtnetlink library */
+#include "rtnl.h"
+
+/* EMSGSIZE */
+#include <errno.h>
 
 /* printf */
 #include <stdio.h>
 
-/* create netlink socket and return socket fd */
-int create_socket() {
-	/* create socket address */
-	struct sockaddr_nl sa;
-	memset(&sa, 0, sizeof(sa));
-	sa.nl_family = AF_NETLINK;
-
-	/* create and bind socket */
-	int fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
-	if (fd < 0) {
-		return fd;
+/* getopt() */
+#include <unistd.h>
+
+/* if_nametoindex() */
+#include <net/if.h>
+
+/* strcmp() */
+#include <string.h>
+
+/* IFLA_* */
+#include <linux/if_link.h>
+
+/* filter of the request */
+struct filter {
+	const char *if_name;	/* interface name, see -i */
+	int master;		/* ifindex of master interface, see -m */
+	const char *kind;	/* interface kind, see -k */
+	__u32 ext_mask;		/* RTEXT_FILTER_* flags, see -s and -v */
+	int stats;		/* print statistics, see -s */
+};
+
+/* send request to get all links matching filter and pass reply messages to
+ * cb
+ */
+int send_request(struct rtnl *rtnl, struct filter *filter, rtnl_cb cb) {
+	/* create request message; a single interface is requested with a get
+	 * request, all others with a dump request
+	 */
+	char buf[512];
+	struct rtnl_msg msg;
+	rtnl_msg_init(&msg, buf, sizeof(buf));
+	struct ifinfomsg *ifi = rtnl_msg_add(&msg, RTM_GETLINK,
+					     filter->if_name ? 0 : NLM_F_DUMP,
+					     sizeof(*ifi));
+	if (!ifi) {
+		return -EMSGSIZE;
 	}
-	if (bind(fd, (struct sockaddr *) &sa, sizeof(sa))) {
-		return -1;
+	ifi->ifi_family = AF_UNSPEC;
+
+	/* add filter attributes */
+	rtnl_attr_add_u32(&msg, IFLA_EXT_MASK, filter->ext_mask);
+	if (filter->if_name) {
+		/* get requests do not support master and kind filters */
+		rtnl_attr_add_str(&msg, IFLA_IFNAME, filter->if_name);
+		return rtnl_dump(rtnl, &msg, cb, filter);
+	}
+	if (filter->master) {
+		rtnl_attr_add_u32(&msg, IFLA_MASTER, filter->master);
 	}
-	return fd;
+	if (filter->kind) {
+		struct rtattr *linkinfo = rtnl_attr_nest(&msg, IFLA_LINKINFO);
+		rtnl_attr_add_str(&msg, IFLA_INFO_KIND, filter->kind);
+		rtnl_attr_nest_end(&msg, linkinfo);
+	}
+
+	/* send request and read reply until dump is done */
+	return rtnl_dump(rtnl, &msg, cb, filter);
 }
 
-/* send request to get all links */
-int send_request(int fd) {
-	/* create socket address */
-	struct sockaddr_nl sa;
-	memset(&sa, 0, sizeof(sa));
-	sa.nl_family = AF_NETLINK;
-
-	/* create request message */
-	struct {
-		struct nlmsghdr hdr;
-		struct rtgenmsg gen;
-	} req;
-	memset(&req, 0, sizeof(req));
-
-	/* fill request message */
-	req.hdr.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtgenmsg));
-	req.hdr.nlmsg_pid = 0;
-	req.hdr.nlmsg_seq = 1;
-	req.hdr.nlmsg_type = RTM_GETLINK;
-	req.hdr.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
-	req.gen.rtgen_family = AF_PACKET;
-
-	/* send request */
-	struct iovec iov = { &req, req.hdr.nlmsg_len };
-	struct msghdr msg = { &sa, sizeof(sa), &iov, 1, NULL, 0, 0 };
-	sendmsg(fd, &msg, 0);
+/* check if link with attributes tb matches master and kind of filter */
+int match_filter(struct filter *filter, struct rtattr **tb) {
+	if (filter->master && (!tb[IFLA_MASTER] ||
+			       *(__u32 *) RTA_DATA(tb[IFLA_MASTER]) !=
+			       (__u32) filter->master)) {
+		return 0;
+	}
+	if (filter->kind) {
+		if (!tb[IFLA_LINKINFO]) {
+			return 0;
+		}
+		struct rtattr *linkinfo[IFLA_INFO_MAX + 1];
+		rtnl_parse_attrs(linkinfo, IFLA_INFO_MAX,
+				 RTA_DATA(tb[IFLA_LINKINFO]),
+				 RTA_PAYLOAD(tb[IFLA_LINKINFO]));
+		if (!linkinfo[IFLA_INFO_KIND] ||
+		    strcmp(RTA_DATA(linkinfo[IFLA_INFO_KIND]), filter->kind)) {
+			return 0;
+		}
+	}
 
-	return 0;
+	return 1;
 }
 
 /* parse routing attribute */
-int parse_rta(struct rtattr *rta) {
-	struct rtnl_link_stats *stats;
+int parse_rta(struct filter *filter, struct rtattr *rta) {
+	struct rtnl_link_stats64 *stats;
 
 	switch (rta->rta_type) {
 	case IFLA_IFNAME:
 		printf("Link: %s\n", (char *) RTA_DATA(rta));
 		break;
+	case IFLA_STATS64:
+		if (!filter->stats) {
+			break;
+		}
+		stats = (struct rtnl_link_stats64 *) RTA_DATA(rta);
+		printf("  rx: %llu packets, %llu bytes\n",
+		       stats->rx_packets, stats->rx_bytes);
+		printf("  tx: %llu packets, %llu bytes\n",
+		       stats->tx_packets, stats->tx_bytes);
+		break;
+	case IFLA_NUM_VF:
+		printf("  vfs: %u\n", *(__u32 *) RTA_DATA(rta));
+		break;
 	}
 
 	return 0;
 }
 
 /* parse link netlink message */
-int parse_link_message(struct nlmsghdr *nh) {
-	struct ifinfomsg *ifi = (struct ifinfomsg *)(nh + 1);
+int parse_link_message(struct filter *filter, struct nlmsghdr *nh) {
+	struct ifinfomsg *ifi = NLMSG_DATA(nh);
+
+	/* check filter */
+	struct rtattr *tb[IFLA_MAX + 1];
+	rtnl_parse_attrs(tb, IFLA_MAX, RTNL_ATTRS(nh, sizeof(*ifi)),
+			 RTNL_ATTRS_LEN(nh, sizeof(*ifi)));
+	if (!match_filter(filter, tb)) {
+		return 0;
+	}
 
 	/* parse attributes */
-	int len = nh->nlmsg_len - sizeof(*ifi);
+	int len = RTNL_ATTRS_LEN(nh, sizeof(*ifi));
 	struct rtattr *rta;
-	for (rta = (struct rtattr *) (ifi + 1); RTA_OK (rta, len);
-	     rta = RTA_NEXT (rta, len)) {
-		parse_rta(rta);
+	for (rta = RTNL_ATTRS(nh, sizeof(*ifi)); RTA_OK(rta, len);
+	     rta = RTA_NEXT(rta, len)) {
+		parse_rta(filter, rta);
 	}
 
 	return 0;
 }
 
 /* parse netlink message */
-int parse_message(struct nlmsghdr *nh) {
+int parse_message(struct nlmsghdr *nh, void *arg) {
 	switch (nh->nlmsg_type) {
 	case RTM_NEWLINK:
-		parse_link_message(nh);
+		parse_link_message(arg, nh);
 		break;
 	}
 
 	return 0;
 }
 
-/* read a single netlink messages from socket fd */
-int read_message(int fd) {
-	/* 8192 to avoid msg truncation on platforms with page size > 4096 */
-	struct nlmsghdr buf[8192/sizeof(struct nlmsghdr)];
-	struct iovec iov = { buf, sizeof(buf) };
-	struct sockaddr_nl sa;
-	struct nlmsghdr *nh;
-	int len;
-
-	struct msghdr msg = { &sa, sizeof(sa), &iov, 1, NULL, 0, 0 };
-
-	len = recvmsg(fd, &msg, 0);
-	if (len <= 0) {
-		return -1;
-	}
-
-	for (nh = (struct nlmsghdr *) buf; NLMSG_OK (nh, len);
-	     nh = NLMSG_NEXT (nh, len)) {
-		/* end of multipart message */
-		if (nh->nlmsg_type == NLMSG_DONE) {
-			return 1; /* stop here */
-		}
-		/* error handling */
-		if (nh->nlmsg_type == NLMSG_ERROR) {
+int main(int argc, char **argv) {
+	/* handle command line arguments */
+	struct filter filter = { NULL, 0, NULL, RTEXT_FILTER_SKIP_STATS, 0 };
+	int opt;
+	while ((opt = getopt(argc, argv, "i:m:k:sv")) != -1) {
+		switch (opt) {
+		case 'i':
+			filter.if_name = optarg;
+			break;
+		case 'm':
+			filter.master = if_nametoindex(optarg);
+			if (!filter.master) {
+				printf("Error: unknown master %s\n", optarg);
+				return -1;
+			}
+			break;
+		case 'k':
+			filter.kind = optarg;
+			break;
+		case 's':
+			filter.ext_mask &= ~RTEXT_FILTER_SKIP_STATS;
+			filter.stats = 1;
+			break;
+		case 'v':
+			filter.ext_mask |= RTEXT_FILTER_VF;
+			break;
+		default:
 			return -1;
 		}
-		/* parse payload */
-		parse_message(nh);
 	}
 
+	struct rtnl rtnl;
+	if (rtnl_open(&rtnl, 0, 0, 0)) {
+		printf("Error opening netlink socket\n");
+		return -1;
+	}
+	if (rtnl_set_strict(&rtnl)) {
+		printf("Error enabling strict checking\n");
+		return -1;
+	}
+	int rc = send_request(&rtnl, &filter, parse_message);
+	if (rc) {
+		rtnl_perror(&rtnl, "Error", rc);
+		return -1;
+	}
 	return 0;
 }
-
-/* read netlink messages from fd */
-void read_messages(int fd) {
-	while (!read_message(fd));
-}
-
-int main(int argc, char **argv) {
-	int fd = create_socket();
-	send_request(fd);
-	read_messages(fd);
-}
@@ -1,32 +1,46 @@
-/* netlink imports */
-#include <asm/types.h>
-#include <sys/socket.h>
-#include <linux/netlink.h>
-#include <linux/rtnetlink.h>
+/* listen to interface events and print address changes
+ *
+ * options:
+ *   -4  only ipv4 addresses
+ *   -6  only ipv6 addresses
+ *   -i  only addresses of the interface with this name
+ *   -d  dump current addresses before listening; the kernel filters the dump
+ *       by family and interface
+ *   -c  keep a cache of all addresses, populated by a dump and kept current
+ *       from events, and only print its changes, one line per change:
+ *
+ *         add <ifindex> <addr>/<prefixlen> scope <scope> flags <flags>
+ *             valid <s> preferred <s>
+ *         change <ifindex> <addr>/<prefixlen> scope <scope> flags <flags>
+ *             valid <s> preferred <s>
+ *         del <ifindex> <addr>/<prefixlen>
+ *
+ *       flags are IFA_F_* flags in hex, lifetimes are in seconds
+ */
 
-/* memset */
-#include <string.h>
+/* address cache and rtnetlink library */
+#include "addrcache.h"
+
+/* EMSGSIZE */
+#include <errno.h>
 
 /* printf */
 #include <stdio.h>
 
-/* create netlink socket and return socket fd */
-int create_socket() {
-	struct sockaddr_nl sa;
+/* getopt() */
+#include <unistd.h>
 
-	memset(&sa, 0, sizeof(sa));
-	sa.nl_family = AF_NETLINK;
-	sa.nl_groups = RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+/* if_nametoindex() */
+#include <net/if.h>
 
-	int fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
-	if (fd < 0) {
-		return fd;
-	}
-	if (bind(fd, (struct sockaddr *) &sa, sizeof(sa))) {
-		return -1;
-	}
-	return fd;
-}
+/* inet_ntop() */
+#include <arpa/inet.h>
+
+/* filter of the dump and the events */
+struct filter {
+	int family;	/* address family, see -4 and -6 */
+	int ifindex;	/* interface index, see -i */
+};
 
 /* print address in routing attribute data */
 void print_addr(struct rtattr *rta) {
@@ -162,25 +176,56 @@ int parse_rta(struct rtattr *rta) {
 
 /* parse address netlink message */
 int parse_addr_message(struct nlmsghdr *nh) {
-	struct ifaddrmsg *ifa = (struct ifaddrmsg *)(nh + 1);
+	struct ifaddrmsg *ifa = NLMSG_DATA(nh);
 
 	printf("family: %d, prefixlen: %d, flags: %d, scope: %d, index: %d\n",
 	       ifa->ifa_family, ifa->ifa_prefixlen, ifa->ifa_flags,
 	       ifa->ifa_scope, ifa->ifa_index);
 
 	/* parse attributes */
-	int len = nh->nlmsg_len - sizeof(*ifa);
+	int len = RTNL_ATTRS_LEN(nh, sizeof(*ifa));
 	struct rtattr *rta;
-	for (rta = (struct rtattr *) (ifa + 1); RTA_OK (rta, len);
-	     rta = RTA_NEXT (rta, len)) {
+	for (rta = RTNL_ATTRS(nh, sizeof(*ifa)); RTA_OK(rta, len);
+	     rta = RTA_NEXT(rta, len)) {
 		parse_rta(rta);
 	}
 
 	return 0;
 }
 
+/* send request to dump all addresses matching filter and pass reply
+ * messages to cb
+ */
+int send_request(struct rtnl *rtnl, struct filter *filter, rtnl_cb cb) {
+	/* create request message; with strict checking, the kernel filters
+	 * by the family and index in the header
+	 */
+	char buf[512];
+	struct rtnl_msg msg;
+	rtnl_msg_init(&msg, buf, sizeof(buf));
+	struct ifaddrmsg *ifa = rtnl_msg_add(&msg, RTM_GETADDR, NLM_F_DUMP,
+					     sizeof(*ifa));
+	if (!ifa) {
+		return -EMSGSIZE;
+	}
+	ifa->ifa_family = filter->family;
+	ifa->ifa_index = filter->ifindex;
+
+	/* send request and read reply until dump is done */
+	return rtnl_dump(rtnl, &msg, cb, filter);
+}
+
 /* parse netlink message */
-int parse_message(struct nlmsghdr *nh) {
+int parse_message(struct nlmsghdr *nh, void *arg) {
+	struct filter *filter = arg;
+	struct ifaddrmsg *ifa = NLMSG_DATA(nh);
+
+	/* events cannot be filtered by the kernel */
+	if ((filter->family && ifa->ifa_family != filter->family) ||
+	    (filter->ifindex && ifa->ifa_index != (__u32) filter->ifindex)) {
+		return 0;
+	}
+
 	switch (nh->nlmsg_type) {
 	case RTM_NEWADDR:
 		printf("NEW: ");
@@ -197,45 +242,151 @@ int parse_message(struct nlmsghdr *nh) {
 	return 0;
 }
 
-/* read a single netlink messages from socket fd */
-int read_message(int fd) {
-	/* 8192 to avoid msg truncation on platforms with page size > 4096 */
-	struct nlmsghdr buf[8192/sizeof(struct nlmsghdr)];
-	struct iovec iov = { buf, sizeof(buf) };
-	struct sockaddr_nl sa;
-	struct nlmsghdr *nh;
-	int len;
+/* dump all addresses to resynchronize after events were lost */
+int resync(struct rtnl *rtnl, void *arg) {
+	printf("overrun %llu, events lost, dumping addresses\n",
+	       rtnl->overruns);
 
-	struct msghdr msg = { &sa, sizeof(sa), &iov, 1, NULL, 0, 0 };
+	return send_request(rtnl, arg, parse_message);
+}
+
+/* print change of cached address, with its state unless it was removed */
+void print_change(const char *change, const struct addr_info *addr,
+		  int state) {
+	char buf[INET6_ADDRSTRLEN];
+
+	inet_ntop(addr->family, addr->addr, buf, sizeof(buf));
+	printf("%s %d %s/%u", change, addr->ifindex, buf, addr->prefixlen);
+	if (state) {
+		printf(" scope %u flags %x valid %u preferred %u", addr->scope,
+		       addr->flags, addr->valid, addr->preferred);
+	}
+	printf("\n");
+}
+
+/* change callback of address cache */
+void handle_change(enum addrcache_change change, const struct addr_info *old,
+		   const struct addr_info *addr, void *arg) {
+	struct filter *filter = arg;
+	const struct addr_info *a = addr ? addr : old;
 
-	len = recvmsg(fd, &msg, 0);
-	if (len <= 0) {
+	/* the cache holds all addresses, only print the filtered ones */
+	if ((filter->family && a->family != filter->family) ||
+	    (filter->ifindex && a->ifindex != filter->ifindex)) {
+		return;
+	}
+
+	switch (change) {
+	case ADDRCACHE_NEW:
+		print_change("add", addr, 1);
+		break;
+	case ADDRCACHE_CHANGE:
+		print_change("change", addr, 1);
+		break;
+	case ADDRCACHE_DEL:
+		print_change("del", old, 0);
+		break;
+	}
+	fflush(stdout);
+}
+
+/* resynchronize cache after events were lost */
+int resync_cache(struct rtnl *rtnl, void *arg) {
+	printf("overrun %llu, events lost, resynchronizing\n", rtnl->overruns);
+
+	return addrcache_sync(arg, rtnl);
+}
+
+/* keep cache of all addresses and print its changes */
+int run_cache(struct rtnl *rtnl, struct filter *filter) {
+	struct addrcache cache;
+	if (addrcache_init(&cache, handle_change, filter)) {
+		return -ENOMEM;
+	}
+	int rc = addrcache_sync(&cache, rtnl);
+	if (rc) {
+		return rc;
+	}
+
+	return rtnl_listen(rtnl, addrcache_handle, resync_cache, &cache);
+}
+
+int main(int argc, char **argv) {
+	/* handle command line arguments */
+	struct filter filter = { AF_UNSPEC, 0 };
+	int dump = 0;
+	int cache = 0;
+	int opt;
+	while ((opt = getopt(argc, argv, "46i:dc")) != -1) {
+		switch (opt) {
+		case '4':
+			filter.family = AF_INET;
+			break;
+		case '6':
+			filter.family = AF_INET6;
+			break;
+		case 'i':
+			filter.ifindex = if_nametoindex(optarg);
+			if (!filter.ifindex) {
+				printf("Error: unknown interface %s\n", optarg);
+				return -1;
+			}
+			break;
+		case 'd':
+			dump = 1;
+			break;
+		case 'c':
+			cache = 1;
+			break;
+		default:
+			return -1;
+		}
+	}
+
+	/* only join the multicast groups of the requested family */
+	__u32 groups = 0;
+	if (filter.family != AF_INET6) {
+		groups |= RTMGRP_IPV4_IFADDR;
+	}
+	if (filter.family != AF_INET) {
+		groups |= RTMGRP_IPV6_IFADDR;
+	}
+	struct rtnl rtnl;
+	if (rtnl_open(&rtnl, groups, RTNL_EVENT_RCVBUF, 0)) {
+		printf("Error opening netlink socket\n");
 		return -1;
 	}
 
-	for (nh = (struct nlmsghdr *) buf; NLMSG_OK (nh, len);
-	     nh = NLMSG_NEXT (nh, len)) {
-		/* end of multipart message */
-		if (nh->nlmsg_type == NLMSG_DONE) {
-			return 0;
+	/* keep cache of addresses */
+	int rc;
+	if (cache) {
+		rc = run_cache(&rtnl, &filter);
+		if (rc) {
+			rtnl_perror(&rtnl, "Error", rc);
+			return -1;
+		}
+		return 0;
+	}
+
+	/* dump current addresses; the header of the dump request is only
+	 * used as a filter with strict checking
+	 */
+	if (dump) {
+		if (rtnl_set_strict(&rtnl)) {
+			printf("Error enabling strict checking\n");
+			return -1;
 		}
-		/* error handling */
-		if (nh->nlmsg_type == NLMSG_ERROR) {
+		rc = send_request(&rtnl, &filter, parse_message);
+		if (rc) {
+			rtnl_perror(&rtnl, "Error dumping addresses", rc);
 			return -1;
 		}
-		/* parse payload */
-		parse_message(nh);
 	}
 
+	rc = rtnl_listen(&rtnl, parse_message, resync, &filter);
+	if (rc) {
+		rtnl_perror(&rtnl, "Error receiving netlink messages", rc);
+		return -1;
+	}
 	return 0;
 }
-
-/* read netlink messages from fd */
-void read_messages(int fd) {
-	while (!read_message(fd));
-}
-
-int main(int arc, char **argv) {
-	int fd = create_socket();
-	read_messages(fd);
-}
@@ -5,14 +5,11 @@
  * RTMGRP_IPV6_IFADDR (IPv6 addresses add/delete events) multicast groups.
  */
 
-/* netlink imports */
-#include <asm/types.h>
-#include <sys/socket.h>
-#include <linux/netlink.h>
-#include <linux/rtnetlink.h>
+/* rtnetlink library */
+#include "rtnl.h"
 
-/* memset */
-#include <string.h>
+/* EMSGSIZE */
+#include <errno.h>
 
 /* printf */
 #include <stdio.h>
@@ -20,24 +17,6 @@
 /* verbose output */
 int verbose = 0;
 
-/* create netlink socket and return socket fd */
-int create_socket() {
-	struct sockaddr_nl sa;
-
-	memset(&sa, 0, sizeof(sa));
-	sa.nl_family = AF_NETLINK;
-	sa.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
-
-	int fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
-	if (fd < 0) {
-		return fd;
-	}
-	if (bind(fd, (struct sockaddr *) &sa, sizeof(sa))) {
-		return -1;
-	}
-	return fd;
-}
-
 /* parse routing attribute */
 int parse_rta(struct rtattr *rta) {
 	struct rtnl_link_stats *stats;
@@ -99,7 +78,7 @@ int parse_rta(struct rtattr *rta) {
 
 /* parse link netlink message */
 int parse_link_message(struct nlmsghdr *nh) {
-	struct ifinfomsg *ifi = (struct ifinfomsg *)(nh + 1);
+	struct ifinfomsg *ifi = NLMSG_DATA(nh);
 
 	if (verbose) {
 		printf("interface info msg:\n"
@@ -113,10 +92,10 @@ int parse_link_message(struct nlmsghdr *nh) {
 	}
 
 	/* parse attributes */
-	int len = nh->nlmsg_len - sizeof(*ifi);
+	int len = RTNL_ATTRS_LEN(nh, sizeof(*ifi));
 	struct rtattr *rta;
-	for (rta = (struct rtattr *) (ifi + 1); RTA_OK (rta, len);
-	     rta = RTA_NEXT (rta, len)) {
+	for (rta = RTNL_ATTRS(nh, sizeof(*ifi)); RTA_OK(rta, len);
+	     rta = RTA_NEXT(rta, len)) {
 		parse_rta(rta);
 	}
 
@@ -124,7 +103,7 @@ int parse_link_message(struct nlmsghdr *nh) {
 }
 
 /* parse netlink message */
-int parse_message(struct nlmsghdr *nh) {
+int parse_message(struct nlmsghdr *nh, void *arg) {
 	if (verbose) {
 		printf("netlink msg:\n"
 		       "  len: %d,\n"
@@ -158,45 +137,42 @@ int parse_message(struct nlmsghdr *nh) {
 	return 0;
 }
 
-/* read a single netlink messages from socket fd */
-int read_message(int fd) {
-	/* 8192 to avoid msg truncation on platforms with page size > 4096 */
-	struct nlmsghdr buf[8192/sizeof(struct nlmsghdr)];
-	struct iovec iov = { buf, sizeof(buf) };
-	struct sockaddr_nl sa;
-	struct nlmsghdr *nh;
-	int len;
-
-	struct msghdr msg = { &sa, sizeof(sa), &iov, 1, NULL, 0, 0 };
+/* dump all links and addresses to resynchronize after events were lost */
+int resync(struct rtnl *rtnl, void *arg) {
+	printf("overrun %llu, events lost, dumping links and addresses\n",
+	       rtnl->overruns);
 
-	len = recvmsg(fd, &msg, 0);
-	if (len <= 0) {
-		return -1;
+	/* dump links */
+	int rc = rtnl_dump_links(rtnl, parse_message, arg);
+	if (rc) {
+		return rc;
 	}
 
-	for (nh = (struct nlmsghdr *) buf; NLMSG_OK (nh, len);
-	     nh = NLMSG_NEXT (nh, len)) {
-		/* end of multipart message */
-		if (nh->nlmsg_type == NLMSG_DONE) {
-			return 0;
-		}
-		/* error handling */
-		if (nh->nlmsg_type == NLMSG_ERROR) {
-			return -1;
-		}
-		/* parse payload */
-		parse_message(nh);
+	/* dump addresses */
+	char buf[512];
+	struct rtnl_msg msg;
+	rtnl_msg_init(&msg, buf, sizeof(buf));
+	struct ifaddrmsg *ifa = rtnl_msg_add(&msg, RTM_GETADDR, NLM_F_DUMP,
+					     sizeof(*ifa));
+	if (!ifa) {
+		return -EMSGSIZE;
 	}
+	ifa->ifa_family = AF_UNSPEC;
 
-	return 0;
-}
-
-/* read netlink messages from fd */
-void read_messages(int fd) {
-	while (!read_message(fd));
+	return rtnl_dump(rtnl, &msg, parse_message, arg);
 }
 
 int main(int arc, char **argv) {
-	int fd = create_socket();
-	read_messages(fd);
+	struct rtnl rtnl;
+	if (rtnl_open(&rtnl, RTMGRP_LINK | RTMGRP_IPV4_IFADDR |
+		      RTMGRP_IPV6_IFADDR, RTNL_EVENT_RCVBUF, 0)) {
+		printf("Error opening netlink socket\n");
+		return -1;
+	}
+	int rc = rtnl_listen(&rtnl, parse_message, resync, NULL);
+	if (rc) {
+		rtnl_perror(&rtnl, "Error receiving netlink messages", rc);
+		return -1;
+	}
+	return 0;
 }
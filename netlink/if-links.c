@@ -0,0 +1,121 @@
+/* keep a cache of all links, populated by an initial dump and kept current
+ * from interface events, and print changes of the cached links; the names of
+ * interfaces specified in the command line arguments are looked up in the
+ * cache after the initial dump
+ *
+ * each change prints one line:
+ *
+ *   new <ifindex> <name> <kind> <up|down> mtu <mtu> master <ifindex>
+ *   change <ifindex> <name> <field>: <old> -> <new> ...
+ *   del <ifindex> <name>
+ *
+ * if events are lost because the receive buffer overran, the cache is
+ * resynchronized with a dump and only the differences are printed
+ */
+
+/* link cache */
+#include "linkcache.h"
+
+/* printf */
+#include <stdio.h>
+
+/* strcmp(), memcmp() */
+#include <string.h>
+
+/* print state of link */
+void print_link(const char *change, const struct link_info *link) {
+	printf("%s %d %s %s %s mtu %u master %d\n", change, link->ifindex,
+	       link->name, link->kind[0] ? link->kind : "-",
+	       link->flags & IFF_UP ? "up" : "down", link->mtu, link->master);
+}
+
+/* print changed fields of link */
+void print_change(const struct link_info *old, const struct link_info *link) {
+	printf("change %d %s", link->ifindex, link->name);
+	if (strcmp(old->name, link->name)) {
+		printf(" name: %s -> %s", old->name, link->name);
+	}
+	if ((old->flags ^ link->flags) & IFF_UP) {
+		printf(" state: %s -> %s", old->flags & IFF_UP ? "up" : "down",
+		       link->flags & IFF_UP ? "up" : "down");
+	}
+	if ((old->flags ^ link->flags) & IFF_RUNNING) {
+		printf(" running: %s -> %s",
+		       old->flags & IFF_RUNNING ? "yes" : "no",
+		       link->flags & IFF_RUNNING ? "yes" : "no");
+	}
+	if (old->mtu != link->mtu) {
+		printf(" mtu: %u -> %u", old->mtu, link->mtu);
+	}
+	if (old->master != link->master) {
+		printf(" master: %d -> %d", old->master, link->master);
+	}
+	if (old->addr_len != link->addr_len ||
+	    memcmp(old->addr, link->addr, link->addr_len)) {
+		printf(" address");
+	}
+	printf("\n");
+}
+
+/* change callback of link cache */
+void handle_change(enum linkcache_change change, const struct link_info *old,
+		   const struct link_info *link, void *arg) {
+	switch (change) {
+	case LINKCACHE_NEW:
+		print_link("new", link);
+		break;
+	case LINKCACHE_CHANGE:
+		print_change(old, link);
+		break;
+	case LINKCACHE_DEL:
+		printf("del %d %s\n", old->ifindex, old->name);
+		break;
+	}
+	fflush(stdout);
+}
+
+/* resynchronize cache after events were lost */
+int resync(struct rtnl *rtnl, void *arg) {
+	printf("overrun %llu, events lost, resynchronizing\n", rtnl->overruns);
+
+	return linkcache_sync(arg, rtnl);
+}
+
+int main(int argc, char **argv) {
+	struct linkcache cache;
+	if (linkcache_init(&cache, handle_change, NULL)) {
+		printf("Error creating link cache\n");
+		return -1;
+	}
+
+	/* join link group before the dump, so no event is missed */
+	struct rtnl rtnl;
+	if (rtnl_open(&rtnl, RTMGRP_LINK, RTNL_EVENT_RCVBUF, 0)) {
+		printf("Error opening netlink socket\n");
+		return -1;
+	}
+	int rc = linkcache_sync(&cache, &rtnl);
+	if (rc) {
+		rtnl_perror(&rtnl, "Error dumping links", rc);
+		return -1;
+	}
+
+	/* look up specified interfaces */
+	for (int i = 1; i < argc; i++) {
+		const struct link_info *link = linkcache_get_name(&cache,
+								  argv[i]);
+		if (!link) {
+			printf("lookup %s: not found\n", argv[i]);
+			continue;
+		}
+		print_link("lookup", link);
+	}
+
+	/* keep cache current */
+	rc = rtnl_listen(&rtnl, linkcache_handle, resync, &cache);
+	if (rc) {
+		rtnl_perror(&rtnl, "Error receiving netlink messages", rc);
+		return -1;
+	}
+	return 0;
+}
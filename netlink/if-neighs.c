@@ -0,0 +1,204 @@
+/* keep a cache of all ipv4 and ipv6 neighbors, populated by an initial dump
+ * and kept current from neighbor events, and print changes of the cached
+ * neighbors; the neighbors specified in the command line arguments as pairs
+ * of interface name and address are looked up in the cache after the
+ * initial dump
+ *
+ * each change prints one line:
+ *
+ *   new <ifindex> <addr> lladdr <lladdr> <state>
+ *   change <ifindex> <addr> <field>: <old> -> <new> ...
+ *   del <ifindex> <addr>
+ *
+ * unresolved neighbors print "-" as link layer address; if events are lost
+ * because the receive buffer overran, the cache is resynchronized with a
+ * dump and only the differences are printed
+ */
+
+/* neighbor cache */
+#include "neighcache.h"
+
+/* printf */
+#include <stdio.h>
+
+/* memcmp() */
+#include <string.h>
+
+/* if_nametoindex() */
+#include <net/if.h>
+
+/* inet_ntop(), inet_pton() */
+#include <arpa/inet.h>
+
+/* print link layer address of size len */
+void print_lladdr(const unsigned char *lladdr, int len) {
+	if (!len) {
+		printf("-");
+		return;
+	}
+	for (int i = 0; i < len; i++) {
+		printf("%s%02x", i ? ":" : "", lladdr[i]);
+	}
+}
+
+/* print NUD_* state */
+void print_state(__u16 state) {
+	switch (state) {
+	case NUD_INCOMPLETE:
+		printf("incomplete");
+		break;
+	case NUD_REACHABLE:
+		printf("reachable");
+		break;
+	case NUD_STALE:
+		printf("stale");
+		break;
+	case NUD_DELAY:
+		printf("delay");
+		break;
+	case NUD_PROBE:
+		printf("probe");
+		break;
+	case NUD_FAILED:
+		printf("failed");
+		break;
+	case NUD_NOARP:
+		printf("noarp");
+		break;
+	case NUD_PERMANENT:
+		printf("permanent");
+		break;
+	case NUD_NONE:
+		printf("none");
+		break;
+	default:
+		printf("0x%x", state);
+	}
+}
+
+/* print interface and address of neighbor */
+void print_key(const char *change, const struct neigh_info *neigh) {
+	char addr[INET6_ADDRSTRLEN];
+
+	inet_ntop(neigh->family, neigh->addr, addr, sizeof(addr));
+	printf("%s %d %s", change, neigh->ifindex, addr);
+}
+
+/* print state of neighbor */
+void print_neigh(const char *change, const struct neigh_info *neigh) {
+	print_key(change, neigh);
+	printf(" lladdr ");
+	print_lladdr(neigh->lladdr, neigh->lladdr_len);
+	printf(" ");
+	print_state(neigh->state);
+	printf("\n");
+}
+
+/* print changed fields of neighbor */
+void print_change(const struct neigh_info *old,
+		  const struct neigh_info *neigh) {
+	print_key("change", neigh);
+	if (old->lladdr_len != neigh->lladdr_len ||
+	    memcmp(old->lladdr, neigh->lladdr, neigh->lladdr_len)) {
+		printf(" lladdr: ");
+		print_lladdr(old->lladdr, old->lladdr_len);
+		printf(" -> ");
+		print_lladdr(neigh->lladdr, neigh->lladdr_len);
+	}
+	if (old->state != neigh->state) {
+		printf(" state: ");
+		print_state(old->state);
+		printf(" -> ");
+		print_state(neigh->state);
+	}
+	if (old->flags != neigh->flags) {
+		printf(" flags: 0x%x -> 0x%x", old->flags, neigh->flags);
+	}
+	printf("\n");
+}
+
+/* change callback of neighbor cache */
+void handle_change(enum neighcache_change change, const struct neigh_info *old,
+		   const struct neigh_info *neigh, void *arg) {
+	switch (change) {
+	case NEIGHCACHE_NEW:
+		print_neigh("new", neigh);
+		break;
+	case NEIGHCACHE_CHANGE:
+		print_change(old, neigh);
+		break;
+	case NEIGHCACHE_DEL:
+		print_key("del", old);
+		printf("\n");
+		break;
+	}
+	fflush(stdout);
+}
+
+/* resynchronize cache after events were lost */
+int resync(struct rtnl *rtnl, void *arg) {
+	printf("overrun %llu, events lost, resynchronizing\n", rtnl->overruns);
+
+	return neighcache_sync(arg, rtnl);
+}
+
+/* look up link layer address of neighbor with address addr on interface
+ * with name ifname
+ */
+void lookup(struct neighcache *cache, const char *ifname, const char *addr) {
+	unsigned char a[16];
+	unsigned char lladdr[NEIGHCACHE_LLADDR_SIZE];
+	int family = AF_INET;
+
+	if (inet_pton(AF_INET, addr, a) != 1) {
+		family = AF_INET6;
+		if (inet_pton(AF_INET6, addr, a) != 1) {
+			printf("lookup %s %s: invalid address\n", ifname, addr);
+			return;
+		}
+	}
+	int ifindex = if_nametoindex(ifname);
+	int len = neighcache_get_lladdr(cache, ifindex, family, a, lladdr,
+					sizeof(lladdr));
+	if (len < 0) {
+		printf("lookup %s %s: not resolved\n", ifname, addr);
+		return;
+	}
+	printf("lookup %s %s: ", ifname, addr);
+	print_lladdr(lladdr, len);
+	printf("\n");
+}
+
+int main(int argc, char **argv) {
+	struct neighcache cache;
+	if (neighcache_init(&cache, handle_change, NULL)) {
+		printf("Error creating neighbor cache\n");
+		return -1;
+	}
+
+	/* join neighbor group before the dump, so no event is missed */
+	struct rtnl rtnl;
+	if (rtnl_open(&rtnl, RTMGRP_NEIGH, RTNL_EVENT_RCVBUF, 0)) {
+		printf("Error opening netlink socket\n");
+		return -1;
+	}
+	int rc = neighcache_sync(&cache, &rtnl);
+	if (rc) {
+		rtnl_perror(&rtnl, "Error dumping neighbors", rc);
+		return -1;
+	}
+
+	/* look up specified neighbors */
+	for (int i = 1; i + 1 < argc; i += 2) {
+		lookup(&cache, argv[i], argv[i + 1]);
+	}
+	fflush(stdout);
+
+	/* keep cache current */
+	rc = rtnl_listen(&rtnl, neighcache_handle, resync, &cache);
+	if (rc) {
+		rtnl_perror(&rtnl, "Error receiving netlink messages", rc);
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,337 @@
+/* sample statistics of the interfaces specified in the command line
+ * arguments, or of all interfaces if none are specified, once per sampling
+ * interval with RTM_GETSTATS and print their rates; only the 64 bit link
+ * stats are requested, which is much cheaper than getting them with a full
+ * RTM_GETLINK dump; requests for specified interfaces are sent in a single
+ * batch, all interfaces are sampled with a single dump
+ *
+ * each sample prints one line per interface:
+ *
+ *   <time ns> <ifname> <rx pps> <rx bps> <tx pps> <tx bps> <rx dropped>
+ *   <tx dropped> <rx errors> <tx errors>
+ *
+ * rates are per second, dropped packets and errors are deltas since the
+ * previous sample; interfaces are printed from their second sample on;
+ * interfaces missing in a sample are forgotten, and samples with counters
+ * lower than in the previous sample, e.g., of a reset or a new interface
+ * with the same ifindex, are not printed; interface names are refreshed
+ * periodically, so renamed interfaces are printed with their new names
+ *
+ * options:
+ *   -i <ms>  sampling interval in milliseconds (default: 1000)
+ */
+
+/* rtnetlink library */
+#include "rtnl.h"
+
+/* EMSGSIZE, ENOMEM */
+#include <errno.h>
+
+/* printf() */
+#include <stdio.h>
+
+/* atoi(), calloc(), realloc() */
+#include <stdlib.h>
+
+/* memset(), memcpy() */
+#include <string.h>
+
+/* getopt() */
+#include <unistd.h>
+
+/* clock_gettime(), clock_nanosleep() */
+#include <time.h>
+
+/* if_nametoindex(), if_indextoname() */
+#include <net/if.h>
+
+/* IFLA_STATS_* */
+#include <linux/if_link.h>
+
+/* interval in which interface names are refreshed */
+#define NAME_REFRESH_NS (10 * 1000000000ULL)
+
+/* previous sample of an interface */
+struct link {
+	int valid;				/* prev and time_ns are set */
+	char name[IF_NAMESIZE];			/* interface name */
+	__u64 name_ns;				/* time of name refresh */
+	__u64 time_ns;				/* time of previous sample */
+	struct rtnl_link_stats64 prev;		/* previous stats */
+};
+
+/* table of interfaces indexed by ifindex */
+struct links {
+	struct link *links;
+	int size;
+};
+
+/* state of a single sample */
+struct sample {
+	struct links *links;	/* interface table */
+	__u64 time_ns;		/* time the sample was requested */
+	__u32 seq;		/* sequence number of first request */
+	int num;		/* number of requests in batch */
+	int pending;		/* number of outstanding acks of batch */
+};
+
+/* command line options */
+int interval_ms = 1000;
+
+/* get current time in nanoseconds */
+__u64 get_time_ns() {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* get interface with ifindex from table, grow table if needed */
+struct link *get_link(struct links *links, int ifindex) {
+	if (ifindex >= links->size) {
+		int size = links->size ? links->size : 64;
+		while (size <= ifindex) {
+			size *= 2;
+		}
+		struct link *l = realloc(links->links, size * sizeof(*l));
+		if (!l) {
+			return NULL;
+		}
+		memset(l + links->size, 0, (size - links->size) * sizeof(*l));
+		links->links = l;
+		links->size = size;
+	}
+
+	return &links->links[ifindex];
+}
+
+/* compute per second rate of counter delta over interval_ns; in double to
+ * avoid overflows of large byte deltas
+ */
+__u64 get_rate(__u64 delta, __u64 interval_ns) {
+	return interval_ns ? (double) delta * 1000000000.0 / interval_ns : 0;
+}
+
+/* print rates of interface link from stats sampled at time_ns */
+void print_rates(struct link *link, struct rtnl_link_stats64 *stats,
+		 __u64 time_ns) {
+	struct rtnl_link_stats64 *prev = &link->prev;
+	__u64 ns = time_ns - link->time_ns;
+
+	printf("%llu %s %llu %llu %llu %llu %llu %llu %llu %llu\n", time_ns,
+	       link->name,
+	       get_rate(stats->rx_packets - prev->rx_packets, ns),
+	       get_rate(stats->rx_bytes - prev->rx_bytes, ns) * 8,
+	       get_rate(stats->tx_packets - prev->tx_packets, ns),
+	       get_rate(stats->tx_bytes - prev->tx_bytes, ns) * 8,
+	       stats->rx_dropped - prev->rx_dropped,
+	       stats->tx_dropped - prev->tx_dropped,
+	       stats->rx_errors - prev->rx_errors,
+	       stats->tx_errors - prev->tx_errors);
+}
+
+/* check if a counter in stats is lower than in prev, i.e., the counters
+ * were reset
+ */
+int is_reset(struct rtnl_link_stats64 *prev, struct rtnl_link_stats64 *stats) {
+	return stats->rx_packets < prev->rx_packets ||
+		stats->rx_bytes < prev->rx_bytes ||
+		stats->tx_packets < prev->tx_packets ||
+		stats->tx_bytes < prev->tx_bytes ||
+		stats->rx_dropped < prev->rx_dropped ||
+		stats->tx_dropped < prev->tx_dropped ||
+		stats->rx_errors < prev->rx_errors ||
+		stats->tx_errors < prev->tx_errors;
+}
+
+/* forget interfaces that are not in the sample taken at time_ns; they were
+ * removed and their ifindex can be reused by new interfaces
+ */
+void expire_links(struct links *links, __u64 time_ns) {
+	for (int i = 0; i < links->size; i++) {
+		if (links->links[i].time_ns != time_ns) {
+			links->links[i].valid = 0;
+		}
+	}
+}
+
+/* parse stats netlink message */
+int parse_stats_message(struct sample *sample, struct nlmsghdr *nh) {
+	struct if_stats_msg *ifsm = NLMSG_DATA(nh);
+
+	struct rtattr *tb[IFLA_STATS_MAX + 1];
+	rtnl_parse_attrs(tb, IFLA_STATS_MAX, RTNL_ATTRS(nh, sizeof(*ifsm)),
+			 RTNL_ATTRS_LEN(nh, sizeof(*ifsm)));
+	if (!tb[IFLA_STATS_LINK_64]) {
+		return 0;
+	}
+	struct rtnl_link_stats64 *stats = RTA_DATA(tb[IFLA_STATS_LINK_64]);
+
+	struct link *link = get_link(sample->links, ifsm->ifindex);
+	if (!link) {
+		return -ENOMEM;
+	}
+	if (!link->valid ||
+	    sample->time_ns - link->name_ns >= NAME_REFRESH_NS) {
+		/* get name of new interfaces and refresh it periodically;
+		 * keep the old name if the interface is gone by now
+		 */
+		char name[IF_NAMESIZE];
+		if (if_indextoname(ifsm->ifindex, name)) {
+			memcpy(link->name, name, sizeof(name));
+		} else if (!link->valid) {
+			snprintf(link->name, sizeof(link->name), "%u",
+				 ifsm->ifindex);
+		}
+		link->name_ns = sample->time_ns;
+	}
+	if (link->valid && !is_reset(&link->prev, stats)) {
+		print_rates(link, stats, sample->time_ns);
+	}
+	link->prev = *stats;
+	link->time_ns = sample->time_ns;
+	link->valid = 1;
+
+	return 0;
+}
+
+/* parse netlink message */
+int parse_message(struct nlmsghdr *nh, void *arg) {
+	switch (nh->nlmsg_type) {
+	case RTM_NEWSTATS:
+		return parse_stats_message(arg, nh);
+	}
+
+	return 0;
+}
+
+/* handle reply message of a batch of get requests */
+int handle_reply(struct nlmsghdr *nh, void *arg) {
+	struct sample *sample = arg;
+
+	if (nh->nlmsg_seq - sample->seq >= (__u32) sample->num) {
+		return 0;
+	}
+	if (nh->nlmsg_type == NLMSG_ERROR) {
+		/* ack, ignore errors of removed interfaces */
+		return --sample->pending == 0 ? 1 : 0;
+	}
+
+	return parse_message(nh, arg);
+}
+
+/* add stats request for interface with ifindex, 0 for all, to batch */
+int add_request(struct rtnl_msg *msg, int ifindex) {
+	struct if_stats_msg *ifsm = rtnl_msg_add(msg, RTM_GETSTATS,
+						 ifindex ? 0 : NLM_F_DUMP,
+						 sizeof(*ifsm));
+	if (!ifsm) {
+		return -EMSGSIZE;
+	}
+	ifsm->family = AF_UNSPEC;
+	ifsm->ifindex = ifindex;
+	ifsm->filter_mask = IFLA_STATS_FILTER_BIT(IFLA_STATS_LINK_64);
+
+	return 0;
+}
+
+/* take a single sample of the interfaces in batch msg */
+int take_sample(struct rtnl *rtnl, struct rtnl_msg *msg,
+		struct sample *sample) {
+	sample->time_ns = get_time_ns();
+
+	/* dump all interfaces */
+	if (msg->num == 1 && msg->hdr->nlmsg_flags & NLM_F_DUMP) {
+		return rtnl_dump(rtnl, msg, parse_message, sample);
+	}
+
+	/* get specified interfaces */
+	int rc = rtnl_send(rtnl, msg);
+	if (rc) {
+		return rc;
+	}
+	sample->seq = msg->seq;
+	sample->num = msg->num;
+	sample->pending = msg->num;
+	while (!(rc = rtnl_recv(rtnl, handle_reply, sample)));
+
+	return rc > 0 ? 0 : rc;
+}
+
+/* sample interfaces in batch msg once per interval */
+int sample_links(struct rtnl *rtnl, struct rtnl_msg *msg) {
+	__u64 interval_ns = interval_ms * 1000000ULL;
+	__u64 next_ns = get_time_ns();
+	struct links links = { NULL, 0 };
+	struct sample sample = { &links, 0, 0, 0, 0 };
+	struct timespec next;
+
+	while (1) {
+		int rc = take_sample(rtnl, msg, &sample);
+		if (rc) {
+			return rc;
+		}
+		expire_links(&links, sample.time_ns);
+
+		/* write output of this sample at once */
+		fflush(stdout);
+
+		/* sleep until next sample at a fixed rate */
+		next_ns += interval_ns;
+		next.tv_sec = next_ns / 1000000000ULL;
+		next.tv_nsec = next_ns % 1000000000ULL;
+		clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+	}
+}
+
+int main(int argc, char **argv) {
+	/* handle command line arguments */
+	int opt;
+	while ((opt = getopt(argc, argv, "i:")) != -1) {
+		switch (opt) {
+		case 'i':
+			interval_ms = atoi(optarg);
+			break;
+		default:
+			return -1;
+		}
+	}
+	if (interval_ms <= 0) {
+		return -1;
+	}
+
+	/* create requests once, they are resent for every sample */
+	int num_ifs = argc - optind;
+	size_t size = (num_ifs ? num_ifs : 1) * 64;
+	char *buf = calloc(1, size);
+	if (!buf) {
+		return -1;
+	}
+	struct rtnl_msg msg;
+	rtnl_msg_init(&msg, buf, size);
+	if (!num_ifs && add_request(&msg, 0)) {
+		return -1;
+	}
+	for (int i = 0; i < num_ifs; i++) {
+		int ifindex = if_nametoindex(argv[optind + i]);
+		if (!ifindex) {
+			printf("Error: unknown interface %s\n", argv[optind + i]);
+			return -1;
+		}
+		if (add_request(&msg, ifindex)) {
+			return -1;
+		}
+	}
+
+	struct rtnl rtnl;
+	if (rtnl_open(&rtnl, 0, 0, 0)) {
+		printf("Error opening netlink socket\n");
+		return -1;
+	}
+	int rc = sample_links(&rtnl, &msg);
+	if (rc) {
+		rtnl_perror(&rtnl, "Error", rc);
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,137 @@
+/* keep a cache of the ipv4 and ipv6 unicast routes of the main routing
+ * table, populated by an initial dump and kept current from route events,
+ * and print changes of the cached routes; the addresses specified in the
+ * command line arguments are looked up in the cache after the initial dump
+ *
+ * each change prints one line:
+ *
+ *   new <prefix>/<len> metric <metric> via <gateway> dev <ifindex>
+ *   change <prefix>/<len> metric <metric> via <gateway> dev <ifindex> -> via
+ *     <gateway> dev <ifindex>
+ *   del <prefix>/<len> metric <metric> dev <ifindex>
+ *
+ * routes to the same prefix with different metrics or via different links,
+ * including the next hops of multipath routes, are cached and printed
+ * separately, lookups return the route with the lowest metric; routes
+ * without a gateway print "-" as gateway; if events are lost because the
+ * receive buffer overran, the cache is resynchronized with a dump and only
+ * the differences are printed
+ */
+
+/* route cache */
+#include "routecache.h"
+
+/* printf */
+#include <stdio.h>
+
+/* inet_ntop(), inet_pton() */
+#include <arpa/inet.h>
+
+/* print next hop */
+void print_nh(const struct route_nh *nh) {
+	char gw[INET6_ADDRSTRLEN] = "-";
+
+	if (nh->family != AF_UNSPEC) {
+		inet_ntop(nh->family, nh->gw, gw, sizeof(gw));
+	}
+	printf("via %s dev %d", gw, nh->oif);
+}
+
+/* print prefix and metric of route */
+void print_prefix(const struct route_info *route) {
+	char dst[INET6_ADDRSTRLEN];
+
+	inet_ntop(route->family, route->dst, dst, sizeof(dst));
+	printf("%s/%u metric %u", dst, route->dst_len, route->priority);
+}
+
+/* change callback of route cache */
+void handle_change(enum routecache_change change, const struct route_info *old,
+		   const struct route_info *route, void *arg) {
+	struct routecache *cache = arg;
+
+	switch (change) {
+	case ROUTECACHE_NEW:
+		printf("new ");
+		print_prefix(route);
+		printf(" ");
+		print_nh(routecache_nh(cache, route->nh));
+		break;
+	case ROUTECACHE_CHANGE:
+		printf("change ");
+		print_prefix(route);
+		printf(" ");
+		print_nh(routecache_nh(cache, old->nh));
+		printf(" -> ");
+		print_nh(routecache_nh(cache, route->nh));
+		break;
+	case ROUTECACHE_DEL:
+		printf("del ");
+		print_prefix(old);
+		printf(" dev %d", old->oif);
+		break;
+	}
+	printf("\n");
+	fflush(stdout);
+}
+
+/* resynchronize cache after events were lost */
+int resync(struct rtnl *rtnl, void *arg) {
+	printf("overrun %llu, events lost, resynchronizing\n", rtnl->overruns);
+
+	return routecache_sync(arg, rtnl);
+}
+
+int main(int argc, char **argv) {
+	struct routecache cache;
+	if (routecache_init(&cache, handle_change, &cache)) {
+		printf("Error creating route cache\n");
+		return -1;
+	}
+
+	/* join route groups before the dump, so no event is missed, and the
+	 * link group for routes removed with their links
+	 */
+	struct rtnl rtnl;
+	if (rtnl_open(&rtnl, RTMGRP_LINK | RTMGRP_IPV4_ROUTE |
+		      RTMGRP_IPV6_ROUTE, RTNL_EVENT_RCVBUF, 0)) {
+		printf("Error opening netlink socket\n");
+		return -1;
+	}
+	int rc = routecache_sync(&cache, &rtnl);
+	if (rc) {
+		rtnl_perror(&rtnl, "Error dumping routes", rc);
+		return -1;
+	}
+
+	/* look up specified addresses */
+	for (int i = 1; i < argc; i++) {
+		unsigned char addr[16];
+		int family = AF_INET;
+		if (inet_pton(AF_INET, argv[i], addr) != 1) {
+			family = AF_INET6;
+			if (inet_pton(AF_INET6, argv[i], addr) != 1) {
+				printf("lookup %s: invalid address\n", argv[i]);
+				continue;
+			}
+		}
+		const struct route_nh *nh = routecache_lookup(&cache, family,
+							      addr);
+		if (!nh) {
+			printf("lookup %s: no route\n", argv[i]);
+			continue;
+		}
+		printf("lookup %s: ", argv[i]);
+		print_nh(nh);
+		printf("\n");
+	}
+	fflush(stdout);
+
+	/* keep cache current */
+	rc = rtnl_listen(&rtnl, routecache_handle, resync, &cache);
+	if (rc) {
+		rtnl_perror(&rtnl, "Error receiving netlink messages", rc);
+		return -1;
+	}
+	return 0;
+}
@@ -1,33 +1,9 @@
-/* netlink imports */
-#include <asm/types.h>
-#include <sys/socket.h>
-#include <linux/netlink.h>
-#include <linux/rtnetlink.h>
-
-/* memset */
-#include <string.h>
+/* rtnetlink library */
+#include "rtnl.h"
 
 /* printf */
 #include <stdio.h>
 
-/* create netlink socket and return socket fd */
-int create_socket() {
-	struct sockaddr_nl sa;
-
-	memset(&sa, 0, sizeof(sa));
-	sa.nl_family = AF_NETLINK;
-	sa.nl_groups = RTMGRP_LINK;
-
-	int fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
-	if (fd < 0) {
-		return fd;
-	}
-	if (bind(fd, (struct sockaddr *) &sa, sizeof(sa))) {
-		return -1;
-	}
-	return fd;
-}
-
 /* print stats */
 void print_stats(struct rtnl_link_stats *stats) {
 	printf("  stats: \n"
@@ -132,13 +108,13 @@ int parse_rta(struct rtattr *rta) {
 
 /* parse link netlink message */
 int parse_link_message(struct nlmsghdr *nh) {
-	struct ifinfomsg *ifi = (struct ifinfomsg *)(nh + 1);
+	struct ifinfomsg *ifi = NLMSG_DATA(nh);
 
 	/* parse attributes */
-	int len = nh->nlmsg_len - sizeof(*ifi);
+	int len = RTNL_ATTRS_LEN(nh, sizeof(*ifi));
 	struct rtattr *rta;
-	for (rta = (struct rtattr *) (ifi + 1); RTA_OK (rta, len);
-	     rta = RTA_NEXT (rta, len)) {
+	for (rta = RTNL_ATTRS(nh, sizeof(*ifi)); RTA_OK(rta, len);
+	     rta = RTA_NEXT(rta, len)) {
 		parse_rta(rta);
 	}
 
@@ -146,7 +122,7 @@ int parse_link_message(struct nlmsghdr *nh) {
 }
 
 /* parse netlink message */
-int parse_message(struct nlmsghdr *nh) {
+int parse_message(struct nlmsghdr *nh, void *arg) {
 	switch (nh->nlmsg_type) {
 	case RTM_NEWLINK:
 		parse_link_message(nh);
@@ -156,45 +132,23 @@ int parse_message(struct nlmsghdr *nh) {
 	return 0;
 }
 
-/* read a single netlink messages from socket fd */
-int read_message(int fd) {
-	/* 8192 to avoid msg truncation on platforms with page size > 4096 */
-	struct nlmsghdr buf[8192/sizeof(struct nlmsghdr)];
-	struct iovec iov = { buf, sizeof(buf) };
-	struct sockaddr_nl sa;
-	struct nlmsghdr *nh;
-	int len;
+/* dump all links to resynchronize after events were lost */
+int resync(struct rtnl *rtnl, void *arg) {
+	printf("overrun %llu, events lost, dumping links\n", rtnl->overruns);
 
-	struct msghdr msg = { &sa, sizeof(sa), &iov, 1, NULL, 0, 0 };
+	return rtnl_dump_links(rtnl, parse_message, arg);
+}
 
-	len = recvmsg(fd, &msg, 0);
-	if (len <= 0) {
+int main(int arc, char **argv) {
+	struct rtnl rtnl;
+	if (rtnl_open(&rtnl, RTMGRP_LINK, RTNL_EVENT_RCVBUF, 0)) {
+		printf("Error opening netlink socket\n");
 		return -1;
 	}
-
-	for (nh = (struct nlmsghdr *) buf; NLMSG_OK (nh, len);
-	     nh = NLMSG_NEXT (nh, len)) {
-		/* end of multipart message */
-		if (nh->nlmsg_type == NLMSG_DONE) {
-			return 0;
-		}
-		/* error handling */
-		if (nh->nlmsg_type == NLMSG_ERROR) {
-			return -1;
-		}
-		/* parse payload */
-		parse_message(nh);
+	int rc = rtnl_listen(&rtnl, parse_message, resync, NULL);
+	if (rc) {
+		rtnl_perror(&rtnl, "Error receiving netlink messages", rc);
+		return -1;
 	}
-
 	return 0;
 }
-
-/* read netlink messages from fd */
-void read_messages(int fd) {
-	while (!read_message(fd));
-}
-
-int main(int arc, char **argv) {
-	int fd = create_socket();
-	read_messages(fd);
-}
@@ -0,0 +1,235 @@
+/* in-memory link cache, see linkcache.h */
+
+#include "linkcache.h"
+
+/* memset(), memcpy(), memcmp(), strcmp(), strncpy() */
+#include <string.h>
+
+/* EMSGSIZE */
+#include <errno.h>
+
+/* IFLA_* */
+#include <linux/if_link.h>
+
+/* keys of links */
+enum {
+	BY_INDEX,
+	BY_NAME,
+};
+
+/* hash of ifindex of link */
+static __u32 hash_index(const void *entry) {
+	const struct link_info *info = entry;
+
+	return (__u32) info->ifindex * 2654435761U;
+}
+
+/* check if links have the same ifindex */
+static int equal_index(const void *a, const void *b) {
+	return ((const struct link_info *) a)->ifindex ==
+		((const struct link_info *) b)->ifindex;
+}
+
+/* hash of name of link, fnv-1a */
+static __u32 hash_name(const void *entry) {
+	const char *name = ((const struct link_info *) entry)->name;
+	__u32 hash = 2166136261U;
+
+	for (; *name; name++) {
+		hash ^= (unsigned char) *name;
+		hash *= 16777619U;
+	}
+
+	return hash;
+}
+
+/* check if links have the same name */
+static int equal_name(const void *a, const void *b) {
+	return !strcmp(((const struct link_info *) a)->name,
+		       ((const struct link_info *) b)->name);
+}
+
+/* links are found by ifindex and by name */
+static const struct cache_key keys[] = {
+	[BY_INDEX] = { hash_index, equal_index, 0 },
+	[BY_NAME] = { hash_name, equal_name, 0 },
+};
+
+/* initialize empty link cache */
+int linkcache_init(struct linkcache *cache, linkcache_cb cb, void *arg) {
+	cache->cb = cb;
+	cache->arg = arg;
+
+	return cache_init(&cache->cache, sizeof(struct link_info), keys,
+			  sizeof(keys) / sizeof(keys[0]));
+}
+
+/* free all memory of link cache */
+void linkcache_free(struct linkcache *cache) {
+	cache_free(&cache->cache);
+}
+
+/* remove link at position i */
+static void remove_link(struct cache *c, int i, void *arg) {
+	struct linkcache *cache = arg;
+
+	if (cache->cb) {
+		cache->cb(LINKCACHE_DEL, cache_entry(c, i), NULL, cache->arg);
+	}
+	cache_remove(c, i);
+}
+
+/* add or update link with state info */
+static int update_link(struct linkcache *cache, struct link_info *info) {
+	struct cache *c = &cache->cache;
+
+	/* a link with the same name but another ifindex is stale, names are
+	 * unique
+	 */
+	int i = cache_find(c, BY_NAME, info);
+	if (i != CACHE_NONE && !equal_index(cache_entry(c, i), info)) {
+		remove_link(c, i, cache);
+	}
+
+	/* update existing link, renames are handled by the cache */
+	i = cache_find(c, BY_INDEX, info);
+	if (i != CACHE_NONE) {
+		struct link_info old = *(struct link_info *) cache_entry(c, i);
+		cache_update(c, i, info);
+		if (cache->cb && memcmp(&old, info, sizeof(*info))) {
+			cache->cb(LINKCACHE_CHANGE, &old, info, cache->arg);
+		}
+		return 0;
+	}
+
+	/* add new link */
+	int rc = cache_add(c, info);
+	if (rc < 0) {
+		return rc;
+	}
+	if (cache->cb) {
+		cache->cb(LINKCACHE_NEW, NULL, info, cache->arg);
+	}
+
+	return 0;
+}
+
+/* parse link message nh into info */
+static void parse_link(struct nlmsghdr *nh, struct link_info *info) {
+	struct ifinfomsg *ifi = NLMSG_DATA(nh);
+
+	/* zero everything including padding, infos are compared as a whole */
+	memset(info, 0, sizeof(*info));
+	info->ifindex = ifi->ifi_index;
+	info->flags = ifi->ifi_flags;
+	info->type = ifi->ifi_type;
+
+	struct rtattr *tb[IFLA_MAX + 1];
+	rtnl_parse_attrs(tb, IFLA_MAX, RTNL_ATTRS(nh, sizeof(*ifi)),
+			 RTNL_ATTRS_LEN(nh, sizeof(*ifi)));
+	if (tb[IFLA_IFNAME]) {
+		strncpy(info->name, RTA_DATA(tb[IFLA_IFNAME]),
+			sizeof(info->name) - 1);
+	}
+	if (tb[IFLA_MTU]) {
+		info->mtu = *(__u32 *) RTA_DATA(tb[IFLA_MTU]);
+	}
+	if (tb[IFLA_OPERSTATE]) {
+		info->operstate = *(__u8 *) RTA_DATA(tb[IFLA_OPERSTATE]);
+	}
+	if (tb[IFLA_ADDRESS] &&
+	    RTA_PAYLOAD(tb[IFLA_ADDRESS]) <= sizeof(info->addr)) {
+		info->addr_len = RTA_PAYLOAD(tb[IFLA_ADDRESS]);
+		memcpy(info->addr, RTA_DATA(tb[IFLA_ADDRESS]), info->addr_len);
+	}
+	if (tb[IFLA_MASTER]) {
+		info->master = *(__u32 *) RTA_DATA(tb[IFLA_MASTER]);
+	}
+	if (tb[IFLA_LINK]) {
+		info->link = *(__u32 *) RTA_DATA(tb[IFLA_LINK]);
+	}
+	if (tb[IFLA_LINKINFO]) {
+		struct rtattr *linkinfo[IFLA_INFO_MAX + 1];
+		rtnl_parse_attrs(linkinfo, IFLA_INFO_MAX,
+				 RTA_DATA(tb[IFLA_LINKINFO]),
+				 RTA_PAYLOAD(tb[IFLA_LINKINFO]));
+		if (linkinfo[IFLA_INFO_KIND]) {
+			strncpy(info->kind, RTA_DATA(linkinfo[IFLA_INFO_KIND]),
+				sizeof(info->kind) - 1);
+		}
+	}
+}
+
+/* apply link message to cache */
+int linkcache_handle(struct nlmsghdr *nh, void *arg) {
+	struct linkcache *cache = arg;
+
+	if (nh->nlmsg_type != RTM_NEWLINK && nh->nlmsg_type != RTM_DELLINK) {
+		return 0;
+	}
+	struct ifinfomsg *ifi = NLMSG_DATA(nh);
+	if (nh->nlmsg_len < NLMSG_LENGTH(sizeof(*ifi))) {
+		return 0;
+	}
+
+	/* messages of other families, e.g., AF_BRIDGE port events, do not
+	 * add or remove links
+	 */
+	if (ifi->ifi_family != AF_UNSPEC) {
+		return 0;
+	}
+
+	struct link_info info;
+	parse_link(nh, &info);
+	if (nh->nlmsg_type == RTM_DELLINK) {
+		int i = cache_find(&cache->cache, BY_INDEX, &info);
+		if (i != CACHE_NONE) {
+			remove_link(&cache->cache, i, cache);
+		}
+		return 0;
+	}
+
+	return update_link(cache, &info);
+}
+
+/* dump all links and synchronize cache with them */
+int linkcache_sync(struct linkcache *cache, struct rtnl *rtnl) {
+	char buf[512];
+	struct rtnl_msg msg;
+	rtnl_msg_init(&msg, buf, sizeof(buf));
+	struct ifinfomsg *ifi = rtnl_msg_add(&msg, RTM_GETLINK, NLM_F_DUMP,
+					     sizeof(*ifi));
+	if (!ifi) {
+		return -EMSGSIZE;
+	}
+	ifi->ifi_family = AF_UNSPEC;
+
+	/* neither virtual functions nor their statistics are cached, so
+	 * request no RTEXT_FILTER_VF and set RTEXT_FILTER_SKIP_STATS; the
+	 * kernel still sends the IFLA_STATS and IFLA_STATS64 of each link
+	 */
+	rtnl_attr_add_u32(&msg, IFLA_EXT_MASK, RTEXT_FILTER_SKIP_STATS);
+
+	return cache_sync(&cache->cache, rtnl, &msg, linkcache_handle, cache,
+			  remove_link);
+}
+
+/* get link by ifindex */
+const struct link_info *linkcache_get_index(struct linkcache *cache,
+					    int ifindex) {
+	struct link_info key = { .ifindex = ifindex };
+	int i = cache_find(&cache->cache, BY_INDEX, &key);
+
+	return i != CACHE_NONE ? cache_entry(&cache->cache, i) : NULL;
+}
+
+/* get link by name */
+const struct link_info *linkcache_get_name(struct linkcache *cache,
+					   const char *name) {
+	struct link_info key;
+	strncpy(key.name, name, sizeof(key.name) - 1);
+	key.name[sizeof(key.name) - 1] = 0;
+	int i = cache_find(&cache->cache, BY_NAME, &key);
+
+	return i != CACHE_NONE ? cache_entry(&cache->cache, i) : NULL;
+}
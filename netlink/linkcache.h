@@ -0,0 +1,103 @@
+/* in-memory cache of all links of a network namespace, populated by a dump
+ * and kept current from RTM_NEWLINK and RTM_DELLINK events; links are stored
+ * in a dense array and found by ifindex and by name with open addressing
+ * hash tables, so lookups do not need any syscalls
+ *
+ * build a tool together with the cache, the generic cache and the rtnetlink
+ * library, e.g.:
+ *
+ *   gcc if-links.c linkcache.c cache.c rtnl.c -o if-links
+ */
+
+#ifndef LINKCACHE_H
+#define LINKCACHE_H
+
+/* generic cache and rtnetlink library */
+#include "cache.h"
+
+/* IF_NAMESIZE */
+#include <net/if.h>
+
+/* maximum length of link kinds and hardware addresses */
+#define LINKCACHE_KIND_SIZE 16
+#define LINKCACHE_ADDR_SIZE 32
+
+/* cached state of a link */
+struct link_info {
+	int ifindex;				/* interface index */
+	char name[IF_NAMESIZE];			/* interface name */
+	char kind[LINKCACHE_KIND_SIZE];		/* kind, e.g., "veth" */
+	__u32 flags;				/* IFF_* flags */
+	__u32 mtu;				/* mtu */
+	__u16 type;				/* ARPHRD_* type */
+	__u8 operstate;				/* IF_OPER_* state */
+	__u8 addr_len;				/* length of addr */
+	unsigned char addr[LINKCACHE_ADDR_SIZE];/* hardware address */
+	int master;				/* ifindex of master or 0 */
+	int link;				/* ifindex of lower link or 0 */
+};
+
+/* change of a link passed to the change callback */
+enum linkcache_change {
+	LINKCACHE_NEW,		/* link was added */
+	LINKCACHE_CHANGE,	/* state of link changed */
+	LINKCACHE_DEL,		/* link was removed */
+};
+
+/* change callback; old is the previous state (NULL for new links), link the
+ * current state (NULL for removed links); both are only valid during the
+ * call
+ */
+typedef void (*linkcache_cb)(enum linkcache_change change,
+			     const struct link_info *old,
+			     const struct link_info *link, void *arg);
+
+/* link cache */
+struct linkcache {
+	struct cache cache;	/* links by ifindex and by name */
+	linkcache_cb cb;	/* change callback or NULL */
+	void *arg;		/* argument of change callback */
+};
+
+/* initialize empty link cache with change callback cb (NULL for none) and
+ * its argument arg; return 0 or a negative error
+ */
+int linkcache_init(struct linkcache *cache, linkcache_cb cb, void *arg);
+
+/* free all memory of link cache */
+void linkcache_free(struct linkcache *cache);
+
+/* apply RTM_NEWLINK or RTM_DELLINK message nh to cache and call the change
+ * callback if the cached state changed; other messages are ignored, so this
+ * can be used as, or called from, an rtnl_cb; return 0 or a negative error
+ */
+int linkcache_handle(struct nlmsghdr *nh, void *cache);
+
+/* dump all links and synchronize the cache with them; links missing in the
+ * dump are removed, so this also resynchronizes a cache that missed events;
+ * return 0 or a negative error
+ */
+int linkcache_sync(struct linkcache *cache, struct rtnl *rtnl);
+
+/* get link by ifindex, NULL if not found */
+const struct link_info *linkcache_get_index(struct linkcache *cache,
+					    int ifindex);
+
+/* get link by name, NULL if not found */
+const struct link_info *linkcache_get_name(struct linkcache *cache,
+					   const char *name);
+
+/* get number of links */
+static inline int linkcache_num(struct linkcache *cache) {
+	return cache->cache.num;
+}
+
+/* get link at position i in the link array, 0 <= i < linkcache_num(), e.g.,
+ * to iterate over all links; positions change when links are removed
+ */
+static inline const struct link_info *linkcache_get(struct linkcache *cache,
+						    int i) {
+	return cache_entry(&cache->cache, i);
+}
+
+#endif
@@ -0,0 +1,281 @@
+/* benchmark the longest prefix match table: load random prefixes with a
+ * prefix length distribution similar to a full bgp table, look up random
+ * addresses and print load time and lookups per second
+ *
+ * options:
+ *   -n <num>: number of prefixes, default 1000000 for ipv4 and 200000 for
+ *             ipv6, about the sizes of full bgp tables
+ *   -l <num>: number of lookups, default 100000000
+ *   -6: use ipv6 prefixes instead of ipv4 prefixes
+ *   -c: check lookups and removals against a naive lookup that probes all
+ *       prefix lengths in the prefix hash table, with fewer lookups
+ *
+ * build together with the table:
+ *
+ *   gcc -O2 lpm-bench.c lpm.c -o lpm-bench
+ */
+
+/* longest prefix match table */
+#include "lpm.h"
+
+/* printf() */
+#include <stdio.h>
+
+/* getopt() */
+#include <unistd.h>
+
+/* strtoul(), malloc() */
+#include <stdlib.h>
+
+/* memcpy() */
+#include <string.h>
+
+/* clock_gettime() */
+#include <time.h>
+
+/* AF_INET, AF_INET6 */
+#include <sys/socket.h>
+
+/* ipv4 prefix length distribution of a bgp table in percent of prefixes */
+static const int dist4[][2] = {
+	{24, 60}, {23, 10}, {22, 12}, {21, 5}, {20, 4}, {19, 3}, {18, 2},
+	{17, 1}, {16, 2}, {15, 0}, {8, 0}, {25, 1},
+};
+
+/* ipv6 prefix length distribution of a bgp table in percent of prefixes */
+static const int dist6[][2] = {
+	{48, 50}, {44, 8}, {40, 8}, {36, 4}, {32, 15}, {29, 4}, {28, 3},
+	{64, 4}, {56, 2}, {47, 1}, {46, 1},
+};
+
+/* xorshift64 random number generator, fast enough not to dominate lookups */
+static __u64 rand_state = 88172645463325252ULL;
+
+static __u64 next_rand(void) {
+	rand_state ^= rand_state << 13;
+	rand_state ^= rand_state >> 7;
+	rand_state ^= rand_state << 17;
+	return rand_state;
+}
+
+/* fill addr of len bytes with random bytes */
+static void rand_addr(unsigned char *addr, int len) {
+	for (int i = 0; i < len; i += 8) {
+		__u64 r = next_rand();
+		memcpy(addr + i, &r, len - i < 8 ? len - i : 8);
+	}
+}
+
+/* set first 32 bits of ipv6 addr to a random allocation of allocs, like in
+ * real bgp tables, where most prefixes are in or are the allocations of
+ * registries to networks
+ */
+static void rand_alloc(unsigned char *addr, const __u32 *allocs, int num) {
+	__u32 alloc = allocs[next_rand() % num];
+
+	addr[0] = alloc >> 24;
+	addr[1] = alloc >> 16;
+	addr[2] = alloc >> 8;
+	addr[3] = alloc;
+}
+
+/* get random prefix length from distribution */
+static int rand_len(int family) {
+	const int (*dist)[2] = family == AF_INET ? dist4 : dist6;
+	int num = family == AF_INET ? sizeof(dist4) / sizeof(dist4[0]) :
+		sizeof(dist6) / sizeof(dist6[0]);
+	int r = next_rand() % 100;
+
+	for (int i = 0; i < num; i++) {
+		if (r < dist[i][1]) {
+			return dist[i][0];
+		}
+		r -= dist[i][1];
+	}
+	return dist[0][0];
+}
+
+/* get current time in seconds */
+static double now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* look up addr by probing all prefix lengths from longest to shortest */
+static int naive_lookup(struct lpm *lpm, const unsigned char *addr,
+			__u32 *nh) {
+	for (int len = lpm->addr_len * 8; len >= 0; len--) {
+		if (!lpm_get(lpm, addr, len, nh)) {
+			return 0;
+		}
+	}
+	return -1;
+}
+
+/* compare lookups of num random addresses, half of them in prefixes, with
+ * naive lookups; return number of mismatches
+ */
+static int check(struct lpm *lpm, unsigned char *prefixes, int num_prefixes,
+		 int num) {
+	int addr_len = lpm->addr_len;
+	int errors = 0;
+
+	for (int i = 0; i < num; i++) {
+		unsigned char addr[16];
+		rand_addr(addr, addr_len);
+		if (i % 2) {
+			/* keep the first bytes of a prefix */
+			int p = next_rand() % num_prefixes;
+			memcpy(addr, prefixes + p * addr_len, addr_len / 2);
+		}
+
+		__u32 nh1 = 0, nh2 = 0;
+		int rc1 = lpm_lookup(lpm, addr, &nh1);
+		int rc2 = naive_lookup(lpm, addr, &nh2);
+		if (rc1 != rc2 || nh1 != nh2) {
+			errors++;
+		}
+	}
+
+	return errors;
+}
+
+int main(int argc, char **argv) {
+	unsigned long num_prefixes = 0;
+	unsigned long num_lookups = 100000000;
+	int family = AF_INET;
+	int check_mode = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:l:6c")) != -1) {
+		switch (opt) {
+		case 'n':
+			num_prefixes = strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			num_lookups = strtoul(optarg, NULL, 0);
+			break;
+		case '6':
+			family = AF_INET6;
+			break;
+		case 'c':
+			check_mode = 1;
+			break;
+		default:
+			printf("Usage: %s [-n num] [-l num] [-6] [-c]\n",
+			       argv[0]);
+			return -1;
+		}
+	}
+	if (num_prefixes == 0) {
+		num_prefixes = family == AF_INET ? 1000000 : 200000;
+	}
+	if (num_prefixes > LPM_MAX_NH) {
+		printf("Invalid number of prefixes\n");
+		return -1;
+	}
+
+	/* generate prefixes and addresses before timing */
+	struct lpm lpm;
+	if (lpm_init(&lpm, family)) {
+		printf("Error creating table\n");
+		return -1;
+	}
+	int addr_len = lpm.addr_len;
+	int num_allocs = num_prefixes / 8 + 1;
+	__u32 *allocs = malloc(num_allocs * sizeof(__u32));
+	unsigned char *prefixes = malloc(num_prefixes * addr_len);
+	int *lens = malloc(num_prefixes * sizeof(int));
+	for (int i = 0; i < num_allocs; i++) {
+		/* global unicast allocations are in 2000::/3 */
+		allocs[i] = 0x20000000 | (next_rand() & 0x1fffffff);
+	}
+	if (!allocs || !prefixes || !lens) {
+		printf("Error allocating prefixes\n");
+		return -1;
+	}
+	for (unsigned long i = 0; i < num_prefixes; i++) {
+		unsigned char *prefix = prefixes + i * addr_len;
+		rand_addr(prefix, addr_len);
+		if (addr_len == 16) {
+			rand_alloc(prefix, allocs, num_allocs);
+		}
+		lens[i] = rand_len(family);
+	}
+
+	/* load prefixes */
+	double start = now();
+	for (unsigned long i = 0; i < num_prefixes; i++) {
+		int rc = lpm_add(&lpm, prefixes + i * addr_len, lens[i], i);
+		if (rc) {
+			printf("Error adding prefix: %d\n", rc);
+			return -1;
+		}
+	}
+	double load = now() - start;
+	printf("loaded %u prefixes in %.3f s (%.0f prefixes/s), %u groups "
+	       "(%.1f MB)\n", lpm.num_rules, load, num_prefixes / load,
+	       lpm.num_groups, lpm.num_groups * 256.0 * 4 / 1e6);
+
+	/* check lookups, then remove half of the prefixes and check again */
+	if (check_mode) {
+		int num = num_lookups < 1000000 ? num_lookups : 1000000;
+		int errors = check(&lpm, prefixes, num_prefixes, num);
+		printf("checked %d lookups: %d errors\n", num, errors);
+
+		start = now();
+		for (unsigned long i = 0; i < num_prefixes; i += 2) {
+			lpm_del(&lpm, prefixes + i * addr_len, lens[i]);
+		}
+		printf("removed half of the prefixes in %.3f s, %u prefixes "
+		       "left\n", now() - start, lpm.num_rules);
+		errors = check(&lpm, prefixes, num_prefixes, num);
+		printf("checked %d lookups: %d errors\n", num, errors);
+
+		/* table must be empty after removing all prefixes */
+		for (unsigned long i = 1; i < num_prefixes; i += 2) {
+			lpm_del(&lpm, prefixes + i * addr_len, lens[i]);
+		}
+		__u32 nh;
+		int left = 0;
+		for (__u32 i = 0; i < 1U << lpm.first_bits; i++) {
+			left += lpm.first[i] != 0;
+		}
+		printf("removed all prefixes: %d first level entries left, "
+		       "lookup %s\n", left,
+		       lpm_lookup(&lpm, prefixes, &nh) ? "fails" : "matches");
+		return errors || left ? -1 : 0;
+	}
+
+	/* look up random addresses, ipv6 addresses in random allocations; the
+	 * addresses are generated in the loop, a table of random addresses
+	 * would add cache misses of its own
+	 */
+	__u32 sum = 0, found = 0;
+	start = now();
+	for (unsigned long i = 0; i < num_lookups; i++) {
+		unsigned char addr[16];
+		__u64 r = next_rand();
+		memcpy(addr, &r, 8);
+		if (addr_len == 16) {
+			memcpy(addr + 8, &r, 8);
+			rand_alloc(addr, allocs, num_allocs);
+		}
+		__u32 nh;
+		if (!lpm_lookup(&lpm, addr, &nh)) {
+			sum += nh;
+			found++;
+		}
+	}
+	double lookup = now() - start;
+	printf("%lu lookups in %.3f s: %.1f M lookups/s, %u matched (%u)\n",
+	       num_lookups, lookup, num_lookups / lookup / 1e6, found, sum);
+
+	lpm_free(&lpm);
+	free(allocs);
+	free(prefixes);
+	free(lens);
+	return 0;
+}
@@ -0,0 +1,416 @@
+/* longest prefix match table, see lpm.h */
+
+#include "lpm.h"
+
+/* AF_INET */
+#include <sys/socket.h>
+
+/* memset(), memcpy(), memcmp() */
+#include <string.h>
+
+/* calloc(), realloc(), free() */
+#include <stdlib.h>
+
+/* EINVAL, ENOENT, ENOMEM, ENOSPC */
+#include <errno.h>
+
+/* id of the first level table */
+#define ROOT LPM_MAX_GROUPS
+
+/* no free group */
+#define NO_GROUP LPM_MAX_GROUPS
+
+/* initial size of the prefix hash table; it is kept at most half full */
+#define INITIAL_RULES_SIZE 64
+
+/* get table with id, the first level table or a group */
+static __u32 *get_table(struct lpm *lpm, __u32 id) {
+	return id == ROOT ? lpm->first : lpm->groups + (id << 8);
+}
+
+/* copy prefix of len bits to dst and zero its host bits */
+static void mask_prefix(struct lpm *lpm, unsigned char *dst,
+			const void *prefix, int len) {
+	memset(dst, 0, 16);
+	memcpy(dst, prefix, lpm->addr_len);
+	for (int i = 0; i < lpm->addr_len; i++) {
+		if (len >= 8) {
+			len -= 8;
+			continue;
+		}
+		dst[i] &= 0xff << (8 - len);
+		len = 0;
+	}
+}
+
+/* get stride bits of prefix starting at bit off; both are multiples of 8 */
+static __u32 get_bits(const unsigned char *prefix, int off, int stride) {
+	__u32 bits = 0;
+
+	for (int i = off / 8; i < (off + stride) / 8; i++) {
+		bits = bits << 8 | prefix[i];
+	}
+
+	return bits;
+}
+
+/* hash of prefix of len bits, fnv-1a */
+static __u32 hash_rule(struct lpm *lpm, const unsigned char *prefix,
+		       int len) {
+	__u32 hash = 2166136261U;
+
+	hash = (hash ^ (__u32) len) * 16777619U;
+	for (int i = 0; i < lpm->addr_len; i++) {
+		hash = (hash ^ prefix[i]) * 16777619U;
+	}
+
+	return hash;
+}
+
+/* find slot of masked prefix in prefix hash table, or the empty slot it
+ * belongs in
+ */
+static __u32 find_rule(struct lpm *lpm, const unsigned char *prefix,
+		       int len) {
+	__u32 slot = hash_rule(lpm, prefix, len) & lpm->rules_mask;
+
+	while (lpm->rules[slot].len != -1 &&
+	       (lpm->rules[slot].len != len ||
+		memcmp(lpm->rules[slot].prefix, prefix, lpm->addr_len))) {
+		slot = (slot + 1) & lpm->rules_mask;
+	}
+
+	return slot;
+}
+
+/* resize prefix hash table to size slots */
+static int resize_rules(struct lpm *lpm, __u32 size) {
+	struct lpm_rule *rules = malloc(size * sizeof(*rules));
+	if (!rules) {
+		return -ENOMEM;
+	}
+	for (__u32 i = 0; i < size; i++) {
+		rules[i].len = -1;
+	}
+
+	/* rehash all prefixes */
+	struct lpm_rule *old = lpm->rules;
+	__u32 old_size = old ? lpm->rules_mask + 1 : 0;
+	lpm->rules = rules;
+	lpm->rules_mask = size - 1;
+	for (__u32 i = 0; i < old_size; i++) {
+		if (old[i].len == -1) {
+			continue;
+		}
+		rules[find_rule(lpm, old[i].prefix, old[i].len)] = old[i];
+	}
+	free(old);
+
+	return 0;
+}
+
+/* remove slot from prefix hash table; following prefixes are shifted back
+ * instead of leaving tombstones, so lookups stay short
+ */
+static void remove_rule(struct lpm *lpm, __u32 slot) {
+	struct lpm_rule *rules = lpm->rules;
+	__u32 mask = lpm->rules_mask;
+	__u32 next = slot;
+
+	rules[slot].len = -1;
+	lpm->num_rules--;
+	while (1) {
+		next = (next + 1) & mask;
+		if (rules[next].len == -1) {
+			return;
+		}
+
+		/* move prefix back if its home slot is not between the empty
+		 * slot and its current slot
+		 */
+		__u32 home = hash_rule(lpm, rules[next].prefix,
+				       rules[next].len) & mask;
+		if (((next - home) & mask) < ((next - slot) & mask)) {
+			continue;
+		}
+		rules[slot] = rules[next];
+		rules[next].len = -1;
+		slot = next;
+	}
+}
+
+/* allocate group and store its id in id */
+static int alloc_group(struct lpm *lpm, __u32 *id) {
+	/* reuse free group */
+	if (lpm->free_group != NO_GROUP) {
+		*id = lpm->free_group;
+		lpm->free_group = lpm->groups[*id << 8];
+		return 0;
+	}
+
+	/* grow groups */
+	if (lpm->num_groups == lpm->size_groups) {
+		__u32 size = lpm->size_groups ? lpm->size_groups * 2 : 64;
+		if (size > LPM_MAX_GROUPS) {
+			return -ENOSPC;
+		}
+		__u32 *groups = realloc(lpm->groups,
+					(size_t) size * 256 * sizeof(__u32));
+		if (!groups) {
+			return -ENOMEM;
+		}
+		lpm->groups = groups;
+		lpm->size_groups = size;
+	}
+	*id = lpm->num_groups++;
+
+	return 0;
+}
+
+/* free group with id */
+static void free_group(struct lpm *lpm, __u32 id) {
+	lpm->groups[id << 8] = lpm->free_group;
+	lpm->free_group = id;
+}
+
+/* initialize empty table */
+int lpm_init(struct lpm *lpm, int family) {
+	memset(lpm, 0, sizeof(*lpm));
+	lpm->addr_len = family == AF_INET ? 4 : 16;
+	lpm->first_bits = family == AF_INET ? 24 : 16;
+	lpm->free_group = NO_GROUP;
+
+	/* the zeroed first level table is mapped lazily by the kernel */
+	lpm->first = calloc(1U << lpm->first_bits, sizeof(__u32));
+	if (!lpm->first) {
+		return -ENOMEM;
+	}
+
+	return resize_rules(lpm, INITIAL_RULES_SIZE);
+}
+
+/* free all memory of table */
+void lpm_free(struct lpm *lpm) {
+	free(lpm->first);
+	free(lpm->groups);
+	free(lpm->rules);
+	memset(lpm, 0, sizeof(*lpm));
+}
+
+/* set entry e and all entries in groups below it to entry, if they were not
+ * set by a longer prefix than len
+ */
+static void fill_entry(struct lpm *lpm, __u32 *e, int len, __u32 entry) {
+	if (*e & LPM_GROUP) {
+		__u32 *group = get_table(lpm, LPM_VALUE(*e));
+		for (int i = 0; i < 256; i++) {
+			fill_entry(lpm, &group[i], len, entry);
+		}
+		return;
+	}
+	if ((int) LPM_LEN(*e) <= len) {
+		*e = entry;
+	}
+}
+
+/* get first index and number of entries in table at bit offset off with
+ * stride bits covered by prefix of len bits
+ */
+static void get_range(const unsigned char *prefix, int len, int off,
+		      int stride, __u32 *first, __u32 *num) {
+	if (len <= off) {
+		*first = 0;
+		*num = 1U << stride;
+		return;
+	}
+	*first = get_bits(prefix, off, stride);
+	*num = 1U << (off + stride - len);
+}
+
+/* add prefix of len bits with table entry to table id at bit offset off
+ * with stride bits
+ */
+static int add_level(struct lpm *lpm, __u32 id, int off, int stride,
+		     const unsigned char *prefix, int len, __u32 entry) {
+	/* prefix ends in this table, fill all entries it covers */
+	if (len <= off + stride) {
+		__u32 *table = get_table(lpm, id);
+		__u32 first, num;
+		get_range(prefix, len, off, stride, &first, &num);
+		for (__u32 i = first; i < first + num; i++) {
+			fill_entry(lpm, &table[i], len, entry);
+		}
+		return 0;
+	}
+
+	/* prefix continues in a group of the next level, create the group
+	 * from the current entry if needed
+	 */
+	__u32 i = get_bits(prefix, off, stride);
+	__u32 e = get_table(lpm, id)[i];
+	if (!(e & LPM_GROUP)) {
+		__u32 group_id;
+		int rc = alloc_group(lpm, &group_id);
+		if (rc) {
+			return rc;
+		}
+		__u32 *group = get_table(lpm, group_id);
+		for (int j = 0; j < 256; j++) {
+			group[j] = e;
+		}
+		e = LPM_GROUP | group_id;
+		get_table(lpm, id)[i] = e;
+	}
+
+	return add_level(lpm, LPM_VALUE(e), off + stride, 8, prefix, len,
+			 entry);
+}
+
+/* replace group in entry e of a group at bit offset off by a single entry
+ * if all its entries are equal and were set by prefixes not longer than off
+ */
+static void collapse(struct lpm *lpm, __u32 *e, int off) {
+	__u32 *group = get_table(lpm, LPM_VALUE(*e));
+	__u32 first = group[0];
+
+	if ((first & LPM_GROUP) || (int) LPM_LEN(first) > off) {
+		return;
+	}
+	for (int i = 1; i < 256; i++) {
+		if (group[i] != first) {
+			return;
+		}
+	}
+	free_group(lpm, LPM_VALUE(*e));
+	*e = first;
+}
+
+/* replace entry e, that points to a group at bit offset off if it is a
+ * group entry, and all entries below it set by prefix of len bits with
+ * parent
+ */
+static void replace_entry(struct lpm *lpm, __u32 *e, int off, int len,
+			  __u32 parent) {
+	if (*e & LPM_GROUP) {
+		__u32 *group = get_table(lpm, LPM_VALUE(*e));
+		for (int i = 0; i < 256; i++) {
+			replace_entry(lpm, &group[i], off + 8, len, parent);
+		}
+		collapse(lpm, e, off);
+		return;
+	}
+	if ((*e & LPM_VALID) && (int) LPM_LEN(*e) == len) {
+		*e = parent;
+	}
+}
+
+/* remove prefix of len bits from table id at bit offset off with stride
+ * bits and replace its entries with the entry parent of the covering prefix
+ */
+static void del_level(struct lpm *lpm, __u32 id, int off, int stride,
+		      const unsigned char *prefix, int len, __u32 parent) {
+	__u32 *table = get_table(lpm, id);
+
+	/* prefix ends in this table, replace all entries it covers */
+	if (len <= off + stride) {
+		__u32 first, num;
+		get_range(prefix, len, off, stride, &first, &num);
+		for (__u32 i = first; i < first + num; i++) {
+			replace_entry(lpm, &table[i], off + stride, len,
+				      parent);
+		}
+		return;
+	}
+
+	/* prefix continues in a group of the next level */
+	__u32 i = get_bits(prefix, off, stride);
+	if (table[i] & LPM_GROUP) {
+		del_level(lpm, LPM_VALUE(table[i]), off + stride, 8, prefix,
+			  len, parent);
+		collapse(lpm, &table[i], off + stride);
+	}
+}
+
+/* add prefix or replace its next hop */
+int lpm_add(struct lpm *lpm, const void *prefix, int len, __u32 nh) {
+	unsigned char p[16];
+
+	if (len < 0 || len > lpm->addr_len * 8 || nh > LPM_MAX_NH) {
+		return -EINVAL;
+	}
+	mask_prefix(lpm, p, prefix, len);
+
+	/* add or update prefix in hash table, keep it at most half full */
+	__u32 slot = find_rule(lpm, p, len);
+	if (lpm->rules[slot].len != -1) {
+		if (lpm->rules[slot].nh == nh) {
+			return 0;
+		}
+	} else {
+		if (lpm->num_rules + 1 > (lpm->rules_mask + 1) / 2) {
+			int rc = resize_rules(lpm, (lpm->rules_mask + 1) * 2);
+			if (rc) {
+				return rc;
+			}
+			slot = find_rule(lpm, p, len);
+		}
+		memcpy(lpm->rules[slot].prefix, p, sizeof(p));
+		lpm->rules[slot].len = len;
+		lpm->num_rules++;
+	}
+	lpm->rules[slot].nh = nh;
+
+	/* update table entries */
+	__u32 entry = LPM_VALID | (__u32) len << LPM_LEN_SHIFT | nh;
+	return add_level(lpm, ROOT, 0, lpm->first_bits, p, len, entry);
+}
+
+/* remove prefix */
+int lpm_del(struct lpm *lpm, const void *prefix, int len) {
+	unsigned char p[16];
+
+	if (len < 0 || len > lpm->addr_len * 8) {
+		return -EINVAL;
+	}
+	mask_prefix(lpm, p, prefix, len);
+	__u32 slot = find_rule(lpm, p, len);
+	if (lpm->rules[slot].len == -1) {
+		return -ENOENT;
+	}
+	remove_rule(lpm, slot);
+
+	/* find longest covering prefix, its entry replaces the removed ones */
+	__u32 parent = 0;
+	for (int l = len - 1; l >= 0; l--) {
+		unsigned char q[16];
+		mask_prefix(lpm, q, p, l);
+		slot = find_rule(lpm, q, l);
+		if (lpm->rules[slot].len != -1) {
+			parent = LPM_VALID | (__u32) l << LPM_LEN_SHIFT |
+				lpm->rules[slot].nh;
+			break;
+		}
+	}
+
+	/* update table entries */
+	del_level(lpm, ROOT, 0, lpm->first_bits, p, len, parent);
+
+	return 0;
+}
+
+/* get next hop of exact prefix */
+int lpm_get(struct lpm *lpm, const void *prefix, int len, __u32 *nh) {
+	unsigned char p[16];
+
+	if (len < 0 || len > lpm->addr_len * 8) {
+		return -EINVAL;
+	}
+	mask_prefix(lpm, p, prefix, len);
+	__u32 slot = find_rule(lpm, p, len);
+	if (lpm->rules[slot].len == -1) {
+		return -ENOENT;
+	}
+	*nh = lpm->rules[slot].nh;
+
+	return 0;
+}
@@ -0,0 +1,114 @@
+/* longest prefix match table for ipv4 or ipv6 addresses in the style of
+ * DIR-24-8: a directly indexed first level table covers the first 24 bits
+ * of ipv4 or the first 16 bits of ipv6 addresses, longer prefixes are
+ * stored in groups of 256 entries per following byte; a lookup is one
+ * memory access for ipv4 prefixes up to /24 and one more per byte beyond
+ *
+ * each table entry stores whether it is valid, whether it points to a group
+ * of the next level, the length of the prefix it was set by and the next
+ * hop or group index; the prefix lengths allow adding and removing prefixes
+ * without rebuilding the table; all prefixes are also kept in a hash table
+ * to find the covering prefix when a prefix is removed
+ *
+ * next hops are indices chosen by the user, e.g., into a next hop array, up
+ * to LPM_MAX_NH
+ *
+ * memory: the ipv4 first level takes 64 MB and the ipv6 first level 256 KB;
+ * each group takes 1 KB, and a prefix needs up to one group per byte beyond
+ * the first level that it does not share with other prefixes; a full ipv4
+ * bgp table (about 1M prefixes) needs about 10K groups (10 MB), but ipv6
+ * prefixes are spread over more bytes, so a full ipv6 bgp table (about 185K
+ * prefixes, mostly /32 to /48) needs about 190K groups (200 MB); the layout
+ * is therefore only practical for ipv4 and for small ipv6 tables, e.g., of
+ * hosts and edge routers; full ipv6 tables need a compressed layout, e.g.,
+ * a multibit trie with bitmaps like poptrie
+ */
+
+#ifndef LPM_H
+#define LPM_H
+
+/* __u32 */
+#include <asm/types.h>
+
+/* table entry: valid and group bits, prefix length and value */
+#define LPM_VALID (1U << 31)
+#define LPM_GROUP (1U << 30)
+#define LPM_LEN_SHIFT 22
+#define LPM_LEN(e) (((e) >> LPM_LEN_SHIFT) & 0xff)
+#define LPM_VALUE(e) ((e) & ((1U << LPM_LEN_SHIFT) - 1))
+
+/* maximum next hop and number of groups */
+#define LPM_MAX_NH ((1U << LPM_LEN_SHIFT) - 1)
+#define LPM_MAX_GROUPS (1U << LPM_LEN_SHIFT)
+
+/* prefix in the prefix hash table */
+struct lpm_rule {
+	unsigned char prefix[16];	/* prefix, host bits are zero */
+	int len;			/* prefix length, -1 if empty */
+	__u32 nh;			/* next hop */
+};
+
+/* longest prefix match table */
+struct lpm {
+	int addr_len;		/* length of addresses: 4 or 16 bytes */
+	int first_bits;		/* bits of the first level: 24 or 16 */
+	__u32 *first;		/* first level table */
+	__u32 *groups;		/* groups of 256 entries of lower levels */
+	__u32 size_groups;	/* number of groups memory is allocated for */
+	__u32 num_groups;	/* number of groups ever used */
+	__u32 free_group;	/* first free group, chained by their first
+				 * entry, LPM_MAX_GROUPS if none
+				 */
+	struct lpm_rule *rules;	/* hash table of all prefixes */
+	__u32 rules_mask;	/* size of prefix hash table - 1 */
+	__u32 num_rules;	/* number of prefixes */
+};
+
+/* initialize empty table for addresses of family AF_INET or AF_INET6;
+ * return 0 or a negative error
+ */
+int lpm_init(struct lpm *lpm, int family);
+
+/* free all memory of table */
+void lpm_free(struct lpm *lpm);
+
+/* add prefix of len bits with next hop nh or replace the next hop of an
+ * existing prefix; host bits of prefix are ignored; return 0 or a negative
+ * error
+ */
+int lpm_add(struct lpm *lpm, const void *prefix, int len, __u32 nh);
+
+/* remove prefix of len bits; return 0 or -ENOENT if it does not exist */
+int lpm_del(struct lpm *lpm, const void *prefix, int len);
+
+/* get next hop of exact prefix of len bits in nh; return 0 or -ENOENT */
+int lpm_get(struct lpm *lpm, const void *prefix, int len, __u32 *nh);
+
+/* look up longest prefix matching address addr and store its next hop in
+ * nh; return 0 or -1 if no prefix matches
+ */
+static inline int lpm_lookup(const struct lpm *lpm, const void *addr,
+			     __u32 *nh) {
+	const unsigned char *a = addr;
+	__u32 e;
+	int i;
+
+	if (lpm->addr_len == 4) {
+		e = lpm->first[a[0] << 16 | a[1] << 8 | a[2]];
+		i = 3;
+	} else {
+		e = lpm->first[a[0] << 8 | a[1]];
+		i = 2;
+	}
+	while (e & LPM_GROUP) {
+		e = lpm->groups[LPM_VALUE(e) << 8 | a[i++]];
+	}
+	if (!(e & LPM_VALID)) {
+		return -1;
+	}
+	*nh = LPM_VALUE(e);
+
+	return 0;
+}
+
+#endif
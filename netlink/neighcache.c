@@ -0,0 +1,199 @@
+/* in-memory neighbor cache, see neighcache.h */
+
+#include "neighcache.h"
+
+/* memset(), memcpy(), memcmp() */
+#include <string.h>
+
+/* EMSGSIZE */
+#include <errno.h>
+
+/* length of addresses of family */
+static int addr_len(int family) {
+	return family == AF_INET ? 4 : 16;
+}
+
+/* hash of interface, family and address of neighbor, fnv-1a */
+static __u32 hash_neigh(const void *entry) {
+	const struct neigh_info *info = entry;
+	__u32 hash = 2166136261U;
+
+	hash = (hash ^ (__u32) info->ifindex) * 16777619U;
+	hash = (hash ^ (__u32) info->family) * 16777619U;
+	for (int i = 0; i < addr_len(info->family); i++) {
+		hash = (hash ^ info->addr[i]) * 16777619U;
+	}
+
+	return hash;
+}
+
+/* check if neighbors have the same key */
+static int equal_neigh(const void *a, const void *b) {
+	const struct neigh_info *x = a, *y = b;
+
+	return x->ifindex == y->ifindex && x->family == y->family &&
+		!memcmp(x->addr, y->addr, addr_len(x->family));
+}
+
+/* neighbors are found by interface, family and address */
+static const struct cache_key keys[] = {
+	{ hash_neigh, equal_neigh, 0 },
+};
+
+/* initialize empty neighbor cache */
+int neighcache_init(struct neighcache *cache, neighcache_cb cb, void *arg) {
+	cache->cb = cb;
+	cache->arg = arg;
+
+	return cache_init(&cache->cache, sizeof(struct neigh_info), keys,
+			  sizeof(keys) / sizeof(keys[0]));
+}
+
+/* free all memory of neighbor cache */
+void neighcache_free(struct neighcache *cache) {
+	cache_free(&cache->cache);
+}
+
+/* remove neighbor at position i */
+static void remove_neigh(struct cache *c, int i, void *arg) {
+	struct neighcache *cache = arg;
+
+	if (cache->cb) {
+		cache->cb(NEIGHCACHE_DEL, cache_entry(c, i), NULL, cache->arg);
+	}
+	cache_remove(c, i);
+}
+
+/* check if state of neighbors a and b differs */
+static int state_changed(struct neigh_info *a, struct neigh_info *b) {
+	return a->state != b->state || a->flags != b->flags ||
+		a->lladdr_len != b->lladdr_len ||
+		memcmp(a->lladdr, b->lladdr, a->lladdr_len);
+}
+
+/* add or update neighbor with state info */
+static int update_neigh(struct neighcache *cache, struct neigh_info *info) {
+	struct cache *c = &cache->cache;
+
+	/* update existing neighbor */
+	int i = cache_find(c, 0, info);
+	if (i != CACHE_NONE) {
+		struct neigh_info old = *(struct neigh_info *) cache_entry(c, i);
+		cache_update(c, i, info);
+		if (cache->cb && state_changed(&old, info)) {
+			cache->cb(NEIGHCACHE_CHANGE, &old, info, cache->arg);
+		}
+		return 0;
+	}
+
+	/* add new neighbor */
+	int rc = cache_add(c, info);
+	if (rc < 0) {
+		return rc;
+	}
+	if (cache->cb) {
+		cache->cb(NEIGHCACHE_NEW, NULL, info, cache->arg);
+	}
+
+	return 0;
+}
+
+/* parse neighbor message nh into info; return 0 or -1 if it is invalid */
+static int parse_neigh(struct nlmsghdr *nh, struct neigh_info *info) {
+	struct ndmsg *ndm = NLMSG_DATA(nh);
+
+	if (nh->nlmsg_len < NLMSG_LENGTH(sizeof(*ndm)) ||
+	    (ndm->ndm_family != AF_INET && ndm->ndm_family != AF_INET6)) {
+		return -1;
+	}
+
+	memset(info, 0, sizeof(*info));
+	info->ifindex = ndm->ndm_ifindex;
+	info->family = ndm->ndm_family;
+	info->state = ndm->ndm_state;
+	info->flags = ndm->ndm_flags;
+
+	struct rtattr *tb[NDA_MAX + 1];
+	rtnl_parse_attrs(tb, NDA_MAX, RTNL_ATTRS(nh, sizeof(*ndm)),
+			 RTNL_ATTRS_LEN(nh, sizeof(*ndm)));
+	int len = addr_len(info->family);
+	if (!tb[NDA_DST] || RTA_PAYLOAD(tb[NDA_DST]) < (size_t) len) {
+		return -1;
+	}
+	memcpy(info->addr, RTA_DATA(tb[NDA_DST]), len);
+
+	/* unresolved neighbors have no link layer address */
+	if (tb[NDA_LLADDR] &&
+	    RTA_PAYLOAD(tb[NDA_LLADDR]) <= sizeof(info->lladdr)) {
+		info->lladdr_len = RTA_PAYLOAD(tb[NDA_LLADDR]);
+		memcpy(info->lladdr, RTA_DATA(tb[NDA_LLADDR]),
+		       info->lladdr_len);
+	}
+
+	return 0;
+}
+
+/* apply neighbor message to cache */
+int neighcache_handle(struct nlmsghdr *nh, void *arg) {
+	struct neighcache *cache = arg;
+	struct neigh_info info;
+
+	if (nh->nlmsg_type != RTM_NEWNEIGH &&
+	    nh->nlmsg_type != RTM_DELNEIGH) {
+		return 0;
+	}
+	if (parse_neigh(nh, &info)) {
+		return 0;
+	}
+
+	if (nh->nlmsg_type == RTM_DELNEIGH) {
+		int i = cache_find(&cache->cache, 0, &info);
+		if (i != CACHE_NONE) {
+			remove_neigh(&cache->cache, i, cache);
+		}
+		return 0;
+	}
+
+	return update_neigh(cache, &info);
+}
+
+/* apply queued events, dump all neighbors and synchronize cache with them */
+int neighcache_sync(struct neighcache *cache, struct rtnl *rtnl) {
+	char buf[512];
+	struct rtnl_msg msg;
+	rtnl_msg_init(&msg, buf, sizeof(buf));
+	struct ndmsg *ndm = rtnl_msg_add(&msg, RTM_GETNEIGH, NLM_F_DUMP,
+					 sizeof(*ndm));
+	if (!ndm) {
+		return -EMSGSIZE;
+	}
+	ndm->ndm_family = AF_UNSPEC;
+
+	return cache_sync(&cache->cache, rtnl, &msg, neighcache_handle, cache,
+			  remove_neigh);
+}
+
+/* get neighbor by key */
+const struct neigh_info *neighcache_get(struct neighcache *cache, int ifindex,
+					int family, const void *addr) {
+	struct neigh_info key = { .ifindex = ifindex, .family = family };
+	memcpy(key.addr, addr, addr_len(family));
+	int i = cache_find(&cache->cache, 0, &key);
+
+	return i != CACHE_NONE ? cache_entry(&cache->cache, i) : NULL;
+}
+
+/* get link layer address of neighbor */
+int neighcache_get_lladdr(struct neighcache *cache, int ifindex, int family,
+			  const void *addr, void *lladdr, int size) {
+	const struct neigh_info *info = neighcache_get(cache, ifindex, family,
+						       addr);
+
+	if (!info || !(info->state & NEIGHCACHE_NUD_VALID) ||
+	    !info->lladdr_len || info->lladdr_len > size) {
+		return -1;
+	}
+	memcpy(lladdr, info->lladdr, info->lladdr_len);
+
+	return info->lladdr_len;
+}
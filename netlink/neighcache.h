@@ -0,0 +1,105 @@
+/* in-memory cache of all ipv4 (arp) and ipv6 (ndp) neighbors of a network
+ * namespace, populated by a dump and kept current from RTM_NEWNEIGH and
+ * RTM_DELNEIGH events; neighbors are stored in a dense array and found by
+ * interface, family and address with an open addressing hash table, so
+ * link layer addresses can be looked up without any syscalls
+ *
+ * build a tool together with the cache, the generic cache and the rtnetlink
+ * library, e.g.:
+ *
+ *   gcc if-neighs.c neighcache.c cache.c rtnl.c -o if-neighs
+ */
+
+#ifndef NEIGHCACHE_H
+#define NEIGHCACHE_H
+
+/* generic cache and rtnetlink library */
+#include "cache.h"
+
+/* NUD_* */
+#include <linux/neighbour.h>
+
+/* maximum length of link layer addresses */
+#define NEIGHCACHE_LLADDR_SIZE 32
+
+/* neighbor states with a usable link layer address, like NUD_VALID of the
+ * kernel
+ */
+#define NEIGHCACHE_NUD_VALID (NUD_PERMANENT | NUD_NOARP | NUD_REACHABLE | \
+			      NUD_PROBE | NUD_STALE | NUD_DELAY)
+
+/* cached state of a neighbor */
+struct neigh_info {
+	/* key */
+	int ifindex;				/* interface index */
+	__u8 family;				/* AF_INET or AF_INET6 */
+	unsigned char addr[16];			/* ip address */
+
+	/* state */
+	__u16 state;				/* NUD_* state */
+	__u8 flags;				/* NTF_* flags */
+	__u8 lladdr_len;			/* length of lladdr, 0 if
+						 * unresolved
+						 */
+	unsigned char lladdr[NEIGHCACHE_LLADDR_SIZE];	/* link layer
+							 * address
+							 */
+};
+
+/* change of a neighbor passed to the change callback */
+enum neighcache_change {
+	NEIGHCACHE_NEW,		/* neighbor was added */
+	NEIGHCACHE_CHANGE,	/* state, flags or link layer address changed */
+	NEIGHCACHE_DEL,		/* neighbor was removed */
+};
+
+/* change callback; old is the previous state (NULL for new neighbors), neigh
+ * the current state (NULL for removed neighbors); both are only valid during
+ * the call
+ */
+typedef void (*neighcache_cb)(enum neighcache_change change,
+			      const struct neigh_info *old,
+			      const struct neigh_info *neigh, void *arg);
+
+/* neighbor cache */
+struct neighcache {
+	struct cache cache;	/* neighbors by interface, family and address */
+	neighcache_cb cb;	/* change callback or NULL */
+	void *arg;		/* argument of change callback */
+};
+
+/* initialize empty neighbor cache with change callback cb (NULL for none)
+ * and its argument arg; return 0 or a negative error
+ */
+int neighcache_init(struct neighcache *cache, neighcache_cb cb, void *arg);
+
+/* free all memory of neighbor cache */
+void neighcache_free(struct neighcache *cache);
+
+/* apply RTM_NEWNEIGH or RTM_DELNEIGH message nh to cache and call the change
+ * callback if the cached state changed; other messages and other families,
+ * e.g., bridge fdb entries, are ignored, so this can be used as, or called
+ * from, an rtnl_cb; return 0 or a negative error
+ */
+int neighcache_handle(struct nlmsghdr *nh, void *cache);
+
+/* apply queued events, dump all neighbors and synchronize the cache with
+ * them; neighbors missing in the dump are removed, so this also
+ * resynchronizes a cache that missed events; return 0 or a negative error
+ */
+int neighcache_sync(struct neighcache *cache, struct rtnl *rtnl);
+
+/* get neighbor of interface ifindex with family and address addr, NULL if
+ * not found
+ */
+const struct neigh_info *neighcache_get(struct neighcache *cache, int ifindex,
+					int family, const void *addr);
+
+/* copy link layer address of neighbor of interface ifindex with family and
+ * address addr to lladdr of size bytes if it is in a NEIGHCACHE_NUD_VALID
+ * state; return its length or -1 if there is no usable link layer address
+ */
+int neighcache_get_lladdr(struct neighcache *cache, int ifindex, int family,
+			  const void *addr, void *lladdr, int size);
+
+#endif
@@ -0,0 +1,510 @@
+/* in-memory route cache, see routecache.h */
+
+#include "routecache.h"
+
+/* memset(), memcpy(), memcmp() */
+#include <string.h>
+
+/* EMSGSIZE, ENOSPC */
+#include <errno.h>
+
+/* IFF_UP */
+#include <net/if.h>
+
+/* keys of routes */
+enum {
+	BY_ROUTE,
+	BY_PREFIX,
+};
+
+/* length of addresses of family */
+static int addr_len(int family) {
+	return family == AF_INET ? 4 : 16;
+}
+
+/* hash of prefix of route, fnv-1a */
+static __u32 hash_prefix(const void *entry) {
+	const struct route_info *route = entry;
+	__u32 hash = 2166136261U;
+
+	hash = (hash ^ route->family) * 16777619U;
+	hash = (hash ^ route->dst_len) * 16777619U;
+	for (int i = 0; i < addr_len(route->family); i++) {
+		hash = (hash ^ route->dst[i]) * 16777619U;
+	}
+
+	return hash;
+}
+
+/* check if routes have the same prefix */
+static int equal_prefix(const void *a, const void *b) {
+	const struct route_info *x = a, *y = b;
+
+	return x->family == y->family && x->dst_len == y->dst_len &&
+		!memcmp(x->dst, y->dst, addr_len(x->family));
+}
+
+/* hash of prefix, metric and output interface of route, fnv-1a */
+static __u32 hash_route(const void *entry) {
+	const struct route_info *route = entry;
+	__u32 hash = hash_prefix(entry);
+
+	hash = (hash ^ route->priority) * 16777619U;
+	hash = (hash ^ (__u32) route->oif) * 16777619U;
+
+	return hash;
+}
+
+/* check if routes have the same key */
+static int equal_route(const void *a, const void *b) {
+	const struct route_info *x = a, *y = b;
+
+	return equal_prefix(a, b) && x->priority == y->priority &&
+		x->oif == y->oif;
+}
+
+/* routes are found by key and in groups by prefix */
+static const struct cache_key route_keys[] = {
+	[BY_ROUTE] = { hash_route, equal_route, 0 },
+	[BY_PREFIX] = { hash_prefix, equal_prefix, 1 },
+};
+
+/* hash of next hop, fnv-1a */
+static __u32 hash_nh(const void *entry) {
+	const struct route_nh *nh = entry;
+	__u32 hash = 2166136261U;
+
+	hash = (hash ^ (__u32) nh->oif) * 16777619U;
+	hash = (hash ^ nh->family) * 16777619U;
+	for (int i = 0; i < 16; i++) {
+		hash = (hash ^ nh->gw[i]) * 16777619U;
+	}
+
+	return hash;
+}
+
+/* check if next hops a and b are equal */
+static int equal_nh(const void *a, const void *b) {
+	const struct route_nh *x = a, *y = b;
+
+	return x->oif == y->oif && x->family == y->family &&
+		!memcmp(x->gw, y->gw, sizeof(x->gw));
+}
+
+/* next hops are interned by value */
+static const struct cache_key nh_keys[] = {
+	{ hash_nh, equal_nh, 0 },
+};
+
+/* get index of next hop in index, add it if it does not exist */
+static int get_nh(struct routecache *cache, const struct route_nh *nh,
+		  __u32 *index) {
+	int i = cache_find(&cache->nhs, 0, nh);
+	if (i == CACHE_NONE) {
+		if ((__u32) cache->nhs.num > LPM_MAX_NH) {
+			return -ENOSPC;
+		}
+		i = cache_add(&cache->nhs, nh);
+		if (i < 0) {
+			return i;
+		}
+	}
+	*index = i;
+
+	return 0;
+}
+
+/* initialize empty route cache */
+int routecache_init(struct routecache *cache, routecache_cb cb, void *arg) {
+	memset(cache, 0, sizeof(*cache));
+	cache->cb = cb;
+	cache->arg = arg;
+
+	int rc = lpm_init(&cache->lpm4, AF_INET);
+	if (rc) {
+		return rc;
+	}
+	rc = lpm_init(&cache->lpm6, AF_INET6);
+	if (rc) {
+		return rc;
+	}
+	rc = cache_init(&cache->routes, sizeof(struct route_info), route_keys,
+			sizeof(route_keys) / sizeof(route_keys[0]));
+	if (rc) {
+		return rc;
+	}
+
+	return cache_init(&cache->nhs, sizeof(struct route_nh), nh_keys,
+			  sizeof(nh_keys) / sizeof(nh_keys[0]));
+}
+
+/* free all memory of route cache */
+void routecache_free(struct routecache *cache) {
+	lpm_free(&cache->lpm4);
+	lpm_free(&cache->lpm6);
+	cache_free(&cache->routes);
+	cache_free(&cache->nhs);
+	memset(cache, 0, sizeof(*cache));
+}
+
+/* get table of family */
+static struct lpm *get_lpm(struct routecache *cache, int family) {
+	return family == AF_INET ? &cache->lpm4 : &cache->lpm6;
+}
+
+/* parse gateway attribute gw of family into next hop */
+static void parse_gw(struct rtattr *gw, int family, struct route_nh *nh) {
+	if (gw && RTA_PAYLOAD(gw) >= (size_t) addr_len(family)) {
+		nh->family = family;
+		memcpy(nh->gw, RTA_DATA(gw), addr_len(family));
+	}
+}
+
+/* check if next hop rtnh is valid within len bytes of next hops */
+static int rtnh_ok(struct rtnexthop *rtnh, int len) {
+	return len >= (int) sizeof(*rtnh) && RTNH_OK(rtnh, len);
+}
+
+/* parse next hop rtnh of multipath route of family into route_nh */
+static void parse_nexthop(struct rtnexthop *rtnh, int family,
+			  struct route_nh *route_nh) {
+	struct rtattr *tb[RTA_MAX + 1];
+
+	memset(route_nh, 0, sizeof(*route_nh));
+	rtnl_parse_attrs(tb, RTA_MAX, RTNH_DATA(rtnh),
+			 rtnh->rtnh_len - RTNH_LENGTH(0));
+	route_nh->oif = rtnh->rtnh_ifindex;
+	parse_gw(tb[RTA_GATEWAY], family, route_nh);
+}
+
+/* parse route message nh into route and its next hop into route_nh; set
+ * multipath to the next hops of multipath routes, else to NULL; return 0 or
+ * -1 if the route is not cached
+ */
+static int parse_route(struct nlmsghdr *nh, struct route_info *route,
+		       struct route_nh *route_nh, struct rtattr **multipath) {
+	struct rtmsg *rtm = NLMSG_DATA(nh);
+
+	if (nh->nlmsg_len < NLMSG_LENGTH(sizeof(*rtm)) ||
+	    (rtm->rtm_family != AF_INET && rtm->rtm_family != AF_INET6) ||
+	    rtm->rtm_type != RTN_UNICAST || rtm->rtm_flags & RTM_F_CLONED) {
+		return -1;
+	}
+
+	struct rtattr *tb[RTA_MAX + 1];
+	rtnl_parse_attrs(tb, RTA_MAX, RTNL_ATTRS(nh, sizeof(*rtm)),
+			 RTNL_ATTRS_LEN(nh, sizeof(*rtm)));
+
+	/* only routes of the main table; the table attribute replaces the 8
+	 * bit table of the header
+	 */
+	__u32 table = rtm->rtm_table;
+	if (tb[RTA_TABLE]) {
+		table = *(__u32 *) RTA_DATA(tb[RTA_TABLE]);
+	}
+	if (table != RT_TABLE_MAIN) {
+		return -1;
+	}
+
+	memset(route, 0, sizeof(*route));
+	memset(route_nh, 0, sizeof(*route_nh));
+	route->family = rtm->rtm_family;
+	route->dst_len = rtm->rtm_dst_len;
+	if (tb[RTA_PRIORITY]) {
+		route->priority = *(__u32 *) RTA_DATA(tb[RTA_PRIORITY]);
+	}
+	int len = addr_len(route->family);
+	if (route->dst_len > len * 8) {
+		return -1;
+	}
+
+	/* default routes have no destination */
+	if (tb[RTA_DST]) {
+		if (RTA_PAYLOAD(tb[RTA_DST]) < (size_t) len) {
+			return -1;
+		}
+		memcpy(route->dst, RTA_DATA(tb[RTA_DST]), len);
+	}
+
+	/* next hops of multipath routes are parsed by the caller */
+	*multipath = tb[RTA_MULTIPATH];
+	if (*multipath) {
+		route->multipath = 1;
+		return 0;
+	}
+
+	/* next hop */
+	if (tb[RTA_OIF]) {
+		route_nh->oif = *(__u32 *) RTA_DATA(tb[RTA_OIF]);
+	}
+	parse_gw(tb[RTA_GATEWAY], route->family, route_nh);
+	if (tb[RTA_VIA] && RTA_PAYLOAD(tb[RTA_VIA]) >= sizeof(struct rtvia)) {
+		struct rtvia *via = RTA_DATA(tb[RTA_VIA]);
+		int via_len = RTA_PAYLOAD(tb[RTA_VIA]) - sizeof(*via);
+		if ((via->rtvia_family == AF_INET ||
+		     via->rtvia_family == AF_INET6) &&
+		    via_len >= addr_len(via->rtvia_family)) {
+			route_nh->family = via->rtvia_family;
+			memcpy(route_nh->gw, via->rtvia_addr,
+			       addr_len(via->rtvia_family));
+		}
+	}
+	route->oif = route_nh->oif;
+
+	return 0;
+}
+
+/* set the next hop of the prefix of route in the table to the next hop of
+ * the preferred route to the prefix: the one with the lowest metric, and of
+ * these the one with the lowest output interface index; remove the prefix
+ * if there is no route to it
+ */
+static int update_prefix(struct routecache *cache,
+			 const struct route_info *route) {
+	struct lpm *lpm = get_lpm(cache, route->family);
+	struct cache *c = &cache->routes;
+	const struct route_info *best = NULL;
+
+	for (int i = cache_find(c, BY_PREFIX, route); i != CACHE_NONE;
+	     i = cache_next(c, BY_PREFIX, i)) {
+		const struct route_info *r = cache_entry(c, i);
+		if (!best || r->priority < best->priority ||
+		    (r->priority == best->priority && r->oif < best->oif)) {
+			best = r;
+		}
+	}
+	if (!best) {
+		lpm_del(lpm, route->dst, route->dst_len);
+		return 0;
+	}
+
+	__u32 nh;
+	if (!lpm_get(lpm, route->dst, route->dst_len, &nh) && nh == best->nh) {
+		return 0;
+	}
+	return lpm_add(lpm, route->dst, route->dst_len, best->nh);
+}
+
+/* remove route at position i and update the table */
+static void remove_route(struct cache *c, int i, void *arg) {
+	struct routecache *cache = arg;
+	struct route_info route = *(struct route_info *) cache_entry(c, i);
+
+	cache_remove(c, i);
+	update_prefix(cache, &route);
+	if (cache->cb) {
+		cache->cb(ROUTECACHE_DEL, &route, NULL, cache->arg);
+	}
+}
+
+/* add or update route, set its next hop index from route_nh */
+static int update_route(struct routecache *cache, struct route_info *route,
+			const struct route_nh *route_nh) {
+	struct cache *c = &cache->routes;
+
+	int rc = get_nh(cache, route_nh, &route->nh);
+	if (rc) {
+		return rc;
+	}
+
+	/* update existing route */
+	int i = cache_find(c, BY_ROUTE, route);
+	if (i != CACHE_NONE) {
+		struct route_info old = *(struct route_info *) cache_entry(c, i);
+		cache_update(c, i, route);
+		if (old.nh == route->nh) {
+			return 0;
+		}
+		rc = update_prefix(cache, route);
+		if (cache->cb) {
+			cache->cb(ROUTECACHE_CHANGE, &old, route, cache->arg);
+		}
+		return rc;
+	}
+
+	/* add new route */
+	i = cache_add(c, route);
+	if (i < 0) {
+		return i;
+	}
+	rc = update_prefix(cache, route);
+	if (cache->cb) {
+		cache->cb(ROUTECACHE_NEW, NULL, route, cache->arg);
+	}
+
+	return rc;
+}
+
+/* check if route message with route and the next hops in multipath, if
+ * not NULL, has a next hop via interface oif
+ */
+static int has_oif(const struct route_info *route, struct rtattr *multipath,
+		   int oif) {
+	if (!multipath) {
+		return route->oif == oif;
+	}
+
+	struct rtnexthop *rtnh = RTA_DATA(multipath);
+	int len = RTA_PAYLOAD(multipath);
+	while (rtnh_ok(rtnh, len)) {
+		if (rtnh->rtnh_ifindex == oif) {
+			return 1;
+		}
+		len -= RTNH_ALIGN(rtnh->rtnh_len);
+		rtnh = RTNH_NEXT(rtnh);
+	}
+
+	return 0;
+}
+
+/* remove routes with the prefix and metric of route that are replaced by the
+ * route message, i.e., the ones via interfaces without a next hop in it;
+ * removing a route reorders the group, so start over after each removal
+ */
+static void remove_replaced(struct routecache *cache,
+			    const struct route_info *route,
+			    struct rtattr *multipath) {
+	struct cache *c = &cache->routes;
+
+	int i = cache_find(c, BY_PREFIX, route);
+	while (i != CACHE_NONE) {
+		const struct route_info *r = cache_entry(c, i);
+		if (r->priority != route->priority ||
+		    has_oif(route, multipath, r->oif)) {
+			i = cache_next(c, BY_PREFIX, i);
+			continue;
+		}
+		remove_route(c, i, cache);
+		i = cache_find(c, BY_PREFIX, route);
+	}
+}
+
+/* remove all next hops of the multipath route with the prefix and metric of
+ * route
+ */
+static void remove_multipath(struct routecache *cache,
+			     const struct route_info *route) {
+	struct cache *c = &cache->routes;
+	struct route_info prefix = *route;
+
+	int i = cache_find(c, BY_PREFIX, &prefix);
+	while (i != CACHE_NONE) {
+		const struct route_info *r = cache_entry(c, i);
+		if (r->priority != prefix.priority || !r->multipath) {
+			i = cache_next(c, BY_PREFIX, i);
+			continue;
+		}
+		remove_route(c, i, cache);
+		i = cache_find(c, BY_PREFIX, &prefix);
+	}
+}
+
+/* remove all routes via interface ifindex if it was removed or is down; the
+ * kernel removes ipv4 routes of the link without route events, but it keeps
+ * multipath routes of links that are down with the next hop marked dead, and
+ * removes an ipv4 multipath route completely with one of its links
+ */
+static void flush_link(struct routecache *cache, int ifindex, int removed) {
+	struct cache *c = &cache->routes;
+
+	for (int i = 0; i < c->num;) {
+		const struct route_info *route = cache_entry(c, i);
+		if (route->oif != ifindex || (route->multipath && !removed)) {
+			i++;
+			continue;
+		}
+		if (route->multipath && route->family == AF_INET) {
+			/* entries are moved to other positions, start over */
+			remove_multipath(cache, route);
+			i = 0;
+			continue;
+		}
+		remove_route(c, i, cache);
+	}
+}
+
+/* remove routes via link of link message nh if it was removed or is down */
+static void handle_link(struct routecache *cache, struct nlmsghdr *nh) {
+	struct ifinfomsg *ifi = NLMSG_DATA(nh);
+
+	if (nh->nlmsg_len < NLMSG_LENGTH(sizeof(*ifi)) ||
+	    (nh->nlmsg_type == RTM_NEWLINK && ifi->ifi_flags & IFF_UP)) {
+		return;
+	}
+	flush_link(cache, ifi->ifi_index, nh->nlmsg_type == RTM_DELLINK);
+}
+
+/* add, update or remove route with next hop route_nh */
+static int handle_route(struct routecache *cache, struct route_info *route,
+			const struct route_nh *route_nh, int del) {
+	route->oif = route_nh->oif;
+	if (!del) {
+		return update_route(cache, route, route_nh);
+	}
+
+	int i = cache_find(&cache->routes, BY_ROUTE, route);
+	if (i != CACHE_NONE) {
+		remove_route(&cache->routes, i, cache);
+	}
+
+	return 0;
+}
+
+/* apply route or link message to cache */
+int routecache_handle(struct nlmsghdr *nh, void *arg) {
+	struct routecache *cache = arg;
+	struct route_info route;
+	struct route_nh route_nh;
+
+	if (nh->nlmsg_type == RTM_NEWLINK || nh->nlmsg_type == RTM_DELLINK) {
+		handle_link(cache, nh);
+		return 0;
+	}
+	if (nh->nlmsg_type != RTM_NEWROUTE && nh->nlmsg_type != RTM_DELROUTE) {
+		return 0;
+	}
+	struct rtattr *multipath;
+	if (parse_route(nh, &route, &route_nh, &multipath)) {
+		return 0;
+	}
+	int del = nh->nlmsg_type == RTM_DELROUTE;
+	if (!del && nh->nlmsg_flags & NLM_F_REPLACE) {
+		remove_replaced(cache, &route, multipath);
+	}
+	if (!multipath) {
+		return handle_route(cache, &route, &route_nh, del);
+	}
+
+	/* each next hop of a multipath route is cached as a route via its
+	 * output interface
+	 */
+	struct rtnexthop *rtnh = RTA_DATA(multipath);
+	int len = RTA_PAYLOAD(multipath);
+	while (rtnh_ok(rtnh, len)) {
+		parse_nexthop(rtnh, route.family, &route_nh);
+		int rc = handle_route(cache, &route, &route_nh, del);
+		if (rc) {
+			return rc;
+		}
+		len -= RTNH_ALIGN(rtnh->rtnh_len);
+		rtnh = RTNH_NEXT(rtnh);
+	}
+
+	return 0;
+}
+
+/* apply queued events, dump all routes and synchronize cache with them */
+int routecache_sync(struct routecache *cache, struct rtnl *rtnl) {
+	char buf[512];
+	struct rtnl_msg msg;
+	rtnl_msg_init(&msg, buf, sizeof(buf));
+	struct rtmsg *rtm = rtnl_msg_add(&msg, RTM_GETROUTE, NLM_F_DUMP,
+					 sizeof(*rtm));
+	if (!rtm) {
+		return -EMSGSIZE;
+	}
+	rtm->rtm_family = AF_UNSPEC;
+
+	return cache_sync(&cache->routes, rtnl, &msg, routecache_handle, cache,
+			  remove_route);
+}
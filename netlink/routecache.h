@@ -0,0 +1,125 @@
+/* in-memory cache of the ipv4 and ipv6 unicast routes of the main routing
+ * table of a network namespace, populated by a dump and kept current from
+ * RTM_NEWROUTE and RTM_DELROUTE events; routes are stored in one longest
+ * prefix match table per family, so lookups of addresses do not need any
+ * syscalls; next hops (gateway and output interface) are stored once in a
+ * next hop array and routes refer to them by index
+ *
+ * all routes are cached by prefix, metric and output interface, so routes to
+ * the same prefix with different metrics or via different links are kept
+ * side by side; each next hop of a multipath route is cached as a route via
+ * its output interface; the longest prefix match tables contain the route
+ * with the lowest metric of each prefix, and of these the one with the
+ * lowest output interface index
+ *
+ * build a tool together with the cache, the generic cache, the table and the
+ * rtnetlink library, e.g.:
+ *
+ *   gcc if-routes.c routecache.c cache.c lpm.c rtnl.c -o if-routes
+ */
+
+#ifndef ROUTECACHE_H
+#define ROUTECACHE_H
+
+/* generic cache and rtnetlink library */
+#include "cache.h"
+
+/* longest prefix match table */
+#include "lpm.h"
+
+/* next hop of routes */
+struct route_nh {
+	__u8 family;			/* family of gateway, AF_UNSPEC if
+					 * there is no gateway
+					 */
+	unsigned char gw[16];		/* gateway address */
+	int oif;			/* output interface index */
+};
+
+/* cached route */
+struct route_info {
+	/* key */
+	__u8 family;			/* AF_INET or AF_INET6 */
+	__u8 dst_len;			/* prefix length */
+	unsigned char dst[16];		/* destination prefix */
+	__u32 priority;			/* metric, lower is preferred */
+	int oif;			/* output interface index of next hop */
+
+	/* state */
+	__u32 nh;			/* index of next hop */
+	__u8 multipath;			/* next hop of a multipath route */
+};
+
+/* change of a route passed to the change callback */
+enum routecache_change {
+	ROUTECACHE_NEW,		/* route was added */
+	ROUTECACHE_CHANGE,	/* next hop of route changed */
+	ROUTECACHE_DEL,		/* route was removed */
+};
+
+/* change callback; old is the previous route (NULL for new routes), route
+ * the current route (NULL for removed routes); both are only valid during
+ * the call
+ */
+typedef void (*routecache_cb)(enum routecache_change change,
+			      const struct route_info *old,
+			      const struct route_info *route, void *arg);
+
+/* route cache */
+struct routecache {
+	struct cache routes;		/* all routes by key and by prefix */
+	struct lpm lpm4;		/* preferred ipv4 route of prefixes */
+	struct lpm lpm6;		/* preferred ipv6 route of prefixes */
+	struct cache nhs;		/* next hops, they are never removed */
+	routecache_cb cb;		/* change callback or NULL */
+	void *arg;			/* argument of change callback */
+};
+
+/* initialize empty route cache with change callback cb (NULL for none) and
+ * its argument arg; return 0 or a negative error
+ */
+int routecache_init(struct routecache *cache, routecache_cb cb, void *arg);
+
+/* free all memory of route cache */
+void routecache_free(struct routecache *cache);
+
+/* apply RTM_NEWROUTE or RTM_DELROUTE message nh to cache and call the change
+ * callback if the cached routes changed; RTM_NEWROUTE messages with
+ * NLM_F_REPLACE replace the routes with the same prefix and metric;
+ * RTM_DELLINK messages, and
+ * RTM_NEWLINK messages of links that are down, remove all routes via the
+ * link, because the kernel removes ipv4 routes of links without route events,
+ * so RTMGRP_LINK should be joined as well; multipath routes are only removed
+ * with their links, and ipv4 multipath routes completely; other messages and
+ * routes that are not cached are ignored, so this can be used as, or called
+ * from, an rtnl_cb; return 0 or a negative error
+ */
+int routecache_handle(struct nlmsghdr *nh, void *cache);
+
+/* apply queued events, dump all routes and synchronize the cache with them;
+ * routes missing in the dump are removed, so this also resynchronizes a
+ * cache that missed events; return 0 or a negative error
+ */
+int routecache_sync(struct routecache *cache, struct rtnl *rtnl);
+
+/* get next hop with index nh */
+static inline const struct route_nh *routecache_nh(struct routecache *cache,
+						   __u32 nh) {
+	return cache_entry(&cache->nhs, nh);
+}
+
+/* look up the preferred route of address addr of family AF_INET or AF_INET6
+ * and return its next hop, NULL if there is no route
+ */
+static inline const struct route_nh *routecache_lookup(
+	struct routecache *cache, int family, const void *addr) {
+	struct lpm *lpm = family == AF_INET ? &cache->lpm4 : &cache->lpm6;
+	__u32 nh;
+
+	if (lpm_lookup(lpm, addr, &nh)) {
+		return NULL;
+	}
+	return cache_entry(&cache->nhs, nh);
+}
+
+#endif
@@ -0,0 +1,595 @@
+/* small rtnetlink library shared by the netlink tools, see rtnl.h */
+
+#include "rtnl.h"
+
+/* memset(), memcpy(), strlen(), strerror() */
+#include <string.h>
+
+/* malloc(), realloc(), free() */
+#include <stdlib.h>
+
+/* printf() */
+#include <stdio.h>
+
+/* close() */
+#include <unistd.h>
+
+/* errno */
+#include <errno.h>
+
+/* open rtnetlink socket joined to multicast groups with buffer sizes */
+int rtnl_open(struct rtnl *rtnl, __u32 groups, int rcvbuf, int sndbuf) {
+	int one = 1;
+
+	memset(rtnl, 0, sizeof(*rtnl));
+
+	/* create socket address */
+	struct sockaddr_nl sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.nl_family = AF_NETLINK;
+	sa.nl_groups = groups;
+
+	/* create socket */
+	rtnl->fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+	if (rtnl->fd < 0) {
+		return -errno;
+	}
+
+	/* set buffer sizes; the receive buffer is forced beyond rmem_max if
+	 * permitted, so event monitors can absorb event storms
+	 */
+	if (rcvbuf > 0 &&
+	    setsockopt(rtnl->fd, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf,
+		       sizeof(rcvbuf)) &&
+	    setsockopt(rtnl->fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf,
+		       sizeof(rcvbuf))) {
+		goto error;
+	}
+	if (sndbuf > 0 && setsockopt(rtnl->fd, SOL_SOCKET, SO_SNDBUF, &sndbuf,
+				     sizeof(sndbuf))) {
+		goto error;
+	}
+
+	/* bind socket and get port id assigned by the kernel */
+	socklen_t sa_len = sizeof(sa);
+	if (bind(rtnl->fd, (struct sockaddr *) &sa, sizeof(sa)) ||
+	    getsockname(rtnl->fd, (struct sockaddr *) &sa, &sa_len)) {
+		goto error;
+	}
+	rtnl->pid = sa.nl_pid;
+
+	/* get error messages in acks and do not echo requests in acks; older
+	 * kernels without these options are fine
+	 */
+	setsockopt(rtnl->fd, SOL_NETLINK, NETLINK_EXT_ACK, &one, sizeof(one));
+	setsockopt(rtnl->fd, SOL_NETLINK, NETLINK_CAP_ACK, &one, sizeof(one));
+
+	/* create receive buffer */
+	rtnl->buf = malloc(RTNL_RECV_BUF_MIN);
+	if (!rtnl->buf) {
+		errno = ENOMEM;
+		goto error;
+	}
+	rtnl->buf_size = RTNL_RECV_BUF_MIN;
+
+	return 0;
+
+error:
+	close(rtnl->fd);
+	rtnl->fd = -1;
+	return -errno;
+}
+
+/* enable strict checking of requests and kernel-side dump filtering */
+int rtnl_set_strict(struct rtnl *rtnl) {
+	int one = 1;
+
+	if (setsockopt(rtnl->fd, SOL_NETLINK, NETLINK_GET_STRICT_CHK, &one,
+		       sizeof(one))) {
+		return -errno;
+	}
+
+	return 0;
+}
+
+/* close rtnetlink socket */
+void rtnl_close(struct rtnl *rtnl) {
+	if (rtnl->fd >= 0) {
+		close(rtnl->fd);
+	}
+	rtnl->fd = -1;
+	free(rtnl->buf);
+	rtnl->buf = NULL;
+	rtnl->buf_size = 0;
+}
+
+/* initialize empty message batch in buf */
+void rtnl_msg_init(struct rtnl_msg *msg, void *buf, size_t size) {
+	memset(msg, 0, sizeof(*msg));
+	msg->buf = buf;
+	msg->size = size;
+}
+
+/* get free space at end of batch for len bytes, NULL if they do not fit */
+static void *msg_tail(struct rtnl_msg *msg, size_t len) {
+	if (msg->err || msg->len + len > msg->size) {
+		msg->err = -EMSGSIZE;
+		return NULL;
+	}
+	return msg->buf + msg->len;
+}
+
+/* grow batch and current message by len bytes */
+static void msg_grow(struct rtnl_msg *msg, size_t len) {
+	msg->len += len;
+	msg->hdr->nlmsg_len = msg->buf + msg->len - (char *) msg->hdr;
+}
+
+/* start new message in batch and return its family header */
+void *rtnl_msg_add(struct rtnl_msg *msg, __u16 type, __u16 flags,
+		   size_t hdr_len) {
+	size_t len = NLMSG_SPACE(hdr_len);
+	struct nlmsghdr *hdr = msg_tail(msg, len);
+	if (!hdr) {
+		return NULL;
+	}
+
+	/* fill header, sequence number is set when sending */
+	memset(hdr, 0, len);
+	hdr->nlmsg_type = type;
+	hdr->nlmsg_flags = NLM_F_REQUEST | flags;
+	/* NLM_F_EXCL of new requests shares its bit with NLM_F_MATCH of
+	 * dumps, so only both dump bits mark a dump
+	 */
+	if ((flags & NLM_F_DUMP) != NLM_F_DUMP) {
+		hdr->nlmsg_flags |= NLM_F_ACK;
+	}
+	msg->hdr = hdr;
+	msg->num++;
+	msg_grow(msg, len);
+
+	return NLMSG_DATA(hdr);
+}
+
+/* append len zeroed bytes to current message */
+void *rtnl_msg_reserve(struct rtnl_msg *msg, size_t len) {
+	void *data = msg->hdr ? msg_tail(msg, NLMSG_ALIGN(len)) : NULL;
+	if (!data) {
+		msg->err = -EMSGSIZE;
+		return NULL;
+	}
+	memset(data, 0, NLMSG_ALIGN(len));
+	msg_grow(msg, NLMSG_ALIGN(len));
+
+	return data;
+}
+
+/* append attribute to current message */
+struct rtattr *rtnl_attr_add(struct rtnl_msg *msg, __u16 type,
+			     const void *data, size_t len) {
+	struct rtattr *rta = rtnl_msg_reserve(msg, RTA_LENGTH(len));
+	if (!rta) {
+		return NULL;
+	}
+	rta->rta_type = type;
+	rta->rta_len = RTA_LENGTH(len);
+	if (len) {
+		memcpy(RTA_DATA(rta), data, len);
+	}
+
+	return rta;
+}
+
+/* append null-terminated string attribute to current message */
+struct rtattr *rtnl_attr_add_str(struct rtnl_msg *msg, __u16 type,
+				 const char *str) {
+	return rtnl_attr_add(msg, type, str, strlen(str) + 1);
+}
+
+/* append u32 attribute to current message */
+struct rtattr *rtnl_attr_add_u32(struct rtnl_msg *msg, __u16 type,
+				 __u32 value) {
+	return rtnl_attr_add(msg, type, &value, sizeof(value));
+}
+
+/* start nested attribute in current message */
+struct rtattr *rtnl_attr_nest(struct rtnl_msg *msg, __u16 type) {
+	return rtnl_attr_add(msg, type, NULL, 0);
+}
+
+/* end nested attribute, its length covers everything added since start */
+void rtnl_attr_nest_end(struct rtnl_msg *msg, struct rtattr *nest) {
+	if (!nest || msg->err) {
+		return;
+	}
+	nest->rta_len = msg->buf + msg->len - (char *) nest;
+}
+
+/* parse attributes into table indexed by attribute type */
+void rtnl_parse_attrs(struct rtattr **tb, int max, struct rtattr *rta,
+		      int len) {
+	memset(tb, 0, sizeof(struct rtattr *) * (max + 1));
+	for (; RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+		unsigned short type = rta->rta_type & NLA_TYPE_MASK;
+		if (type <= max && !tb[type]) {
+			tb[type] = rta;
+		}
+	}
+}
+
+/* assign sequence numbers to all messages in batch and send them at once */
+int rtnl_send(struct rtnl *rtnl, struct rtnl_msg *msg) {
+	if (msg->err) {
+		return msg->err;
+	}
+
+	/* forget extended ack message of earlier requests */
+	rtnl->err_msg[0] = 0;
+
+	/* assign sequence numbers */
+	msg->seq = rtnl->seq + 1;
+	int len = msg->len;
+	for (struct nlmsghdr *nh = (struct nlmsghdr *) msg->buf;
+	     NLMSG_OK(nh, len); nh = NLMSG_NEXT(nh, len)) {
+		nh->nlmsg_seq = ++rtnl->seq;
+	}
+
+	/* create socket address of the kernel */
+	struct sockaddr_nl sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.nl_family = AF_NETLINK;
+
+	/* send batch */
+	struct iovec iov = { msg->buf, msg->len };
+	struct msghdr mh = { &sa, sizeof(sa), &iov, 1, NULL, 0, 0 };
+	if (sendmsg(rtnl->fd, &mh, 0) < 0) {
+		return -errno;
+	}
+
+	return 0;
+}
+
+/* grow receive buffer to hold a datagram of len bytes */
+static int recv_buf_grow(struct rtnl *rtnl, size_t len) {
+	size_t size = rtnl->buf_size;
+	while (size < len) {
+		size *= 2;
+	}
+	if (size > RTNL_RECV_BUF_MAX) {
+		return -EMSGSIZE;
+	}
+
+	char *buf = realloc(rtnl->buf, size);
+	if (!buf) {
+		return -ENOMEM;
+	}
+	rtnl->buf = buf;
+	rtnl->buf_size = size;
+
+	return 0;
+}
+
+/* receive next datagram with flags and pass each of its messages to cb */
+static int recv_datagram(struct rtnl *rtnl, rtnl_cb cb, void *arg,
+			 int flags) {
+	struct iovec iov = { NULL, 0 };
+	struct sockaddr_nl sa;
+	struct msghdr mh = { &sa, sizeof(sa), &iov, 1, NULL, 0, 0 };
+
+	/* peek at size of next datagram without copying it and make sure it
+	 * fits into the receive buffer
+	 */
+	int len = recvmsg(rtnl->fd, &mh, MSG_PEEK | MSG_TRUNC | flags);
+	if (len < 0) {
+		return -errno;
+	}
+	if ((size_t) len > rtnl->buf_size) {
+		int rc = recv_buf_grow(rtnl, len);
+		if (rc) {
+			/* drop datagram, it can never be received */
+			recv(rtnl->fd, NULL, 0, MSG_TRUNC);
+			return rc;
+		}
+	}
+
+	/* receive datagram */
+	iov.iov_base = rtnl->buf;
+	iov.iov_len = rtnl->buf_size;
+	len = recvmsg(rtnl->fd, &mh, flags);
+	if (len < 0) {
+		return -errno;
+	}
+	if (len == 0) {
+		return -ENODATA;
+	}
+
+	/* ignore messages not sent by the kernel */
+	if (sa.nl_pid != 0) {
+		return 0;
+	}
+
+	/* process all messages in datagram */
+	for (struct nlmsghdr *nh = (struct nlmsghdr *) rtnl->buf;
+	     NLMSG_OK(nh, len); nh = NLMSG_NEXT(nh, len)) {
+		int rc = cb(nh, arg);
+		if (rc) {
+			return rc;
+		}
+	}
+
+	return 0;
+}
+
+/* receive next datagram and pass each of its messages to cb */
+int rtnl_recv(struct rtnl *rtnl, rtnl_cb cb, void *arg) {
+	return recv_datagram(rtnl, cb, arg, 0);
+}
+
+/* pass all queued messages to cb without blocking */
+int rtnl_drain(struct rtnl *rtnl, rtnl_cb cb, void *arg) {
+	while (1) {
+		int rc = recv_datagram(rtnl, cb, arg, MSG_DONTWAIT);
+		if (rc == -EAGAIN) {
+			return 0;
+		}
+		if (rc == -ENOBUFS) {
+			rtnl->overruns++;
+			continue;
+		}
+		if (rc) {
+			return rc;
+		}
+	}
+}
+
+/* store extended ack message in attributes of nh after hdr_len bytes */
+static void handle_ext_ack(struct rtnl *rtnl, struct nlmsghdr *nh,
+			   int hdr_len) {
+	rtnl->err_msg[0] = 0;
+	if (!(nh->nlmsg_flags & NLM_F_ACK_TLVS)) {
+		return;
+	}
+
+	struct rtattr *tb[NLMSGERR_ATTR_MAX + 1];
+	rtnl_parse_attrs(tb, NLMSGERR_ATTR_MAX, RTNL_ATTRS(nh, hdr_len),
+			 RTNL_ATTRS_LEN(nh, hdr_len));
+	if (tb[NLMSGERR_ATTR_MSG]) {
+		snprintf(rtnl->err_msg, sizeof(rtnl->err_msg), "%.*s",
+			 (int) RTA_PAYLOAD(tb[NLMSGERR_ATTR_MSG]),
+			 (char *) RTA_DATA(tb[NLMSGERR_ATTR_MSG]));
+	}
+}
+
+/* get error of error message nh and store its extended ack message, if any */
+static int handle_error(struct rtnl *rtnl, struct nlmsghdr *nh) {
+	struct nlmsgerr *err = NLMSG_DATA(nh);
+
+	if (!err->error) {
+		return 0;
+	}
+
+	/* extended ack attributes follow the echoed request, if any */
+	int hdr_len = sizeof(*err);
+	if (!(nh->nlmsg_flags & NLM_F_CAPPED)) {
+		hdr_len += err->msg.nlmsg_len - sizeof(struct nlmsghdr);
+	}
+	handle_ext_ack(rtnl, nh, hdr_len);
+
+	return err->error;
+}
+
+/* print error with extended ack message of the last error */
+void rtnl_perror(struct rtnl *rtnl, const char *s, int err) {
+	if (rtnl->err_msg[0]) {
+		printf("%s: %s: %s\n", s, strerror(-err), rtnl->err_msg);
+		return;
+	}
+	printf("%s: %s\n", s, strerror(-err));
+}
+
+/* state of waiting for acks of a batch */
+struct acks {
+	struct rtnl *rtnl;
+	struct rtnl_msg *msg;
+	int *errors;
+	int pending;
+	int failed;
+	int first;	/* error of the first failed message */
+};
+
+/* handle ack or error of a message in batch */
+static int handle_ack(struct nlmsghdr *nh, void *arg) {
+	struct acks *acks = arg;
+	__u32 index = nh->nlmsg_seq - acks->msg->seq;
+
+	if (nh->nlmsg_type != NLMSG_ERROR || index >= (__u32) acks->msg->num) {
+		return 0;
+	}
+	int err = handle_error(acks->rtnl, nh);
+	if (acks->errors) {
+		acks->errors[index] = err;
+	}
+	if (err && !acks->failed++) {
+		acks->first = err;
+	}
+	if (--acks->pending == 0) {
+		return 1;
+	}
+
+	return 0;
+}
+
+/* receive acks until none are pending */
+static int wait_acks(struct acks *acks) {
+	while (acks->pending > 0) {
+		int rc = rtnl_recv(acks->rtnl, handle_ack, acks);
+		if (rc < 0) {
+			return rc;
+		}
+	}
+
+	return 0;
+}
+
+/* wait for acks of all messages in sent batch */
+int rtnl_wait_acks(struct rtnl *rtnl, struct rtnl_msg *msg, int *errors) {
+	struct acks acks = { rtnl, msg, errors, msg->num, 0, 0 };
+
+	int rc = wait_acks(&acks);
+	if (rc < 0) {
+		return rc;
+	}
+
+	return acks.failed;
+}
+
+/* state of receiving acks of pipelined requests */
+struct ack_cb {
+	struct rtnl *rtnl;
+	rtnl_ack_cb cb;
+	void *arg;
+};
+
+/* pass ack or error of a message to callback */
+static int handle_ack_cb(struct nlmsghdr *nh, void *arg) {
+	struct ack_cb *ack = arg;
+
+	if (nh->nlmsg_type != NLMSG_ERROR ||
+	    nh->nlmsg_len < NLMSG_LENGTH(sizeof(struct nlmsgerr))) {
+		return 0;
+	}
+	int err = handle_error(ack->rtnl, nh);
+	return ack->cb(ack->rtnl, nh->nlmsg_seq, err, ack->arg);
+}
+
+/* receive next datagram and pass its acks to cb */
+int rtnl_recv_acks(struct rtnl *rtnl, rtnl_ack_cb cb, void *arg) {
+	struct ack_cb ack = { rtnl, cb, arg };
+
+	return rtnl_recv(rtnl, handle_ack_cb, &ack);
+}
+
+/* send batch and wait for its acks */
+int rtnl_request(struct rtnl *rtnl, struct rtnl_msg *msg) {
+	struct acks acks = { rtnl, msg, NULL, msg->num, 0, 0 };
+
+	/* nothing to send in an empty batch, but building it may have failed */
+	if (msg->num == 0) {
+		return msg->err;
+	}
+	int rc = rtnl_send(rtnl, msg);
+	if (rc) {
+		return rc;
+	}
+	rc = wait_acks(&acks);
+	if (rc < 0) {
+		return rc;
+	}
+
+	return acks.first;
+}
+
+/* state of a dump */
+struct dump {
+	struct rtnl *rtnl;
+	__u32 seq;
+	rtnl_cb cb;
+	void *arg;
+};
+
+/* handle message of a dump reply */
+static int handle_dump(struct nlmsghdr *nh, void *arg) {
+	struct dump *dump = arg;
+
+	if (nh->nlmsg_seq != dump->seq) {
+		/* pass multicast events received during the dump on */
+		return nh->nlmsg_seq == 0 ? dump->cb(nh, dump->arg) : 0;
+	}
+	if (nh->nlmsg_type == NLMSG_DONE) {
+		/* done message may carry an error of the dump, e.g., an
+		 * invalid dump request, followed by extended ack attributes
+		 */
+		int *err = NLMSG_DATA(nh);
+		if (nh->nlmsg_len >= NLMSG_LENGTH(sizeof(*err)) && *err < 0) {
+			handle_ext_ack(dump->rtnl, nh, sizeof(*err));
+			return *err;
+		}
+		if (nh->nlmsg_flags & NLM_F_DUMP_FILTERED) {
+			dump->rtnl->filtered = 1;
+		}
+		return 1;
+	}
+	if (nh->nlmsg_type == NLMSG_ERROR) {
+		int err = handle_error(dump->rtnl, nh);
+		return err ? err : 1;
+	}
+
+	return dump->cb(nh, dump->arg);
+}
+
+/* send dump request and pass reply messages to cb until dump is done */
+int rtnl_dump(struct rtnl *rtnl, struct rtnl_msg *msg, rtnl_cb cb,
+	      void *arg) {
+	int rc = rtnl_send(rtnl, msg);
+	if (rc) {
+		return rc;
+	}
+
+	struct dump dump = { rtnl, msg->seq, cb, arg };
+	rtnl->filtered = 0;
+	while (1) {
+		rc = rtnl_recv(rtnl, handle_dump, &dump);
+		if (rc == -ENOBUFS) {
+			/* only multicast events are lost, not the dump */
+			rtnl->overruns++;
+			continue;
+		}
+		if (rc) {
+			break;
+		}
+	}
+
+	return rc > 0 ? 0 : rc;
+}
+
+/* dump all links and pass the RTM_NEWLINK messages to cb */
+int rtnl_dump_links(struct rtnl *rtnl, rtnl_cb cb, void *arg) {
+	char buf[512];
+	struct rtnl_msg msg;
+	rtnl_msg_init(&msg, buf, sizeof(buf));
+	struct ifinfomsg *ifi = rtnl_msg_add(&msg, RTM_GETLINK, NLM_F_DUMP,
+					     sizeof(*ifi));
+	if (!ifi) {
+		return -EMSGSIZE;
+	}
+	ifi->ifi_family = AF_UNSPEC;
+
+	return rtnl_dump(rtnl, &msg, cb, arg);
+}
+
+/* receive messages and pass them to cb until cb or receiving stops; resync
+ * after overruns
+ */
+int rtnl_listen(struct rtnl *rtnl, rtnl_cb cb, rtnl_resync_cb resync,
+		void *arg) {
+	while (1) {
+		__u64 overruns = rtnl->overruns;
+		int rc = rtnl_recv(rtnl, cb, arg);
+		if (rc == -ENOBUFS) {
+			rtnl->overruns++;
+		} else if (rc) {
+			return rc > 0 ? 0 : rc;
+		}
+
+		/* resync until no events were lost during the resync, e.g.,
+		 * in the dump of the resync
+		 */
+		while (resync && overruns != rtnl->overruns) {
+			overruns = rtnl->overruns;
+			rc = resync(rtnl, arg);
+			if (rc) {
+				return rc > 0 ? 0 : rc;
+			}
+		}
+	}
+}
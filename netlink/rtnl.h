@@ -0,0 +1,218 @@
+/* small rtnetlink library shared by the netlink tools: socket setup, a
+ * message builder with bounds-checked and nested attributes, batched
+ * requests with sequence numbers and acks, dumps and event listening
+ *
+ * build a tool together with the library, e.g.:
+ *
+ *   gcc get-links.c rtnl.c -o get-links
+ */
+
+#ifndef RTNL_H
+#define RTNL_H
+
+/* netlink imports */
+#include <asm/types.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+/* size_t */
+#include <stddef.h>
+
+/* initial and maximum size of the receive buffer; the kernel sizes dump
+ * datagrams by the receive buffer of the reader up to 32K, so 32K minimizes
+ * the number of reads per dump
+ */
+#define RTNL_RECV_BUF_MIN (32 * 1024)
+#define RTNL_RECV_BUF_MAX (1024 * 1024)
+
+/* receive buffer size of sockets listening to events; large enough to absorb
+ * event storms, e.g., thousands of new links per second
+ */
+#define RTNL_EVENT_RCVBUF (16 * 1024 * 1024)
+
+/* maximum length of extended ack error messages */
+#define RTNL_ERR_MSG_SIZE 256
+
+/* rtnetlink socket */
+struct rtnl {
+	int fd;			/* socket fd */
+	__u32 pid;		/* port id assigned by the kernel */
+	__u32 seq;		/* sequence number of the last sent message */
+	char *buf;		/* receive buffer */
+	size_t buf_size;	/* size of receive buffer */
+	int filtered;		/* last dump was filtered by the kernel */
+	__u64 overruns;		/* receive buffer overruns, events were lost */
+
+	/* extended ack message of the last error, empty if none */
+	char err_msg[RTNL_ERR_MSG_SIZE];
+};
+
+/* buffer for building a batch of one or more netlink messages */
+struct rtnl_msg {
+	char *buf;		/* message buffer */
+	size_t size;		/* size of message buffer */
+	size_t len;		/* length of all messages in buffer */
+	struct nlmsghdr *hdr;	/* message currently being built */
+	int num;		/* number of messages in buffer */
+	__u32 seq;		/* sequence number of first message once sent */
+	int err;		/* -EMSGSIZE if a message did not fit */
+};
+
+/* callback for received netlink messages; return 0 to continue receiving,
+ * a positive value to stop or a negative error
+ */
+typedef int (*rtnl_cb)(struct nlmsghdr *nh, void *arg);
+
+/* callback for the ack of a request with sequence number seq and error err
+ * (0 on success), e.g., of pipelined requests; the extended ack message of
+ * a failed request is in err_msg of rtnl during the call; return 0 to
+ * continue receiving, a positive value to stop or a negative error
+ */
+typedef int (*rtnl_ack_cb)(struct rtnl *rtnl, __u32 seq, int err, void *arg);
+
+/* callback for resynchronizing state after events were lost, e.g., with a
+ * dump; return 0 to continue receiving, a positive value to stop or a
+ * negative error
+ */
+typedef int (*rtnl_resync_cb)(struct rtnl *rtnl, void *arg);
+
+/* first attribute and length of all attributes of message nh with a family
+ * header of hdr_len bytes, e.g., sizeof(struct ifinfomsg)
+ */
+#define RTNL_ATTRS(nh, hdr_len) \
+	((struct rtattr *) ((char *) NLMSG_DATA(nh) + NLMSG_ALIGN(hdr_len)))
+#define RTNL_ATTRS_LEN(nh, hdr_len) \
+	((int) (nh)->nlmsg_len - (int) NLMSG_LENGTH(NLMSG_ALIGN(hdr_len)))
+
+/* open rtnetlink socket joined to multicast groups (RTMGRP_*, 0 for none)
+ * with receive and send buffer sizes rcvbuf and sndbuf (0 for default);
+ * rcvbuf is forced beyond the rmem_max limit with CAP_NET_ADMIN; extended
+ * acks are enabled and acks do not echo the request; NETLINK_NO_ENOBUFS is
+ * not set, so lost events are detected
+ */
+int rtnl_open(struct rtnl *rtnl, __u32 groups, int rcvbuf, int sndbuf);
+
+/* enable strict checking of requests (NETLINK_GET_STRICT_CHK); the kernel
+ * then rejects malformed dump requests instead of ignoring parts of them and
+ * filters dumps by the family header and attributes of the request, e.g.,
+ * links by IFLA_MASTER or kind and addresses by family and index; return 0
+ * or a negative error if the kernel does not support it
+ */
+int rtnl_set_strict(struct rtnl *rtnl);
+
+/* close rtnetlink socket */
+void rtnl_close(struct rtnl *rtnl);
+
+/* initialize empty message batch in buf of size bytes */
+void rtnl_msg_init(struct rtnl_msg *msg, void *buf, size_t size);
+
+/* start new message of type with flags in batch and return its zeroed
+ * family header of hdr_len bytes, NULL if it does not fit; NLM_F_REQUEST is
+ * always set and NLM_F_ACK for all requests except dumps
+ */
+void *rtnl_msg_add(struct rtnl_msg *msg, __u16 type, __u16 flags,
+		   size_t hdr_len);
+
+/* append len zeroed bytes to current message, e.g., a family header nested
+ * in an attribute, and return them, NULL if they do not fit
+ */
+void *rtnl_msg_reserve(struct rtnl_msg *msg, size_t len);
+
+/* append attribute with len bytes of data to current message and return it,
+ * NULL if it does not fit
+ */
+struct rtattr *rtnl_attr_add(struct rtnl_msg *msg, __u16 type,
+			     const void *data, size_t len);
+
+/* append null-terminated string attribute to current message */
+struct rtattr *rtnl_attr_add_str(struct rtnl_msg *msg, __u16 type,
+				 const char *str);
+
+/* append u32 attribute to current message */
+struct rtattr *rtnl_attr_add_u32(struct rtnl_msg *msg, __u16 type,
+				 __u32 value);
+
+/* start nested attribute in current message; attributes added until
+ * rtnl_attr_nest_end() are nested in it
+ */
+struct rtattr *rtnl_attr_nest(struct rtnl_msg *msg, __u16 type);
+
+/* end nested attribute started with rtnl_attr_nest() */
+void rtnl_attr_nest_end(struct rtnl_msg *msg, struct rtattr *nest);
+
+/* parse attributes starting at rta with length len into table tb indexed by
+ * attribute type up to max; missing attributes are NULL
+ */
+void rtnl_parse_attrs(struct rtattr **tb, int max, struct rtattr *rta,
+		      int len);
+
+/* assign sequence numbers to all messages in batch and send them with a
+ * single sendmsg call
+ */
+int rtnl_send(struct rtnl *rtnl, struct rtnl_msg *msg);
+
+/* receive next datagram and pass each of its messages to cb; the datagram
+ * size is peeked first and the receive buffer grown if needed, so messages
+ * are never truncated; return the first non-zero value of cb, a negative
+ * error if receiving fails, or 0
+ */
+int rtnl_recv(struct rtnl *rtnl, rtnl_cb cb, void *arg);
+
+/* pass all messages already queued on the socket to cb without blocking,
+ * e.g., to apply stale events before a resync dump; overruns are counted in
+ * overruns; return the first non-zero value of cb, a negative error, or 0
+ */
+int rtnl_drain(struct rtnl *rtnl, rtnl_cb cb, void *arg);
+
+/* wait for acks of all messages in sent batch and store the error of each
+ * message in errors (0 on success) if not NULL; return number of failed
+ * messages or a negative error if receiving fails
+ */
+int rtnl_wait_acks(struct rtnl *rtnl, struct rtnl_msg *msg, int *errors);
+
+/* receive next datagram and pass the sequence number and error of each ack
+ * in it to cb, other messages are ignored; this collects acks of requests
+ * sent in several batches without waiting for each batch, the caller maps
+ * sequence numbers to requests, e.g., with seq of each sent batch; return
+ * the first non-zero value of cb, a negative error if receiving fails, e.g.,
+ * -ENOBUFS if acks were lost because the receive buffer overran, or 0
+ */
+int rtnl_recv_acks(struct rtnl *rtnl, rtnl_ack_cb cb, void *arg);
+
+/* print s, the error message of negative error err and the extended ack
+ * message of the last error, if any
+ */
+void rtnl_perror(struct rtnl *rtnl, const char *s, int err);
+
+/* send batch and wait for its acks; return 0 or the error of the first
+ * failed message, an empty batch is not sent
+ */
+int rtnl_request(struct rtnl *rtnl, struct rtnl_msg *msg);
+
+/* send dump request in msg and pass each message of the reply to cb until
+ * the dump is done or cb returns non-zero; return 0 or a negative error;
+ * afterwards, filtered is set if the kernel filtered the dump; a get request
+ * for a single object can be sent the same way and ends with its ack; on
+ * sockets joined to multicast groups, events received during the dump are
+ * passed to cb as well, so they are not lost, and overruns are counted in
+ * overruns without stopping the dump
+ */
+int rtnl_dump(struct rtnl *rtnl, struct rtnl_msg *msg, rtnl_cb cb,
+	      void *arg);
+
+/* dump all links with rtnl_dump() and pass the RTM_NEWLINK messages to cb,
+ * e.g., to resync after an overrun; return 0 or a negative error
+ */
+int rtnl_dump_links(struct rtnl *rtnl, rtnl_cb cb, void *arg);
+
+/* receive messages, e.g., multicast events, and pass them to cb until cb
+ * returns non-zero or receiving fails; return 0 or a negative error; if the
+ * receive buffer overran (ENOBUFS), events were lost: the overrun is counted
+ * in overruns and resync is called, if not NULL, until no more events were
+ * lost in the meantime; receiving continues after overruns
+ */
+int rtnl_listen(struct rtnl *rtnl, rtnl_cb cb, rtnl_resync_cb resync,
+		void *arg);
+
+#endif
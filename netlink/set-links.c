@@ -0,0 +1,790 @@
+/* apply the desired configuration of many links in a file: dump links and
+ * addresses, compare them with the file and apply only the needed changes
+ * with pipelined RTM_SETLINK, RTM_NEWADDR and RTM_DELADDR requests; the acks
+ * are collected while more requests are sent and errors are reported per
+ * link and change
+ *
+ * each line of the file configures one link by its current name, followed
+ * by any of:
+ *
+ *   name <name>: rename link; the link is also found by its new name, so
+ *                the file can be applied again
+ *   mtu <mtu>: set mtu
+ *   up, down: set link up or down
+ *   netns <file>: move link to network namespace identified by file, e.g.,
+ *                 /var/run/netns/testns; when the file is applied again,
+ *                 moved links are not found
+ *   netnspid <pid>: move link to network namespace of process pid
+ *   addr <addr>/<prefixlen>: add ipv4 or ipv6 address, can be repeated; an
+ *                            existing address with another prefix length
+ *                            is replaced
+ *
+ * empty lines and lines starting with # are ignored, e.g.:
+ *
+ *   veth0 name eth1 mtu 9000 up addr 10.0.0.1/24 addr fd00::1/64
+ *
+ * options:
+ *   -f <file>: file with desired configuration, default stdin
+ *   -r: remove addresses not in the file from links with addresses in the
+ *       file; link local addresses are kept
+ *   -n: only print the changes, do not apply them
+ *   -v: print each change
+ *   -B <num>: requests per sendmsg call, default 64
+ *   -w <num>: maximum requests without ack, default 1024
+ *
+ * build together with the caches:
+ *
+ *   gcc set-links.c linkcache.c addrcache.c cache.c rtnl.c -o set-links
+ */
+
+/* link and address caches and rtnetlink library */
+#include "linkcache.h"
+#include "addrcache.h"
+
+/* EMSGSIZE, EINVAL, ENOMEM, ENODEV */
+#include <errno.h>
+
+/* printf(), fopen(), getline() */
+#include <stdio.h>
+
+/* strtoul(), malloc(), realloc(), free() */
+#include <stdlib.h>
+
+/* strtok_r(), strcmp(), strchr(), strspn(), strdup(), strncpy() */
+#include <string.h>
+
+/* getopt(), close() */
+#include <unistd.h>
+
+/* open(), O_RDONLY */
+#include <fcntl.h>
+
+/* inet_pton(), inet_ntop() */
+#include <arpa/inet.h>
+
+/* clock_gettime() */
+#include <time.h>
+
+/* maximum size of a request */
+#define REQUEST_SIZE 512
+
+/* receive buffer size for the acks of all requests in flight */
+#define ACK_RCVBUF (4 << 20)
+
+/* address in the file */
+struct addr {
+	int family;			/* AF_INET or AF_INET6 */
+	unsigned char addr[16];		/* address */
+	int prefixlen;			/* prefix length */
+};
+
+/* desired configuration of a link, a line of the file */
+struct link_config {
+	int line;			/* line number in the file */
+	char name[IF_NAMESIZE];		/* current name */
+	char new_name[IF_NAMESIZE];	/* new name or empty */
+	__u32 mtu;			/* mtu or 0 */
+	int up;				/* 1 for up, 0 for down, -1 if not set */
+	int netns_fd;			/* network namespace fd or -1 */
+	int netns_pid;			/* network namespace pid or 0 */
+	struct addr *addrs;		/* addresses */
+	int num_addrs;			/* number of addresses */
+};
+
+/* changes of a link in a RTM_SETLINK request */
+#define CHANGE_DOWN	0x01	/* set down before rename */
+#define CHANGE_NAME	0x02
+#define CHANGE_MTU	0x04
+#define CHANGE_FLAGS	0x08
+#define CHANGE_NETNS	0x10
+
+/* change of a RTM_NEWADDR request */
+#define CHANGE_REPLACE	0x20	/* replace address if it exists */
+
+/* change, one request */
+struct change {
+	int type;			/* RTM_SETLINK, RTM_NEWADDR or
+					 * RTM_DELADDR
+					 */
+	struct link_config *link;	/* link of change */
+	int ifindex;			/* interface index of link */
+	int changes;			/* CHANGE_* of request */
+	struct addr addr;		/* address of RTM_*ADDR */
+};
+
+/* all links of the file and their changes */
+struct config {
+	struct link_config *links;	/* links */
+	int num_links;			/* number of links */
+	struct change *changes;		/* changes */
+	int num_changes;		/* number of changes */
+	int remove;			/* remove addresses not in file */
+	int dry_run;			/* only print changes */
+	int verbose;			/* print each change */
+	int batch;			/* requests per sendmsg */
+	int window;			/* maximum requests without ack */
+};
+
+/* state of pipelined requests */
+struct pipeline {
+	struct config *config;
+	__u32 seq;		/* sequence number of first request */
+	int sent;		/* number of sent requests */
+	int acked;		/* number of received acks */
+	int failed;		/* number of failed requests */
+};
+
+/* opened network namespace file */
+struct netns {
+	char *path;
+	int fd;
+};
+
+/* opened network namespace files */
+struct netns *netns_files;
+int num_netns_files;
+
+/* open network namespace file at path once and return its fd, -1 on error */
+int open_netns(const char *path) {
+	for (int i = 0; i < num_netns_files; i++) {
+		if (!strcmp(netns_files[i].path, path)) {
+			return netns_files[i].fd;
+		}
+	}
+
+	int fd = open(path, O_RDONLY);
+	if (fd == -1) {
+		return -1;
+	}
+	struct netns *files = realloc(netns_files, (num_netns_files + 1) *
+				      sizeof(*files));
+	char *p = strdup(path);
+	if (!files || !p) {
+		free(p);
+		close(fd);
+		return -1;
+	}
+	netns_files = files;
+	netns_files[num_netns_files].path = p;
+	netns_files[num_netns_files].fd = fd;
+	num_netns_files++;
+
+	return fd;
+}
+
+/* parse address with prefix length in s into addr */
+int parse_addr(char *s, struct addr *addr) {
+	char *len = strchr(s, '/');
+	if (!len) {
+		return -1;
+	}
+	*len++ = 0;
+
+	memset(addr, 0, sizeof(*addr));
+	addr->family = strchr(s, ':') ? AF_INET6 : AF_INET;
+	if (inet_pton(addr->family, s, addr->addr) != 1) {
+		return -1;
+	}
+	char *end;
+	addr->prefixlen = strtoul(len, &end, 10);
+	if (*end || addr->prefixlen > (addr->family == AF_INET ? 32 : 128)) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/* copy interface name s to name */
+int parse_name(const char *s, char *name) {
+	if (!s || strlen(s) >= IF_NAMESIZE) {
+		return -1;
+	}
+	strncpy(name, s, IF_NAMESIZE);
+
+	return 0;
+}
+
+/* parse line number num of file into link */
+int parse_line(char *line, int num, struct link_config *link) {
+	char *save;
+	char *name = strtok_r(line, " \t\n", &save);
+
+	memset(link, 0, sizeof(*link));
+	link->line = num;
+	link->up = -1;
+	link->netns_fd = -1;
+	if (parse_name(name, link->name)) {
+		printf("line %d: invalid name\n", num);
+		return -1;
+	}
+
+	for (char *key; (key = strtok_r(NULL, " \t\n", &save));) {
+		/* keywords without value */
+		if (!strcmp(key, "up") || !strcmp(key, "down")) {
+			link->up = !strcmp(key, "up");
+			continue;
+		}
+
+		/* keywords with value */
+		char *value = strtok_r(NULL, " \t\n", &save);
+		if (!value) {
+			printf("line %d: missing value of %s\n", num, key);
+			return -1;
+		}
+		if (!strcmp(key, "name")) {
+			if (parse_name(value, link->new_name)) {
+				printf("line %d: invalid name %s\n", num,
+				       value);
+				return -1;
+			}
+		} else if (!strcmp(key, "mtu")) {
+			link->mtu = strtoul(value, NULL, 0);
+		} else if (!strcmp(key, "netns")) {
+			link->netns_fd = open_netns(value);
+			if (link->netns_fd == -1) {
+				printf("line %d: error opening %s\n", num,
+				       value);
+				return -1;
+			}
+		} else if (!strcmp(key, "netnspid")) {
+			link->netns_pid = strtoul(value, NULL, 0);
+		} else if (!strcmp(key, "addr")) {
+			struct addr *addrs = realloc(link->addrs,
+						     (link->num_addrs + 1) *
+						     sizeof(*addrs));
+			if (!addrs) {
+				return -1;
+			}
+			link->addrs = addrs;
+			if (parse_addr(value, &addrs[link->num_addrs])) {
+				printf("line %d: invalid address %s\n", num,
+				       value);
+				return -1;
+			}
+			link->num_addrs++;
+		} else {
+			printf("line %d: unknown keyword %s\n", num, key);
+			return -1;
+		}
+	}
+
+	/* addresses of links in other namespaces cannot be set from here */
+	if (link->num_addrs && (link->netns_fd != -1 || link->netns_pid)) {
+		printf("line %d: addresses of links moved to another network "
+		       "namespace are not supported\n", num);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* parse file into config */
+int parse_file(FILE *file, struct config *config) {
+	char *line = NULL;
+	size_t size = 0;
+	int num = 0;
+
+	while (getline(&line, &size, file) != -1) {
+		num++;
+		char *c = line + strspn(line, " \t\n");
+		if (!*c || *c == '#') {
+			continue;
+		}
+		struct link_config *links = realloc(config->links,
+						    (config->num_links + 1) *
+						    sizeof(*links));
+		if (!links) {
+			free(line);
+			return -ENOMEM;
+		}
+		config->links = links;
+		if (parse_line(c, num, &links[config->num_links])) {
+			free(line);
+			return -EINVAL;
+		}
+		config->num_links++;
+	}
+	free(line);
+
+	return 0;
+}
+
+/* append change to config */
+int add_change(struct config *config, struct change *change) {
+	if ((config->num_changes & (config->num_changes - 1)) == 0) {
+		int size = config->num_changes ? config->num_changes * 2 : 1;
+		struct change *changes = realloc(config->changes, size *
+						 sizeof(*changes));
+		if (!changes) {
+			return -ENOMEM;
+		}
+		config->changes = changes;
+	}
+	config->changes[config->num_changes++] = *change;
+
+	return 0;
+}
+
+/* check if address in the file has the same family and address as the
+ * current address cur, ignoring the prefix length
+ */
+int same_addr(const struct addr *a, const struct addr_info *cur) {
+	return a->family == cur->family &&
+		!memcmp(a->addr, cur->addr, a->family == AF_INET ? 4 : 16);
+}
+
+/* check if current address cur of link must be deleted: if the file has it
+ * with another prefix length, or with -r if it is not in the file
+ */
+int must_delete(struct config *config, struct link_config *link,
+		const struct addr_info *cur) {
+	int other_prefixlen = 0;
+
+	for (int i = 0; i < link->num_addrs; i++) {
+		struct addr *a = &link->addrs[i];
+		if (!same_addr(a, cur)) {
+			continue;
+		}
+		if (a->prefixlen == cur->prefixlen) {
+			return 0;
+		}
+		other_prefixlen = 1;
+	}
+	if (other_prefixlen) {
+		return 1;
+	}
+
+	return config->remove && link->num_addrs &&
+		cur->scope != RT_SCOPE_LINK;
+}
+
+/* check if current secondary ipv4 address cur is flushed, because the
+ * primary address of its subnet is deleted; secondaries are only promoted
+ * if the promote_secondaries sysctl is set
+ */
+int is_flushed(struct config *config, struct link_config *link,
+	       const struct addr_info **current, int num,
+	       const struct addr_info *cur) {
+	if (cur->family != AF_INET || !(cur->flags & IFA_F_SECONDARY)) {
+		return 0;
+	}
+
+	__u32 mask = cur->prefixlen ? htonl(~0U << (32 - cur->prefixlen)) : 0;
+	__u32 addr;
+	memcpy(&addr, cur->addr, 4);
+	for (int i = 0; i < num; i++) {
+		const struct addr_info *p = current[i];
+		__u32 primary;
+		memcpy(&primary, p->addr, 4);
+		if (p->family == AF_INET && !(p->flags & IFA_F_SECONDARY) &&
+		    p->prefixlen == cur->prefixlen &&
+		    !((primary ^ addr) & mask) &&
+		    must_delete(config, link, p)) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/* compare link with its current state and add its changes to config */
+int diff_link(struct config *config, struct linkcache *links,
+	      struct addrcache *addrs, struct link_config *link) {
+	/* find link by its current name or, if renamed before, by its new
+	 * name
+	 */
+	const struct link_info *info = linkcache_get_name(links, link->name);
+	if (!info && link->new_name[0]) {
+		info = linkcache_get_name(links, link->new_name);
+	}
+	if (!info) {
+		printf("line %d: %s: link not found\n", link->line,
+		       link->name);
+		return -ENODEV;
+	}
+
+	struct change change;
+	memset(&change, 0, sizeof(change));
+	change.type = RTM_SETLINK;
+	change.link = link;
+	change.ifindex = info->ifindex;
+	int up = info->flags & IFF_UP ? 1 : 0;
+	if (link->new_name[0] && strcmp(info->name, link->new_name)) {
+		change.changes |= CHANGE_NAME;
+	}
+	if (link->mtu && info->mtu != link->mtu) {
+		change.changes |= CHANGE_MTU;
+	}
+	if (link->up != -1 && link->up != up) {
+		change.changes |= CHANGE_FLAGS;
+	}
+	if (link->netns_fd != -1 || link->netns_pid) {
+		/* moving sets the link down, set it up again afterwards */
+		change.changes |= CHANGE_NETNS;
+		if (link->up == 1) {
+			change.changes |= CHANGE_FLAGS;
+		}
+	}
+
+	/* links cannot be renamed while they are up, so set the link down
+	 * first and up again afterwards if it should stay up
+	 */
+	if (change.changes & CHANGE_NAME && up) {
+		struct change down = change;
+		down.changes = CHANGE_DOWN;
+		int rc = add_change(config, &down);
+		if (rc) {
+			return rc;
+		}
+		if (link->up != 0) {
+			link->up = 1;
+			change.changes |= CHANGE_FLAGS;
+		}
+	}
+	if (change.changes) {
+		int rc = add_change(config, &change);
+		if (rc) {
+			return rc;
+		}
+	}
+
+	/* addresses; deletes are queued before adds, so an address can be
+	 * replaced in the same subnet or with a new prefix length
+	 */
+	int num = addrcache_get_link(addrs, info->ifindex, AF_UNSPEC, NULL, 0);
+	const struct addr_info **current = NULL;
+	if (num > 0) {
+		current = malloc(num * sizeof(*current));
+		if (!current) {
+			return -ENOMEM;
+		}
+		addrcache_get_link(addrs, info->ifindex, AF_UNSPEC, current,
+				   num);
+	}
+	int rc = 0;
+	change.changes = 0;
+	change.type = RTM_DELADDR;
+	for (int i = 0; i < num && !rc; i++) {
+		if (!must_delete(config, link, current[i])) {
+			continue;
+		}
+		memset(&change.addr, 0, sizeof(change.addr));
+		change.addr.family = current[i]->family;
+		change.addr.prefixlen = current[i]->prefixlen;
+		memcpy(change.addr.addr, current[i]->addr, 16);
+		rc = add_change(config, &change);
+	}
+	change.type = RTM_NEWADDR;
+	for (int i = 0; i < link->num_addrs && !rc; i++) {
+		struct addr *a = &link->addrs[i];
+		if (addrcache_get(addrs, info->ifindex, a->family, a->addr,
+				  a->prefixlen)) {
+			continue;
+		}
+		change.addr = *a;
+		rc = add_change(config, &change);
+	}
+
+	/* add flushed addresses again; they still exist if the kernel promoted
+	 * them, so replace them
+	 */
+	change.changes = CHANGE_REPLACE;
+	for (int i = 0; i < num && !rc; i++) {
+		if (must_delete(config, link, current[i]) ||
+		    !is_flushed(config, link, current, num, current[i])) {
+			continue;
+		}
+		memset(&change.addr, 0, sizeof(change.addr));
+		change.addr.family = current[i]->family;
+		change.addr.prefixlen = current[i]->prefixlen;
+		memcpy(change.addr.addr, current[i]->addr, 16);
+		rc = add_change(config, &change);
+	}
+	free(current);
+
+	return rc;
+}
+
+/* print change */
+void print_change(const char *s, struct change *change) {
+	struct link_config *link = change->link;
+	char addr[INET6_ADDRSTRLEN];
+
+	printf("%s%s", s, link->name);
+	switch (change->type) {
+	case RTM_SETLINK:
+		if (change->changes & CHANGE_DOWN) {
+			printf(" down");
+		}
+		if (change->changes & CHANGE_NAME) {
+			printf(" name %s", link->new_name);
+		}
+		if (change->changes & CHANGE_MTU) {
+			printf(" mtu %u", link->mtu);
+		}
+		if (change->changes & CHANGE_FLAGS) {
+			printf(" %s", link->up ? "up" : "down");
+		}
+		if (change->changes & CHANGE_NETNS) {
+			printf(" netns");
+		}
+		break;
+	case RTM_NEWADDR:
+	case RTM_DELADDR:
+		inet_ntop(change->addr.family, change->addr.addr, addr,
+			  sizeof(addr));
+		printf(" %s %s/%d", change->type == RTM_NEWADDR ? "addr" : "del",
+		       addr, change->addr.prefixlen);
+		break;
+	}
+	printf("\n");
+}
+
+/* add request of change to batch */
+int add_request(struct rtnl_msg *msg, struct change *change) {
+	struct link_config *link = change->link;
+
+	if (change->type == RTM_SETLINK) {
+		struct ifinfomsg *ifi = rtnl_msg_add(msg, RTM_SETLINK, 0,
+						     sizeof(*ifi));
+		if (!ifi) {
+			return -EMSGSIZE;
+		}
+		ifi->ifi_family = AF_UNSPEC;
+		ifi->ifi_index = change->ifindex;
+		if (change->changes & CHANGE_DOWN) {
+			ifi->ifi_change = IFF_UP;
+			return msg->err;
+		}
+		if (change->changes & CHANGE_FLAGS) {
+			ifi->ifi_flags = link->up ? IFF_UP : 0;
+			ifi->ifi_change = IFF_UP;
+		}
+		if (change->changes & CHANGE_NAME) {
+			rtnl_attr_add_str(msg, IFLA_IFNAME, link->new_name);
+		}
+		if (change->changes & CHANGE_MTU) {
+			rtnl_attr_add_u32(msg, IFLA_MTU, link->mtu);
+		}
+		if (link->netns_fd != -1) {
+			rtnl_attr_add_u32(msg, IFLA_NET_NS_FD, link->netns_fd);
+		}
+		if (link->netns_pid) {
+			rtnl_attr_add_u32(msg, IFLA_NET_NS_PID,
+					  link->netns_pid);
+		}
+		return msg->err;
+	}
+
+	struct ifaddrmsg *ifa = rtnl_msg_add(msg, change->type,
+					     change->type != RTM_NEWADDR ? 0 :
+					     change->changes & CHANGE_REPLACE ?
+					     NLM_F_CREATE | NLM_F_REPLACE :
+					     NLM_F_CREATE | NLM_F_EXCL,
+					     sizeof(*ifa));
+	if (!ifa) {
+		return -EMSGSIZE;
+	}
+	int len = change->addr.family == AF_INET ? 4 : 16;
+	ifa->ifa_family = change->addr.family;
+	ifa->ifa_prefixlen = change->addr.prefixlen;
+	ifa->ifa_flags = IFA_F_PERMANENT;
+	ifa->ifa_index = change->ifindex;
+	rtnl_attr_add(msg, IFA_LOCAL, change->addr.addr, len);
+	if (change->type == RTM_NEWADDR) {
+		rtnl_attr_add(msg, IFA_ADDRESS, change->addr.addr, len);
+	}
+
+	return msg->err;
+}
+
+/* handle ack of request, print error of failed requests */
+int handle_ack(struct rtnl *rtnl, __u32 seq, int err, void *arg) {
+	struct pipeline *p = arg;
+	__u32 index = seq - p->seq;
+
+	if (index >= (__u32) p->sent) {
+		return 0;
+	}
+	p->acked++;
+	if (err) {
+		struct change *change = &p->config->changes[index];
+		char s[64];
+		snprintf(s, sizeof(s), "line %d: %s", change->link->line,
+			 change->link->name);
+		rtnl_perror(rtnl, s, err);
+		print_change("  failed: ", change);
+		p->failed++;
+	}
+
+	return 0;
+}
+
+/* send requests of all changes and collect their acks */
+int apply(struct rtnl *rtnl, struct config *config, struct pipeline *p) {
+	size_t size = (size_t) config->batch * REQUEST_SIZE;
+	char *buf = malloc(size);
+	if (!buf) {
+		return -ENOMEM;
+	}
+
+	while (p->acked < config->num_changes) {
+		/* send next batch if the window allows it */
+		int num = config->num_changes - p->sent;
+		if (num > config->batch) {
+			num = config->batch;
+		}
+		if (num > 0 && p->sent - p->acked + num <= config->window) {
+			struct rtnl_msg msg;
+			rtnl_msg_init(&msg, buf, size);
+			for (int i = 0; i < num; i++) {
+				int rc = add_request(&msg, &config->changes[
+							     p->sent + i]);
+				if (rc) {
+					free(buf);
+					return rc;
+				}
+			}
+			int rc = rtnl_send(rtnl, &msg);
+			if (rc) {
+				free(buf);
+				return rc;
+			}
+			if (p->sent == 0) {
+				p->seq = msg.seq;
+			}
+			p->sent += num;
+			continue;
+		}
+
+		/* collect acks */
+		int rc = rtnl_recv_acks(rtnl, handle_ack, p);
+		if (rc < 0) {
+			free(buf);
+			return rc;
+		}
+	}
+
+	free(buf);
+	return 0;
+}
+
+/* get current time in seconds */
+double now(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv) {
+	struct config config = {
+		.batch = 64,
+		.window = 1024,
+	};
+	FILE *file = stdin;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "f:rnvB:w:")) != -1) {
+		switch (opt) {
+		case 'f':
+			file = fopen(optarg, "r");
+			if (!file) {
+				printf("error opening %s\n", optarg);
+				return -1;
+			}
+			break;
+		case 'r':
+			config.remove = 1;
+			break;
+		case 'n':
+			config.dry_run = 1;
+			break;
+		case 'v':
+			config.verbose = 1;
+			break;
+		case 'B':
+			config.batch = strtoul(optarg, NULL, 0);
+			break;
+		case 'w':
+			config.window = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			printf("Usage: %s [-f file] [-r] [-n] [-v] [-B num] "
+			       "[-w num]\n", argv[0]);
+			return -1;
+		}
+	}
+	if (config.batch < 1 || config.window < config.batch) {
+		printf("Invalid batch or window size\n");
+		return -1;
+	}
+	if (parse_file(file, &config)) {
+		return -1;
+	}
+
+	/* dump current links and addresses */
+	double start = now();
+	struct rtnl rtnl;
+	if (rtnl_open(&rtnl, 0, ACK_RCVBUF, 0)) {
+		printf("Error opening netlink socket\n");
+		return -1;
+	}
+	struct linkcache links;
+	struct addrcache addrs;
+	if (linkcache_init(&links, NULL, NULL) ||
+	    addrcache_init(&addrs, NULL, NULL)) {
+		printf("Error creating caches\n");
+		return -1;
+	}
+	int rc = linkcache_sync(&links, &rtnl);
+	if (!rc) {
+		rc = addrcache_sync(&addrs, &rtnl);
+	}
+	if (rc) {
+		rtnl_perror(&rtnl, "Error dumping links and addresses", rc);
+		return -1;
+	}
+
+	/* compare with desired configuration; links that are not found are
+	 * reported and skipped
+	 */
+	int not_found = 0;
+	for (int i = 0; i < config.num_links; i++) {
+		rc = diff_link(&config, &links, &addrs, &config.links[i]);
+		if (rc == -ENODEV) {
+			not_found++;
+			continue;
+		}
+		if (rc) {
+			printf("Error comparing links\n");
+			return -1;
+		}
+	}
+	double diff = now() - start;
+	if (config.dry_run || config.verbose) {
+		for (int i = 0; i < config.num_changes; i++) {
+			print_change("", &config.changes[i]);
+		}
+	}
+	if (config.dry_run) {
+		printf("%d links, %d changes, %d links not found\n",
+		       config.num_links, config.num_changes, not_found);
+		return not_found ? -1 : 0;
+	}
+
+	/* apply changes */
+	struct pipeline p = { &config, 0, 0, 0, 0 };
+	start = now();
+	rc = apply(&rtnl, &config, &p);
+	if (rc) {
+		rtnl_perror(&rtnl, "Error", rc);
+		return -1;
+	}
+	printf("%d links, %d changes, %d failed, %d links not found; "
+	       "dump and diff %.1f ms, apply %.1f ms\n", config.num_links,
+	       config.num_changes, p.failed, not_found, diff * 1e3,
+	       (now() - start) * 1e3);
+
+	return p.failed || not_found ? -1 : 0;
+}